@@ -9,29 +9,61 @@
 #include <ctime>
 #include <random>
 #include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <climits>
 
 // =============== UTILITAIRES DE HACHAGE ===============
-// Fonction de hachage déterministe qui retourne une chaîne hexadécimale de 64 caractères
-// (simule SHA-256 pour les besoins du PoW)
+// SHA-256 (FIPS 180-4) retournant une chaîne hexadécimale de 64 caractères.
+// Implémentation portable : contrairement à l'ancienne simulation basée sur
+// std::hash, le résultat est identique quelle que soit la bibliothèque standard.
 std::string sha256_sim(const std::string& input) {
-    // On utilise une graine fixe pour la reproductibilité pendant le PoW
-    static std::hash<std::string> hasher;
-    size_t h1 = hasher(input);
-    size_t h2 = hasher(input + "salt");
-    size_t h3 = hasher(std::to_string(h1) + input);
-    size_t h4 = hasher(std::to_string(h2) + "pepper");
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+    // Remplissage : 0x80, zéros, puis longueur en bits sur 64 bits big-endian
+    std::string msg = input;
+    uint64_t bitLen = static_cast<uint64_t>(input.size()) * 8;
+    msg += static_cast<char>(0x80);
+    while (msg.size() % 64 != 56) msg += '\0';
+    for (int i = 7; i >= 0; --i) msg += static_cast<char>((bitLen >> (8 * i)) & 0xFF);
+
+    for (size_t off = 0; off < msg.size(); off += 64) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(msg.data()) + off;
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) | (uint32_t(p[4 * i + 2]) << 8) | uint32_t(p[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
 
     std::stringstream ss;
-    ss << std::hex << std::setfill('0')
-        << std::setw(16) << h1
-        << std::setw(16) << h2
-        << std::setw(16) << h3
-        << std::setw(16) << h4;
-    std::string hash = ss.str();
-    // Tronquer ou étendre à 64 caractères si nécessaire
-    if (hash.size() > 64) hash = hash.substr(0, 64);
-    while (hash.size() < 64) hash += '0';
-    return hash;
+    ss << std::hex << std::setfill('0');
+    for (uint32_t v : h) ss << std::setw(8) << v;
+    return ss.str();
 }
 
 // Vérifie si le hash commence par 'difficulty' zéros
@@ -88,11 +120,15 @@ public:
         hash = calculateHash();
     }
 
-    std::string calculateHash() const {
-        std::string data = std::to_string(index) + previousHash + merkleRoot + timestamp + std::to_string(nonce);
+    std::string hashWithNonce(long long n) const {
+        std::string data = std::to_string(index) + previousHash + merkleRoot + timestamp + std::to_string(n);
         return sha256_sim(data);
     }
 
+    std::string calculateHash() const {
+        return hashWithNonce(nonce);
+    }
+
     std::string mineBlock(int difficulty) {
         std::cout << "Minage du bloc " << index << " avec difficulté " << difficulty << "...\n";
         auto start = std::chrono::high_resolution_clock::now();
@@ -110,6 +146,57 @@ public:
 
         return hash;
     }
+
+    // Même recherche répartie sur plusieurs threads (0 = un par cœur).
+    // Chaque thread prend des tranches de nonces via un compteur atomique ;
+    // le plus petit nonce valide trouvé sert de seuil d'arrêt partagé, ce qui
+    // donne exactement le même nonce que mineBlock().
+    std::string mineBlockParallel(int difficulty, unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << "Minage parallèle du bloc " << index << " avec difficulté " << difficulty
+            << " (" << threads << " threads)...\n";
+
+        const long long chunk = 1024;
+        std::atomic<long long> nextChunk(0);
+        std::atomic<long long> best(LLONG_MAX);
+        std::vector<unsigned long long> attempts(threads, 0);
+
+        auto worker = [&](unsigned t) {
+            for (;;) {
+                long long begin = nextChunk.fetch_add(chunk);
+                if (begin >= best.load()) break;
+                for (long long n = begin; n < begin + chunk; ++n) {
+                    if ((n & 0xFF) == 0 && n >= best.load(std::memory_order_relaxed)) break;
+                    ++attempts[t];
+                    if (isValidHash(hashWithNonce(n), difficulty)) {
+                        long long current = best.load();
+                        while (n < current && !best.compare_exchange_weak(current, n)) {}
+                        break;
+                    }
+                }
+            }
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; ++t) workers.emplace_back(worker, t);
+        worker(0);
+        for (auto& w : workers) w.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        nonce = best.load();
+        hash = calculateHash();
+        std::cout << " Bloc miné ! Nonce = " << nonce << "\n";
+        std::cout << " Temps : " << static_cast<long long>(seconds * 1000.0) << " ms\n";
+        for (unsigned t = 0; t < threads; ++t) {
+            std::cout << "  Thread " << t << " : "
+                << static_cast<long long>(seconds > 0 ? attempts[t] / seconds : 0.0) << " H/s\n";
+        }
+        std::cout << " Hash : " << hash << "\n\n";
+
+        return hash;
+    }
 };
 
 // =============== FONCTION D'AIDE POUR EXEMPLES ===============
@@ -117,7 +204,9 @@ void testProofOfWork(int difficulty) {
     std::cout << "----- Test avec difficulté = " << difficulty << " -----\n";
     Block block(1, "0000000000000000000000000000000000000000000000000000000000000000",
         { "Alice paie Bob 1 BTC", "Charlie paie Dave 2 BTC" });
+    Block parallelBlock = block;
     block.mineBlock(difficulty);
+    parallelBlock.mineBlockParallel(difficulty);
 }
 
 // =============== PROGRAMME PRINCIPAL ===============
@@ -10,339 +10,11008 @@
 #include <random>
 #include <algorithm>
 #include <memory> // unique_ptr
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <queue>
+#include <numeric>
+#include <map>
+#include <set>
+#include <unordered_set>
+#include <unordered_map>
+#include <fstream>
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#endif
+#include <climits>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <cmath>
+#include <string_view>
+#include <type_traits>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+// ==================================================
+// MESURE DES ALLOCATIONS
+// ==================================================
+// operator new global instrumenté : nombre d'allocations et octets demandés
+// depuis le lancement (lus par les benchmarks avant / après une opération).
+// Un emplacement par thread vivant, écrit sans instruction verrouillée ; la
+// lecture additionne les emplacements. Rien n'est alloué pour les attribuer
+// (on est dans operator new) : au-delà de SLOTS threads vivants, les suivants
+// partagent un emplacement de débordement incrémenté par fetch_add.
+class AllocationStats {
+private:
+    static constexpr size_t SLOTS = 256;
+
+    // Zéro à l'initialisation statique, sans constructeur à exécuter
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> bytes;
+        std::atomic<bool> used;
+    };
+
+    static Slot* table() {
+        static Slot slots[SLOTS + 1];
+        return slots;
+    }
+
+    static Slot* acquire() {
+        Slot* slots = table();
+        for (size_t i = 0; i < SLOTS; ++i) {
+            bool expected = false;
+            if (!slots[i].used.load(std::memory_order_relaxed) &&
+                slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire)) return &slots[i];
+        }
+        return &slots[SLOTS];
+    }
+
+    // Libéré à la fin du thread, valeurs conservées ; les allocations qui
+    // suivent la destruction vont au débordement
+    struct ThreadSlot {
+        Slot* slot = nullptr;
+        ~ThreadSlot() {
+            if (slot && slot != &table()[SLOTS]) slot->used.store(false, std::memory_order_release);
+            slot = &table()[SLOTS];
+        }
+    };
+
+    static void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+        cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static uint64_t sum(std::atomic<uint64_t> Slot::* field) {
+        Slot* slots = table();
+        uint64_t total = 0;
+        for (size_t i = 0; i <= SLOTS; ++i) total += (slots[i].*field).load(std::memory_order_relaxed);
+        return total;
+    }
+
+public:
+    static void record(size_t size) {
+        thread_local ThreadSlot local;
+        if (!local.slot) local.slot = acquire();
+        if (local.slot == &table()[SLOTS]) {
+            local.slot->count.fetch_add(1, std::memory_order_relaxed);
+            local.slot->bytes.fetch_add(size, std::memory_order_relaxed);
+            return;
+        }
+        bump(local.slot->count, 1);
+        bump(local.slot->bytes, size);
+    }
+
+    static uint64_t count() { return sum(&Slot::count); }
+    static uint64_t bytes() { return sum(&Slot::bytes); }
+};
+
+// Hors ligne : sinon GCC voit free() appliqué au résultat de new après inlining
+#if defined(__GNUC__)
+#define ALLOC_NOINLINE __attribute__((noinline))
+#else
+#define ALLOC_NOINLINE
+#endif
+
+ALLOC_NOINLINE void* operator new(size_t size) {
+    AllocationStats::record(size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+ALLOC_NOINLINE void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+ALLOC_NOINLINE void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// ==================================================
+// MÉTRIQUES
+// ==================================================
+// Compteurs et histogrammes par thread : chaque thread écrit seul dans son
+// emplacement (lecture + écriture relâchées, ni verrou ni instruction atomique
+// verrouillée) ; le collecteur additionne les emplacements à la demande.
+// Les emplacements des threads terminés sont recyclés, leurs valeurs conservées.
+// Compiler avec -DNO_METRICS supprime tout : les macros METRIC_* deviennent vides.
+#ifndef NO_METRICS
+enum class Counter { NonceAttempts, HashCalls, MerkleBuilds, MerkleLeaves, ValidatorSelections, BlocksCommitted,
+    BlocksValidated, UtxoCacheHits, UtxoCacheMisses, UtxoEntriesFlushed, Count };
+enum class Histogram { Mining, MerkleBuild, BlockCommit, ChainValidation, UtxoFlush, Count };
+
+class Metrics {
+public:
+    static constexpr size_t COUNTERS = static_cast<size_t>(Counter::Count);
+    static constexpr size_t HISTOGRAMS = static_cast<size_t>(Histogram::Count);
+    // Seaux exponentiels : borne du seau b = 1,024 µs * 2^b, le dernier est +Inf
+    static constexpr size_t BUCKETS = 28;
+
+    struct Snapshot {
+        uint64_t counters[COUNTERS];
+        uint64_t buckets[HISTOGRAMS][BUCKETS];
+        uint64_t sumNs[HISTOGRAMS];
+    };
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> counters[COUNTERS];
+        std::atomic<uint64_t> buckets[HISTOGRAMS][BUCKETS];
+        std::atomic<uint64_t> sumNs[HISTOGRAMS];
+
+        Slot() {
+            for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+            for (auto& h : buckets) for (auto& b : h) b.store(0, std::memory_order_relaxed);
+            for (auto& s : sumNs) s.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    // Un seul écrivain par emplacement : pas besoin de fetch_add
+    static void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+        cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::mutex mutex; // enregistrement des threads et collecte uniquement
+    std::vector<std::unique_ptr<Slot> > slots;
+    std::vector<Slot*> freeSlots;
+
+    Slot* acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeSlots.empty()) {
+            Slot* slot = freeSlots.back();
+            freeSlots.pop_back();
+            return slot;
+        }
+        slots.emplace_back(new Slot());
+        return slots.back().get();
+    }
+
+    void release(Slot* slot) {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(slot);
+    }
+
+    struct ThreadHandle {
+        Slot* slot;
+        ThreadHandle() : slot(instance().acquire()) {}
+        ~ThreadHandle() { instance().release(slot); }
+    };
+
+    static Slot& local() {
+        thread_local ThreadHandle handle;
+        return *handle.slot;
+    }
+
+public:
+    static Metrics& instance() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    static void add(Counter c, uint64_t n = 1) {
+        bump(local().counters[static_cast<size_t>(c)], n);
+    }
+
+    static size_t bucketFor(uint64_t ns) {
+        size_t b = 0;
+        while (b + 1 < BUCKETS && (uint64_t(1024) << b) < ns) ++b;
+        return b;
+    }
+
+    static void observe(Histogram h, uint64_t ns) {
+        Slot& slot = local();
+        size_t i = static_cast<size_t>(h);
+        bump(slot.buckets[i][bucketFor(ns)], 1);
+        bump(slot.sumNs[i], ns);
+    }
+
+    Snapshot snapshot() {
+        Snapshot snap;
+        std::memset(&snap, 0, sizeof(snap));
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& slot : slots) {
+            for (size_t c = 0; c < COUNTERS; ++c) snap.counters[c] += slot->counters[c].load(std::memory_order_relaxed);
+            for (size_t h = 0; h < HISTOGRAMS; ++h) {
+                for (size_t b = 0; b < BUCKETS; ++b) snap.buckets[h][b] += slot->buckets[h][b].load(std::memory_order_relaxed);
+                snap.sumNs[h] += slot->sumNs[h].load(std::memory_order_relaxed);
+            }
+        }
+        return snap;
+    }
+
+    // Format texte d'exposition Prometheus
+    void writePrometheus(std::ostream& out) {
+        static const char* counterNames[COUNTERS][2] = {
+            { "blockchain_nonce_attempts_total", "Nonces essayés par les mineurs" },
+            { "blockchain_hash_calls_total", "Appels SHA-256 hors minage" },
+            { "blockchain_merkle_builds_total", "Arbres de Merkle construits" },
+            { "blockchain_merkle_leaves_total", "Feuilles hachées par les arbres de Merkle" },
+            { "blockchain_validator_selections_total", "Tirages de validateur PoS" },
+            { "blockchain_blocks_committed_total", "Blocs ajoutés à la chaîne" },
+            { "blockchain_blocks_validated_total", "Blocs vérifiés par la validation complète" },
+            { "blockchain_utxo_cache_hits_total", "Sorties trouvées dans le cache UTXO" },
+            { "blockchain_utxo_cache_misses_total", "Sorties relues depuis le magasin UTXO sur disque" },
+            { "blockchain_utxo_entries_flushed_total", "Entrées UTXO modifiées écrites sur disque" }
+        };
+        static const char* histogramNames[HISTOGRAMS][2] = {
+            { "blockchain_mining_seconds", "Durée de minage d'un bloc PoW" },
+            { "blockchain_merkle_build_seconds", "Durée de construction d'un arbre de Merkle" },
+            { "blockchain_block_commit_seconds", "Durée d'ajout d'un bloc (stockage compris)" },
+            { "blockchain_chain_validation_seconds", "Durée d'une validation complète de la chaîne" },
+            { "blockchain_utxo_flush_seconds", "Durée d'écriture d'un lot d'entrées UTXO" }
+        };
+        Snapshot snap = snapshot();
+        for (size_t c = 0; c < COUNTERS; ++c) {
+            out << "# HELP " << counterNames[c][0] << " " << counterNames[c][1] << "\n";
+            out << "# TYPE " << counterNames[c][0] << " counter\n";
+            out << counterNames[c][0] << " " << snap.counters[c] << "\n";
+        }
+        for (size_t h = 0; h < HISTOGRAMS; ++h) {
+            const char* name = histogramNames[h][0];
+            out << "# HELP " << name << " " << histogramNames[h][1] << "\n";
+            out << "# TYPE " << name << " histogram\n";
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                cumulative += snap.buckets[h][b];
+                out << name << "_bucket{le=\"";
+                if (b + 1 < BUCKETS) out << static_cast<double>(uint64_t(1024) << b) / 1e9;
+                else out << "+Inf";
+                out << "\"} " << cumulative << "\n";
+            }
+            out << name << "_sum " << static_cast<double>(snap.sumNs[h]) / 1e9 << "\n";
+            out << name << "_count " << cumulative << "\n";
+        }
+    }
+
+    // Écriture atomique (fichier temporaire puis renommage) : un lecteur ne voit
+    // jamais de fichier à moitié écrit
+    bool writeFile(const std::string& path) {
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp);
+            writePrometheus(out);
+            if (!out) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        return !ec;
+    }
+};
+
+// Chronomètre de portée : observe la durée écoulée à la destruction
+class ScopedMetricTimer {
+private:
+    Histogram histogram;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedMetricTimer(Histogram h) : histogram(h), start(std::chrono::steady_clock::now()) {}
+    ~ScopedMetricTimer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        Metrics::observe(histogram, static_cast<uint64_t>(ns));
+    }
+};
+
+// Export périodique vers un fichier texte (collecteur "textfile" de Prometheus) ;
+// un dernier instantané est écrit à l'arrêt
+class MetricsExporter {
+private:
+    std::string path;
+    std::chrono::milliseconds interval;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread thread;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+            Metrics::instance().writeFile(path);
+        }
+    }
+
+public:
+    MetricsExporter(const std::string& file, std::chrono::milliseconds period)
+        : path(file), interval(period), stopping(false), thread(&MetricsExporter::run, this) {}
+
+    ~MetricsExporter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+        Metrics::instance().writeFile(path);
+    }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+};
+
+#define METRIC_ADD(counter, n) Metrics::add(Counter::counter, (n))
+#define METRIC_TIME(histogram) ScopedMetricTimer scopedMetricTimer(Histogram::histogram)
+#else
+// sizeof : argument non évalué, mais ses variables ne sont pas signalées inutilisées
+#define METRIC_ADD(counter, n) ((void)sizeof(n))
+#define METRIC_TIME(histogram) ((void)0)
+#endif
 
 // ==================================================
 // UTILITAIRES DE HACHAGE
 // ==================================================
-std::string sha256_sim(const std::string& input) {
-    static std::hash<std::string> hasher;
-    size_t h1 = hasher(input);
-    size_t h2 = hasher(input + "salt");
-    size_t h3 = hasher(std::to_string(h1) + input);
-    size_t h4 = hasher(std::to_string(h2) + "pepper");
-
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0')
-        << std::setw(16) << h1
-        << std::setw(16) << h2
-        << std::setw(16) << h3
-        << std::setw(16) << h4;
-    std::string hash = ss.str();
-    if (hash.size() > 64) hash = hash.substr(0, 64);
-    while (hash.size() < 64) hash += '0';
-    return hash;
-}
-
-bool startsWithZeros(const std::string& hash, int difficulty) {
+std::string toHex(const uint8_t* data, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(len * 2, '0');
+    for (size_t i = 0; i < len; ++i) {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    return out;
+}
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t loadBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline uint64_t loadBE64(const uint8_t* p) {
+    return (uint64_t(loadBE32(p)) << 32) | loadBE32(p + 4);
+}
+
+static inline int countLeadingZeros64(uint64_t v) {
+    if (v == 0) return 64;
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(v);
+#else
+    int n = 0;
+    while (!(v & (uint64_t(1) << 63))) { v <<= 1; ++n; }
+    return n;
+#endif
+}
+
+// SHA-256 incrémental (FIPS 180-4). L'état est une simple structure copiable :
+// copier un Sha256 après avoir absorbé un préfixe donne un "midstate" réutilisable
+// sans recalculer ce préfixe ni allouer de mémoire.
+class Sha256 {
+private:
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t bufferLen;
+    uint64_t totalLen;
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+public:
+    Sha256() { reset(); }
+
+    static void initState(uint32_t st[8]) {
+        static const uint32_t init[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        std::memcpy(st, init, sizeof(init));
+    }
+
+    static void storeDigest(const uint32_t st[8], uint8_t out[32]) {
+        for (int i = 0; i < 8; ++i) {
+            out[4 * i] = uint8_t(st[i] >> 24);
+            out[4 * i + 1] = uint8_t(st[i] >> 16);
+            out[4 * i + 2] = uint8_t(st[i] >> 8);
+            out[4 * i + 3] = uint8_t(st[i]);
+        }
+    }
+
+    void reset() {
+        initState(state);
+        bufferLen = 0;
+        totalLen = 0;
+    }
+
+    static void compress(uint32_t st[8], const uint8_t block[64]) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) w[i] = loadBE32(block + 4 * i);
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + S1 + ch + SHA256_K[i] + w[i];
+            uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = S0 + maj;
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        st[0] += a; st[1] += b; st[2] += c; st[3] += d;
+        st[4] += e; st[5] += f; st[6] += g; st[7] += h;
+    }
+
+    void update(const uint8_t* data, size_t len) {
+        totalLen += len;
+        if (bufferLen > 0) {
+            size_t take = std::min(len, 64 - bufferLen);
+            std::memcpy(buffer + bufferLen, data, take);
+            bufferLen += take;
+            data += take;
+            len -= take;
+            if (bufferLen < 64) return;
+            compress(state, buffer);
+            bufferLen = 0;
+        }
+        while (len >= 64) {
+            compress(state, data);
+            data += 64;
+            len -= 64;
+        }
+        std::memcpy(buffer, data, len);
+        bufferLen = len;
+    }
+
+    void update(const std::string& data) {
+        update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+    void final(uint8_t out[32]) {
+        uint64_t bitLen = totalLen * 8;
+        buffer[bufferLen++] = 0x80;
+        if (bufferLen > 56) {
+            std::memset(buffer + bufferLen, 0, 64 - bufferLen);
+            compress(state, buffer);
+            bufferLen = 0;
+        }
+        std::memset(buffer + bufferLen, 0, 56 - bufferLen);
+        for (int i = 0; i < 8; ++i) buffer[56 + i] = uint8_t(bitLen >> (56 - 8 * i));
+        compress(state, buffer);
+        storeDigest(state, out);
+    }
+};
+
+void sha256(const void* data, size_t len, uint8_t out[32]) {
+    METRIC_ADD(HashCalls, 1);
+    Sha256 ctx;
+    ctx.update(static_cast<const uint8_t*>(data), len);
+    ctx.final(out);
+}
+
+// Double SHA-256 : SHA-256(SHA-256(data))
+void sha256d(const void* data, size_t len, uint8_t out[32]) {
+    uint8_t first[32];
+    sha256(data, len, first);
+    sha256(first, sizeof(first), out);
+}
+
+// ==================================================
+// EMPREINTE BINAIRE 256 BITS
+// ==================================================
+// Valeur de 32 octets trivialement copiable : comparaisons et difficulté
+// travaillent sur les octets (par mots de 64 bits), l'hexadécimal n'est
+// produit qu'à l'affichage ou à la sérialisation.
+struct Hash256 {
+    std::array<uint8_t, 32> bytes;
+
+    constexpr Hash256() : bytes{} {}
+
+    static Hash256 fromDigest(const uint8_t digest[32]) {
+        Hash256 h;
+        std::memcpy(h.bytes.data(), digest, 32);
+        return h;
+    }
+
+    // Accepte 64 caractères hexadécimaux ; renvoie false sinon
+    static bool fromHex(const std::string& hex, Hash256& out) {
+        if (hex.size() != 64) return false;
+        auto nibble = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+        for (size_t i = 0; i < 32; ++i) {
+            int hi = nibble(hex[2 * i]), lo = nibble(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) return false;
+            out.bytes[i] = uint8_t((hi << 4) | lo);
+        }
+        return true;
+    }
+
+    uint8_t* data() { return bytes.data(); }
+    const uint8_t* data() const { return bytes.data(); }
+
+    // Mot de 64 bits big-endian numéro i (0 = poids fort)
+    uint64_t word(size_t i) const { return loadBE64(bytes.data() + 8 * i); }
+
+    int leadingZeroBits() const {
+        for (size_t w = 0; w < 4; ++w) {
+            uint64_t v = word(w);
+            if (v != 0) return static_cast<int>(w * 64) + countLeadingZeros64(v);
+        }
+        return 256;
+    }
+
+    bool isZero() const { return leadingZeroBits() == 256; }
+
+    std::string toHex() const { return ::toHex(bytes.data(), bytes.size()); }
+
+    constexpr bool operator==(const Hash256& other) const {
+        for (size_t i = 0; i < 32; ++i) {
+            if (bytes[i] != other.bytes[i]) return false;
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const Hash256& other) const { return !(*this == other); }
+
+    constexpr bool operator<(const Hash256& other) const {
+        for (size_t i = 0; i < 32; ++i) {
+            if (bytes[i] != other.bytes[i]) return bytes[i] < other.bytes[i];
+        }
+        return false;
+    }
+};
+
+static_assert(sizeof(Hash256) == 32, "Hash256 doit occuper exactement 32 octets");
+
+std::ostream& operator<<(std::ostream& os, const Hash256& h) {
+    return os << h.toHex();
+}
+
+// Pour les tables de hachage : derniers octets (les premiers sont nuls en PoW)
+struct Hash256Hasher {
+    size_t operator()(const Hash256& h) const { return static_cast<size_t>(h.word(3)); }
+};
+
+Hash256 sha256Hash(const void* data, size_t len) {
+    Hash256 h;
+    sha256(data, len, h.data());
+    return h;
+}
+
+Hash256 sha256Hash(const std::string& data) {
+    return sha256Hash(data.data(), data.size());
+}
+
+// Difficulté exprimée en chiffres hexadécimaux nuls : 4 bits par chiffre
+bool startsWithZeros(const Hash256& hash, int difficulty) {
     if (difficulty <= 0) return true;
-    if (static_cast<size_t>(difficulty) > hash.size()) return false;
-    return std::all_of(hash.begin(), hash.begin() + difficulty, [](char c) { return c == '0'; });
+    return hash.leadingZeroBits() >= 4 * difficulty;
+}
+
+// SHA-256 réel (remplace l'ancienne simulation à base de std::hash, dont le
+// résultat variait d'une bibliothèque standard à l'autre). Le nom est conservé
+// pour ne pas toucher aux appels existants.
+std::string sha256_sim(const std::string& input) {
+    uint8_t digest[32];
+    sha256(input.data(), input.size(), digest);
+    return toHex(digest, sizeof(digest));
 }
 
 // ==================================================
-// TRANSACTION
+// CIBLE 256 BITS
+// ==================================================
+// Une cible est un entier de 256 bits (Hash256 lu en big-endian) : un hash est
+// valide s'il est <= cible. Diviser la cible par deux double le travail attendu.
+inline bool meetsTarget(const Hash256& hash, const Hash256& target) {
+    return !(target < hash);
+}
+
+// Cible équivalente à 'digits' chiffres hexadécimaux nuls en tête : 2^(256 - 4d) - 1
+Hash256 targetFromZeroDigits(int digits) {
+    Hash256 t;
+    int zeroBits = std::max(0, std::min(256, 4 * digits));
+    for (int bit = zeroBits; bit < 256; ++bit) t.bytes[bit / 8] |= uint8_t(0x80 >> (bit % 8));
+    return t;
+}
+
+// Cible la plus facile (tous les bits à 1)
+inline Hash256 maxTarget() {
+    return targetFromZeroDigits(0);
+}
+
+// t * num / den sur 256 bits (limbs de 32 bits), saturé à maxTarget() ; résultat >= 1
+Hash256 scaleTarget(const Hash256& t, uint32_t num, uint32_t den) {
+    if (den == 0) throw std::invalid_argument("scaleTarget : dénominateur nul");
+    uint32_t limbs[9] = {}; // limbs[0] = poids fort (débordement)
+    for (int i = 0; i < 8; ++i) limbs[i + 1] = loadBE32(t.data() + 4 * i);
+
+    uint64_t carry = 0;
+    for (int i = 8; i >= 0; --i) {
+        uint64_t v = uint64_t(limbs[i]) * num + carry;
+        limbs[i] = uint32_t(v);
+        carry = v >> 32;
+    }
+    uint64_t rem = 0;
+    for (int i = 0; i <= 8; ++i) {
+        uint64_t v = (rem << 32) | limbs[i];
+        limbs[i] = uint32_t(v / den);
+        rem = v % den;
+    }
+    if (carry != 0 || limbs[0] != 0) return maxTarget();
+
+    Hash256 out;
+    for (int i = 0; i < 8; ++i) {
+        for (int b = 0; b < 4; ++b) out.bytes[4 * i + b] = uint8_t(limbs[i + 1] >> (24 - 8 * b));
+    }
+    if (out.isZero()) out.bytes[31] = 1;
+    return out;
+}
+
+inline double targetToDouble(const Hash256& t) {
+    double v = 0;
+    for (int i = 0; i < 4; ++i) v = v * 18446744073709551616.0 + static_cast<double>(t.word(i));
+    return v;
+}
+
+// Difficulté relative : travail attendu par rapport à la cible la plus facile
+// (16^d pour une cible à d zéros hexadécimaux)
+inline double targetDifficulty(const Hash256& t) {
+    return targetToDouble(maxTarget()) / targetToDouble(t);
+}
+
+// Réajustement de la cible sur une fenêtre glissante des derniers blocs PoW :
+// cible suivante = cible du plus ancien bloc de la fenêtre * (intervalle moyen
+// entre blocs / temps visé), le facteur étant borné à [1/MAX_STEP, MAX_STEP].
+// Chaque mesure n'agit donc qu'à travers la fenêtre, sans effet cumulatif bloc
+// après bloc, et la cible ne dépend que des mesures de la fenêtre.
+class DifficultyRetargeter {
+public:
+    static constexpr uint32_t MAX_STEP = 4;
+    static constexpr uint32_t RATIO_ONE = 1 << 16; // facteur en virgule fixe 16.16
+
+private:
+    struct Sample {
+        double seconds;
+        Hash256 target; // cible sous laquelle le bloc a été miné
+    };
+
+    Hash256 initial;
+    Hash256 current;
+    Hash256 limit; // cible la plus facile admise
+    double blockTime;
+    size_t window;
+    std::deque<Sample> samples;
+    double sampleSum;
+
+    void trim() {
+        while (samples.size() > window) {
+            sampleSum -= samples.front().seconds;
+            samples.pop_front();
+        }
+    }
+
+public:
+    DifficultyRetargeter(const Hash256& initial, double targetSeconds = 0.0, size_t windowBlocks = 10,
+        const Hash256& powLimit = maxTarget())
+        : initial(initial), current(initial), limit(powLimit), blockTime(targetSeconds),
+          window(windowBlocks > 0 ? windowBlocks : 1), sampleSum(0) {}
+
+    // Temps visé <= 0 : cible fixe
+    void configure(double targetSeconds, size_t windowBlocks) {
+        blockTime = targetSeconds;
+        window = windowBlocks > 0 ? windowBlocks : 1;
+        trim();
+    }
+
+    void setTarget(const Hash256& target) { current = target; }
+    const Hash256& target() const { return current; }
+    const Hash256& powLimit() const { return limit; }
+    size_t windowSize() const { return window; }
+
+    // Oublie les mesures (la cible courante est conservée)
+    void reset() {
+        samples.clear();
+        sampleSum = 0;
+    }
+
+    // Retour à l'état de départ : aucune mesure, cible initiale
+    void restart() {
+        reset();
+        current = initial;
+    }
+
+    double targetBlockTime() const { return blockTime; }
+    bool enabled() const { return blockTime > 0; }
+
+    // Facteur appliqué à la cible (16.16) pour un temps moyen donné
+    static uint32_t ratioFor(double averageSeconds, double targetSeconds) {
+        double r = averageSeconds / targetSeconds * RATIO_ONE;
+        r = std::max(r, static_cast<double>(RATIO_ONE / MAX_STEP));
+        r = std::min(r, static_cast<double>(RATIO_ONE * MAX_STEP));
+        return static_cast<uint32_t>(r);
+    }
+
+    // Enregistre le temps mis par un bloc miné sous 'blockTarget' et renvoie la
+    // cible du suivant
+    const Hash256& record(double seconds, const Hash256& blockTarget) {
+        samples.push_back(Sample{ seconds, blockTarget });
+        sampleSum += seconds;
+        trim();
+        if (enabled()) {
+            uint32_t ratio = ratioFor(sampleSum / samples.size(), blockTime);
+            current = scaleTarget(samples.front().target, ratio, RATIO_ONE);
+            if (limit < current) current = limit;
+        }
+        return current;
+    }
+
+    size_t sampleCount() const { return samples.size(); }
+    double averageSeconds() const { return samples.empty() ? 0.0 : sampleSum / samples.size(); }
+};
+
+// ==================================================
+// SHA-256 MULTI-BUFFER (SIMD)
 // ==================================================
-class Transaction {
+// Compresse jusqu'à 8 blocs indépendants à la fois, une voie SIMD par message.
+// Le noyau (AVX2 8 voies, SSE4.1 4 voies ou scalaire) est choisi à l'exécution
+// selon CPUID ; la version scalaire reste disponible partout.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_SIMD_X86 1
+#define SHA256_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define SHA256_SIMD_X86 1
+#define SHA256_TARGET(isa)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#define SHA256_SIMD_X86 0
+#endif
+
+enum class SimdLevel { Scalar, SSE41, AVX2 };
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2: return "AVX2 (8 voies)";
+    case SimdLevel::SSE41: return "SSE4.1 (4 voies)";
+    default: return "scalaire";
+    }
+}
+
+SimdLevel detectSimdLevel() {
+#if SHA256_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::SSE41;
+#elif SHA256_SIMD_X86
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) return SimdLevel::AVX2;
+    }
+    if (sse41) return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+#if SHA256_SIMD_X86
+SHA256_TARGET("sse4.1")
+static void sha256CompressSse41(uint32_t (*states)[8], const uint8_t* const* blocks) {
+#define ROTR4(x, n) _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+    __m128i w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = _mm_set_epi32(int(loadBE32(blocks[3] + 4 * i)), int(loadBE32(blocks[2] + 4 * i)),
+            int(loadBE32(blocks[1] + 4 * i)), int(loadBE32(blocks[0] + 4 * i)));
+    }
+    for (int i = 16; i < 64; ++i) {
+        __m128i s0 = _mm_xor_si128(_mm_xor_si128(ROTR4(w[i - 15], 7), ROTR4(w[i - 15], 18)), _mm_srli_epi32(w[i - 15], 3));
+        __m128i s1 = _mm_xor_si128(_mm_xor_si128(ROTR4(w[i - 2], 17), ROTR4(w[i - 2], 19)), _mm_srli_epi32(w[i - 2], 10));
+        w[i] = _mm_add_epi32(_mm_add_epi32(w[i - 16], s0), _mm_add_epi32(w[i - 7], s1));
+    }
+    __m128i v[8];
+    for (int j = 0; j < 8; ++j) {
+        v[j] = _mm_set_epi32(int(states[3][j]), int(states[2][j]), int(states[1][j]), int(states[0][j]));
+    }
+    __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    for (int i = 0; i < 64; ++i) {
+        __m128i S1 = _mm_xor_si128(_mm_xor_si128(ROTR4(e, 6), ROTR4(e, 11)), ROTR4(e, 25));
+        __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+        __m128i t1 = _mm_add_epi32(_mm_add_epi32(h, S1), _mm_add_epi32(ch, _mm_add_epi32(_mm_set1_epi32(int(SHA256_K[i])), w[i])));
+        __m128i S0 = _mm_xor_si128(_mm_xor_si128(ROTR4(a, 2), ROTR4(a, 13)), ROTR4(a, 22));
+        __m128i maj = _mm_xor_si128(_mm_xor_si128(_mm_and_si128(a, b), _mm_and_si128(a, c)), _mm_and_si128(b, c));
+        __m128i t2 = _mm_add_epi32(S0, maj);
+        h = g; g = f; f = e; e = _mm_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm_add_epi32(t1, t2);
+    }
+    v[0] = _mm_add_epi32(v[0], a); v[1] = _mm_add_epi32(v[1], b);
+    v[2] = _mm_add_epi32(v[2], c); v[3] = _mm_add_epi32(v[3], d);
+    v[4] = _mm_add_epi32(v[4], e); v[5] = _mm_add_epi32(v[5], f);
+    v[6] = _mm_add_epi32(v[6], g); v[7] = _mm_add_epi32(v[7], h);
+    for (int j = 0; j < 8; ++j) {
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v[j]);
+        for (int l = 0; l < 4; ++l) states[l][j] = lanes[l];
+    }
+#undef ROTR4
+}
+
+SHA256_TARGET("avx2")
+static void sha256CompressAvx2(uint32_t (*states)[8], const uint8_t* const* blocks) {
+#define ROTR8(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+    __m256i w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = _mm256_set_epi32(int(loadBE32(blocks[7] + 4 * i)), int(loadBE32(blocks[6] + 4 * i)),
+            int(loadBE32(blocks[5] + 4 * i)), int(loadBE32(blocks[4] + 4 * i)),
+            int(loadBE32(blocks[3] + 4 * i)), int(loadBE32(blocks[2] + 4 * i)),
+            int(loadBE32(blocks[1] + 4 * i)), int(loadBE32(blocks[0] + 4 * i)));
+    }
+    for (int i = 16; i < 64; ++i) {
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(w[i - 15], 7), ROTR8(w[i - 15], 18)), _mm256_srli_epi32(w[i - 15], 3));
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(w[i - 2], 17), ROTR8(w[i - 2], 19)), _mm256_srli_epi32(w[i - 2], 10));
+        w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+    }
+    __m256i v[8];
+    for (int j = 0; j < 8; ++j) {
+        v[j] = _mm256_set_epi32(int(states[7][j]), int(states[6][j]), int(states[5][j]), int(states[4][j]),
+            int(states[3][j]), int(states[2][j]), int(states[1][j]), int(states[0][j]));
+    }
+    __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    for (int i = 0; i < 64; ++i) {
+        __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(e, 6), ROTR8(e, 11)), ROTR8(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1), _mm256_add_epi32(ch, _mm256_add_epi32(_mm256_set1_epi32(int(SHA256_K[i])), w[i])));
+        __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(a, 2), ROTR8(a, 13)), ROTR8(a, 22));
+        __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)), _mm256_and_si256(b, c));
+        __m256i t2 = _mm256_add_epi32(S0, maj);
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+    v[0] = _mm256_add_epi32(v[0], a); v[1] = _mm256_add_epi32(v[1], b);
+    v[2] = _mm256_add_epi32(v[2], c); v[3] = _mm256_add_epi32(v[3], d);
+    v[4] = _mm256_add_epi32(v[4], e); v[5] = _mm256_add_epi32(v[5], f);
+    v[6] = _mm256_add_epi32(v[6], g); v[7] = _mm256_add_epi32(v[7], h);
+    for (int j = 0; j < 8; ++j) {
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v[j]);
+        for (int l = 0; l < 8; ++l) states[l][j] = lanes[l];
+    }
+#undef ROTR8
+}
+#endif
+
+class Sha256MultiBuffer {
 public:
-    std::string id;
-    std::string sender;
-    std::string receiver;
-    double amount;
+    static constexpr size_t MAX_LANES = 8;
+
+    static SimdLevel level() {
+        static const SimdLevel detected = detectSimdLevel();
+        return detected;
+    }
+
+    // Compresse 'count' (<= MAX_LANES) blocs : states[i] absorbe blocks[i]
+    static void compress(uint32_t (*states)[8], const uint8_t* const* blocks, size_t count,
+        SimdLevel lvl = level()) {
+#if SHA256_SIMD_X86
+        if (lvl != SimdLevel::Scalar && count > 1) {
+            // Les voies inutilisées rejouent la voie 0 sur un état jetable
+            uint32_t laneStates[MAX_LANES][8];
+            const uint8_t* laneBlocks[MAX_LANES];
+            for (size_t i = 0; i < MAX_LANES; ++i) {
+                std::memcpy(laneStates[i], states[i < count ? i : 0], sizeof(laneStates[i]));
+                laneBlocks[i] = blocks[i < count ? i : 0];
+            }
+            if (lvl == SimdLevel::AVX2) {
+                sha256CompressAvx2(laneStates, laneBlocks);
+            }
+            else {
+                sha256CompressSse41(laneStates, laneBlocks);
+                if (count > 4) sha256CompressSse41(laneStates + 4, laneBlocks + 4);
+            }
+            for (size_t i = 0; i < count; ++i) std::memcpy(states[i], laneStates[i], sizeof(laneStates[i]));
+            return;
+        }
+#endif
+        (void)lvl;
+        for (size_t i = 0; i < count; ++i) Sha256::compress(states[i], blocks[i]);
+    }
+};
+
+// Hache 'count' messages indépendants de même longueur 'len', par groupes de
+// MAX_LANES messages : digests[i] = SHA-256(messages[i]).
+void sha256Batch(const uint8_t* const* messages, size_t len, uint8_t (*digests)[32], size_t count,
+    SimdLevel lvl = Sha256MultiBuffer::level()) {
+    METRIC_ADD(HashCalls, count);
+    const size_t lanesMax = Sha256MultiBuffer::MAX_LANES;
+    const size_t fullBlocks = len / 64;
+    const size_t rest = len % 64;
+    const size_t tailBlocks = (rest + 9 <= 64) ? 1 : 2;
+    const uint64_t bitLen = uint64_t(len) * 8;
+
+    for (size_t base = 0; base < count; base += lanesMax) {
+        size_t lanes = std::min(lanesMax, count - base);
+        uint32_t states[Sha256MultiBuffer::MAX_LANES][8];
+        const uint8_t* blocks[Sha256MultiBuffer::MAX_LANES];
+        uint8_t tails[Sha256MultiBuffer::MAX_LANES][128];
+
+        for (size_t l = 0; l < lanes; ++l) Sha256::initState(states[l]);
+        for (size_t b = 0; b < fullBlocks; ++b) {
+            for (size_t l = 0; l < lanes; ++l) blocks[l] = messages[base + l] + 64 * b;
+            Sha256MultiBuffer::compress(states, blocks, lanes, lvl);
+        }
+        for (size_t l = 0; l < lanes; ++l) {
+            std::memset(tails[l], 0, sizeof(tails[l]));
+            std::memcpy(tails[l], messages[base + l] + 64 * fullBlocks, rest);
+            tails[l][rest] = 0x80;
+            for (int i = 0; i < 8; ++i) tails[l][64 * tailBlocks - 1 - i] = uint8_t(bitLen >> (8 * i));
+        }
+        for (size_t b = 0; b < tailBlocks; ++b) {
+            for (size_t l = 0; l < lanes; ++l) blocks[l] = tails[l] + 64 * b;
+            Sha256MultiBuffer::compress(states, blocks, lanes, lvl);
+        }
+        for (size_t l = 0; l < lanes; ++l) Sha256::storeDigest(states[l], digests[base + l]);
+    }
+}
+
+// ==================================================
+// POOL DE THREADS
+// ==================================================
+// Pool de threads fixe. parallelFor découpe [0, count) en tranches réclamées
+// via un compteur atomique ; le thread appelant traite aussi des tranches, si
+// bien qu'un parallelFor lancé depuis une tâche du pool ne peut pas bloquer.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    // 0 = un thread par cœur disponible
+    explicit ThreadPool(unsigned threads = 0) : stopping(false) {
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        for (unsigned i = 0; i < threads; ++i) workers.emplace_back(&ThreadPool::run, this);
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        available.notify_one();
+    }
+
+    // body(begin, end) est appelé sur des tranches disjointes d'au plus 'grain' éléments
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        if (grain == 0) grain = 1;
+        size_t chunks = (count + grain - 1) / grain;
+        if (chunks <= 1 || workers.empty()) {
+            if (count > 0) body(0, count);
+            return;
+        }
+
+        // État partagé : les tâches d'aide peuvent démarrer après le retour de l'appelant
+        struct State {
+            std::atomic<size_t> next;
+            size_t done;
+            std::mutex mutex;
+            std::condition_variable finished;
+            State() : next(0), done(0) {}
+        };
+        auto state = std::make_shared<State>();
+        const std::function<void(size_t, size_t)>* bodyPtr = &body;
+        auto work = [state, bodyPtr, count, grain, chunks]() {
+            size_t processed = 0;
+            for (;;) {
+                size_t c = state->next.fetch_add(1);
+                if (c >= chunks) break;
+                (*bodyPtr)(c * grain, std::min(count, (c + 1) * grain));
+                ++processed;
+            }
+            if (processed > 0) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done += processed;
+                if (state->done == chunks) state->finished.notify_all();
+            }
+        };
+
+        size_t helpers = std::min(workers.size(), chunks - 1);
+        for (size_t i = 0; i < helpers; ++i) submit(work);
+        work();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done == chunks; });
+    }
+};
+
+// File bloquante de capacité fixe reliant deux étages d'un pipeline : push
+// attend qu'une place se libère (contre-pression sur l'étage amont), pop attend
+// un élément. Après close(), push échoue et pop vide la file puis renvoie false.
+template <typename T>
+class BoundedQueue {
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+
+public:
+    explicit BoundedQueue(size_t maxItems) : capacity(maxItems > 0 ? maxItems : 1), closed(false) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+};
+
+// ==================================================
+// SÉRIALISATION BINAIRE
+// ==================================================
+// Écriture little-endian, soit à la fin d'un std::vector (taille libre), soit
+// dans un tampon fixe fourni par l'appelant (aucune allocation ; un
+// dépassement lève std::length_error).
+class ByteWriter {
+private:
+    std::vector<uint8_t>* vec;
+    uint8_t* start;
+    uint8_t* cursor;
+    uint8_t* limit;
+
+    uint8_t* reserve(size_t n) {
+        if (vec) {
+            size_t old = vec->size();
+            vec->resize(old + n);
+            return vec->data() + old;
+        }
+        if (static_cast<size_t>(limit - cursor) < n) throw std::length_error("ByteWriter : tampon trop petit");
+        uint8_t* p = cursor;
+        cursor += n;
+        return p;
+    }
+
+    template <class T>
+    void little(T v) {
+        uint8_t* p = reserve(sizeof(T));
+        for (size_t i = 0; i < sizeof(T); ++i) p[i] = uint8_t(static_cast<uint64_t>(v) >> (8 * i));
+    }
+
+public:
+    explicit ByteWriter(std::vector<uint8_t>& buffer) : vec(&buffer), start(nullptr), cursor(nullptr), limit(nullptr) {}
+    ByteWriter(uint8_t* buffer, size_t capacity) : vec(nullptr), start(buffer), cursor(buffer), limit(buffer + capacity) {}
+
+    // Octets écrits (tampon fixe) ou taille totale du vecteur
+    size_t size() const { return vec ? vec->size() : static_cast<size_t>(cursor - start); }
+
+    void u8(uint8_t v) { *reserve(1) = v; }
+    void u16(uint16_t v) { little(v); }
+    void u32(uint32_t v) { little(v); }
+    void u64(uint64_t v) { little(v); }
+    void i64(int64_t v) { little(static_cast<uint64_t>(v)); }
+    void bytes(const uint8_t* p, size_t n) { if (n) std::memcpy(reserve(n), p, n); }
+    void hash(const Hash256& h) { bytes(h.data(), 32); }
+
+    void str8(std::string_view s) {
+        if (s.size() > 0xFF) throw std::length_error("ByteWriter : chaîne trop longue");
+        u8(static_cast<uint8_t>(s.size()));
+        bytes(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    }
+
+    void str16(std::string_view s) {
+        if (s.size() > 0xFFFF) throw std::length_error("ByteWriter : chaîne trop longue");
+        u16(static_cast<uint16_t>(s.size()));
+        bytes(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    }
+};
+
+// Lecture little-endian bornée sur une plage d'octets, sans copie : les chaînes
+// sont rendues comme des vues sur le tampon source. Une lecture hors limites
+// lève std::runtime_error.
+class ByteReader {
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+
+    const uint8_t* take(size_t n) {
+        if (static_cast<size_t>(end - p) < n) throw std::runtime_error("ByteReader : enregistrement tronqué");
+        const uint8_t* r = p;
+        p += n;
+        return r;
+    }
+
+    template <class T>
+    T little() {
+        const uint8_t* b = take(sizeof(T));
+        uint64_t v = 0;
+        for (size_t i = sizeof(T); i-- > 0;) v = (v << 8) | b[i];
+        return static_cast<T>(v);
+    }
+
+public:
+    ByteReader(const uint8_t* data, size_t size) : p(data), end(data + size) {}
+
+    size_t remaining() const { return static_cast<size_t>(end - p); }
+    const uint8_t* position() const { return p; }
+    void skip(size_t n) { take(n); }
+
+    uint8_t u8() { return *take(1); }
+    uint16_t u16() { return little<uint16_t>(); }
+    uint32_t u32() { return little<uint32_t>(); }
+    uint64_t u64() { return little<uint64_t>(); }
+    int64_t i64() { return static_cast<int64_t>(little<uint64_t>()); }
+    const uint8_t* bytes(size_t n) { return take(n); }
+    Hash256 hash() { return Hash256::fromDigest(take(32)); }
+
+    // Vues sur les octets lus (valides tant que le tampon source l'est)
+    std::string_view view8() {
+        uint8_t n = u8();
+        return std::string_view(reinterpret_cast<const char*>(take(n)), n);
+    }
+
+    std::string_view view16() {
+        uint16_t n = u16();
+        return std::string_view(reinterpret_cast<const char*>(take(n)), n);
+    }
+
+    std::string str16() { return std::string(view16()); }
+};
+
+// ==================================================
+// SIGNATURES (Ed25519)
+// ==================================================
+// Ed25519 (RFC 8032) autonome : SHA-512, corps GF(2^255 - 19), courbe d'Edwards
+// tordue en coordonnées étendues et scalaires modulo l. Le code n'est pas à
+// temps constant (fenêtres glissantes, branches sur les chiffres des scalaires) :
+// il vise le débit de vérification, pas la protection de vraies clés privées.
+static const uint64_t SHA512_K[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
+    0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
+    0xd807aa98a3030242, 0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+    0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235, 0xc19bf174cf692694,
+    0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+    0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4,
+    0xc6e00bf33da88fc2, 0xd5a79147930aa725, 0x06ca6351e003826f, 0x142929670a0e6e70,
+    0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+    0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30,
+    0xd192e819d6ef5218, 0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+    0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
+    0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
+    0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b,
+    0xca273eceea26619c, 0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
+    0x06f067aa72176fba, 0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+    0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
+    0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+};
+
+static inline uint64_t loadLE64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline void storeLE64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+
+// SHA-512 (FIPS 180-4), même interface que Sha256 ; seul Ed25519 l'utilise
+class Sha512 {
+private:
+    uint64_t state[8];
+    uint8_t buffer[128];
+    size_t bufferLen;
+    uint64_t totalLen;
+
+    static uint64_t rotr(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+    static void compress(uint64_t st[8], const uint8_t block[128]) {
+        uint64_t w[80];
+        for (int i = 0; i < 16; ++i) w[i] = loadBE64(block + 8 * i);
+        for (int i = 16; i < 80; ++i) {
+            uint64_t s0 = rotr(w[i - 15], 1) ^ rotr(w[i - 15], 8) ^ (w[i - 15] >> 7);
+            uint64_t s1 = rotr(w[i - 2], 19) ^ rotr(w[i - 2], 61) ^ (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint64_t a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+        for (int i = 0; i < 80; ++i) {
+            uint64_t S1 = rotr(e, 14) ^ rotr(e, 18) ^ rotr(e, 41);
+            uint64_t ch = (e & f) ^ (~e & g);
+            uint64_t t1 = h + S1 + ch + SHA512_K[i] + w[i];
+            uint64_t S0 = rotr(a, 28) ^ rotr(a, 34) ^ rotr(a, 39);
+            uint64_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint64_t t2 = S0 + maj;
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        st[0] += a; st[1] += b; st[2] += c; st[3] += d;
+        st[4] += e; st[5] += f; st[6] += g; st[7] += h;
+    }
+
+public:
+    Sha512() { reset(); }
+
+    void reset() {
+        static const uint64_t init[8] = {
+            0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+        };
+        std::memcpy(state, init, sizeof(init));
+        bufferLen = 0;
+        totalLen = 0;
+    }
+
+    void update(const uint8_t* data, size_t len) {
+        totalLen += len;
+        if (bufferLen > 0) {
+            size_t take = std::min(len, 128 - bufferLen);
+            std::memcpy(buffer + bufferLen, data, take);
+            bufferLen += take;
+            data += take;
+            len -= take;
+            if (bufferLen < 128) return;
+            compress(state, buffer);
+            bufferLen = 0;
+        }
+        while (len >= 128) {
+            compress(state, data);
+            data += 128;
+            len -= 128;
+        }
+        std::memcpy(buffer, data, len);
+        bufferLen = len;
+    }
+
+    // Longueur en bits sur 128 bits : les 64 bits de poids fort restent nuls ici
+    void final(uint8_t out[64]) {
+        uint64_t bitLen = totalLen * 8;
+        buffer[bufferLen++] = 0x80;
+        if (bufferLen > 112) {
+            std::memset(buffer + bufferLen, 0, 128 - bufferLen);
+            compress(state, buffer);
+            bufferLen = 0;
+        }
+        std::memset(buffer + bufferLen, 0, 120 - bufferLen);
+        for (int i = 0; i < 8; ++i) buffer[120 + i] = uint8_t(bitLen >> (56 - 8 * i));
+        compress(state, buffer);
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) out[8 * i + j] = uint8_t(state[i] >> (56 - 8 * j));
+        }
+    }
+};
+
+void sha512(const void* data, size_t len, uint8_t out[64]) {
+    Sha512 ctx;
+    ctx.update(static_cast<const uint8_t*>(data), len);
+    ctx.final(out);
+}
+
+// Produits 64 x 64 -> 128 bits : entier natif (GCC, Clang) ou repli portable
+#if defined(__SIZEOF_INT128__) && !defined(ED25519_PORTABLE_WIDE)
+typedef unsigned __int128 WideUInt;
+
+static inline WideUInt mulWide(uint64_t a, uint64_t b) { return static_cast<WideUInt>(a) * b; }
+#else
+struct WideUInt {
+    uint64_t lo, hi;
+
+    WideUInt(uint64_t v = 0) : lo(v), hi(0) {}
+
+    WideUInt& operator+=(const WideUInt& o) {
+        lo += o.lo;
+        hi += o.hi + (lo < o.lo ? 1 : 0);
+        return *this;
+    }
+
+    friend WideUInt operator+(WideUInt a, const WideUInt& b) { return a += b; }
+
+    WideUInt operator>>(int n) const {
+        WideUInt r;
+        if (n >= 64) {
+            r.lo = hi >> (n - 64);
+            r.hi = 0;
+        }
+        else {
+            r.lo = (lo >> n) | (hi << (64 - n));
+            r.hi = hi >> n;
+        }
+        return r;
+    }
+
+    explicit operator uint64_t() const { return lo; }
+};
+
+static inline WideUInt mulWide(uint64_t a, uint64_t b) {
+    uint64_t a0 = a & 0xFFFFFFFF, a1 = a >> 32, b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t middle = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+    WideUInt r;
+    r.lo = (middle << 32) | (p00 & 0xFFFFFFFF);
+    r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+    return r;
+}
+#endif
+
+// Élément de GF(2^255 - 19) : cinq limbes de 51 bits. Chaque opération se
+// termine par une propagation de retenue (limbes < 2^52), sans réduction
+// complète : seul toBytes produit la forme canonique.
+struct FieldElement {
+    static constexpr uint64_t MASK = (uint64_t(1) << 51) - 1;
+
+    uint64_t v[5];
+
+    static FieldElement fromU64(uint64_t x) {
+        FieldElement f = { { x & MASK, x >> 51, 0, 0, 0 } };
+        return f;
+    }
+
+    // Le bit 255 est ignoré (signe de x dans l'encodage des points)
+    static FieldElement fromBytes(const uint8_t in[32]) {
+        uint64_t w0 = loadLE64(in), w1 = loadLE64(in + 8), w2 = loadLE64(in + 16), w3 = loadLE64(in + 24);
+        FieldElement f = { {
+            w0 & MASK,
+            ((w0 >> 51) | (w1 << 13)) & MASK,
+            ((w1 >> 38) | (w2 << 26)) & MASK,
+            ((w2 >> 25) | (w3 << 39)) & MASK,
+            (w3 >> 12) & MASK
+        } };
+        return f;
+    }
+
+    static FieldElement carried(uint64_t h0, uint64_t h1, uint64_t h2, uint64_t h3, uint64_t h4) {
+        h1 += h0 >> 51; h0 &= MASK;
+        h2 += h1 >> 51; h1 &= MASK;
+        h3 += h2 >> 51; h2 &= MASK;
+        h4 += h3 >> 51; h3 &= MASK;
+        h0 += 19 * (h4 >> 51); h4 &= MASK;
+        h1 += h0 >> 51; h0 &= MASK;
+        FieldElement f = { { h0, h1, h2, h3, h4 } };
+        return f;
+    }
+
+    static FieldElement reduceWide(WideUInt r0, WideUInt r1, WideUInt r2, WideUInt r3, WideUInt r4) {
+        r1 += r0 >> 51;
+        r2 += r1 >> 51;
+        r3 += r2 >> 51;
+        r4 += r3 >> 51;
+        uint64_t h0 = static_cast<uint64_t>(r0) & MASK;
+        uint64_t h1 = static_cast<uint64_t>(r1) & MASK;
+        uint64_t h2 = static_cast<uint64_t>(r2) & MASK;
+        uint64_t h3 = static_cast<uint64_t>(r3) & MASK;
+        uint64_t h4 = static_cast<uint64_t>(r4) & MASK;
+        h0 += 19 * static_cast<uint64_t>(r4 >> 51);
+        h1 += h0 >> 51; h0 &= MASK;
+        FieldElement f = { { h0, h1, h2, h3, h4 } };
+        return f;
+    }
+
+    FieldElement operator+(const FieldElement& o) const {
+        return carried(v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3], v[4] + o.v[4]);
+    }
+
+    // a + 2p - b : reste positif tant que les limbes de b sont < 2^52 - 38
+    FieldElement operator-(const FieldElement& o) const {
+        const uint64_t twoP0 = 0xFFFFFFFFFFFDA, twoP = 0xFFFFFFFFFFFFE;
+        return carried(v[0] + twoP0 - o.v[0], v[1] + twoP - o.v[1], v[2] + twoP - o.v[2], v[3] + twoP - o.v[3],
+            v[4] + twoP - o.v[4]);
+    }
+
+    FieldElement operator-() const { return fromU64(0) - *this; }
+
+    FieldElement operator*(const FieldElement& o) const {
+        const uint64_t* f = v;
+        const uint64_t* g = o.v;
+        uint64_t g1 = 19 * g[1], g2 = 19 * g[2], g3 = 19 * g[3], g4 = 19 * g[4];
+        WideUInt r0 = mulWide(f[0], g[0]) + mulWide(f[1], g4) + mulWide(f[2], g3) + mulWide(f[3], g2) + mulWide(f[4], g1);
+        WideUInt r1 = mulWide(f[0], g[1]) + mulWide(f[1], g[0]) + mulWide(f[2], g4) + mulWide(f[3], g3) + mulWide(f[4], g2);
+        WideUInt r2 = mulWide(f[0], g[2]) + mulWide(f[1], g[1]) + mulWide(f[2], g[0]) + mulWide(f[3], g4) + mulWide(f[4], g3);
+        WideUInt r3 = mulWide(f[0], g[3]) + mulWide(f[1], g[2]) + mulWide(f[2], g[1]) + mulWide(f[3], g[0]) + mulWide(f[4], g4);
+        WideUInt r4 = mulWide(f[0], g[4]) + mulWide(f[1], g[3]) + mulWide(f[2], g[2]) + mulWide(f[3], g[1]) + mulWide(f[4], g[0]);
+        return reduceWide(r0, r1, r2, r3, r4);
+    }
+
+    FieldElement squared() const {
+        uint64_t f0 = v[0], f1 = v[1], f2 = v[2], f3 = v[3], f4 = v[4];
+        uint64_t f0x2 = 2 * f0, f1x2 = 2 * f1, f2x2 = 2 * f2, f3x2 = 2 * f3;
+        uint64_t f3x19 = 19 * f3, f4x19 = 19 * f4;
+        WideUInt r0 = mulWide(f0, f0) + mulWide(f1x2, f4x19) + mulWide(f2x2, f3x19);
+        WideUInt r1 = mulWide(f0x2, f1) + mulWide(f2x2, f4x19) + mulWide(f3, f3x19);
+        WideUInt r2 = mulWide(f0x2, f2) + mulWide(f1, f1) + mulWide(f3x2, f4x19);
+        WideUInt r3 = mulWide(f0x2, f3) + mulWide(f1x2, f2) + mulWide(f4, f4x19);
+        WideUInt r4 = mulWide(f0x2, f4) + mulWide(f1x2, f3) + mulWide(f2, f2);
+        return reduceWide(r0, r1, r2, r3, r4);
+    }
+
+    FieldElement squaredTimes(int n) const {
+        FieldElement r = *this;
+        for (int i = 0; i < n; ++i) r = r.squared();
+        return r;
+    }
+
+    // z^(2^250 - 1) et z^11, base commune de l'inverse et de la racine carrée
+    void powChain(FieldElement& z250, FieldElement& z11) const {
+        FieldElement z2 = squared();
+        FieldElement z9 = z2.squaredTimes(2) * *this;
+        z11 = z9 * z2;
+        FieldElement z5 = z11.squared() * z9;               // 2^5 - 1
+        FieldElement z10 = z5.squaredTimes(5) * z5;         // 2^10 - 1
+        FieldElement z20 = z10.squaredTimes(10) * z10;
+        FieldElement z40 = z20.squaredTimes(20) * z20;
+        FieldElement z50 = z40.squaredTimes(10) * z10;
+        FieldElement z100 = z50.squaredTimes(50) * z50;
+        FieldElement z200 = z100.squaredTimes(100) * z100;
+        z250 = z200.squaredTimes(50) * z50;
+    }
+
+    // z^(p - 2) = z^(2^255 - 21)
+    FieldElement inverse() const {
+        FieldElement z250, z11;
+        powChain(z250, z11);
+        return z250.squaredTimes(5) * z11;
+    }
+
+    // z^((p - 5) / 8) = z^(2^252 - 3), pour la racine carrée de la décompression
+    FieldElement pow22523() const {
+        FieldElement z250, z11;
+        powChain(z250, z11);
+        return z250.squaredTimes(2) * *this;
+    }
+
+    void toBytes(uint8_t out[32]) const {
+        uint64_t t[5] = { v[0], v[1], v[2], v[3], v[4] };
+        auto carry = [&t]() {
+            for (int i = 0; i < 4; ++i) {
+                t[i + 1] += t[i] >> 51;
+                t[i] &= MASK;
+            }
+            t[0] += 19 * (t[4] >> 51);
+            t[4] &= MASK;
+        };
+        carry();
+        carry();
+        // t < 2^255 : soustraire p si t >= p (t + 19 déborde alors de 2^255)
+        t[0] += 19;
+        carry();
+        t[0] += (uint64_t(1) << 51) - 19;
+        for (int i = 1; i < 5; ++i) t[i] += (uint64_t(1) << 51) - 1;
+        for (int i = 0; i < 4; ++i) {
+            t[i + 1] += t[i] >> 51;
+            t[i] &= MASK;
+        }
+        t[4] &= MASK;
+        storeLE64(out, t[0] | (t[1] << 51));
+        storeLE64(out + 8, (t[1] >> 13) | (t[2] << 38));
+        storeLE64(out + 16, (t[2] >> 26) | (t[3] << 25));
+        storeLE64(out + 24, (t[3] >> 39) | (t[4] << 12));
+    }
+
+    bool isZero() const {
+        uint8_t b[32];
+        toBytes(b);
+        uint8_t acc = 0;
+        for (uint8_t x : b) acc |= x;
+        return acc == 0;
+    }
+
+    bool isNegative() const {
+        uint8_t b[32];
+        toBytes(b);
+        return (b[0] & 1) != 0;
+    }
+};
+
+// Point de -x^2 + y^2 = 1 + d x^2 y^2 en coordonnées étendues :
+// x = X/Z, y = Y/Z, xy = T/Z
+struct EdPoint {
+    FieldElement X, Y, Z, T;
+
+    static EdPoint identity() {
+        EdPoint p = { FieldElement::fromU64(0), FieldElement::fromU64(1), FieldElement::fromU64(1), FieldElement::fromU64(0) };
+        return p;
+    }
+
+    EdPoint operator-() const {
+        EdPoint p = { -X, Y, Z, -T };
+        return p;
+    }
+};
+
+// Opérande précalculé d'une addition : (Y + X, Y - X, 2Z, 2dT)
+struct EdCached {
+    FieldElement yPlusX, yMinusX, z2, t2d;
+};
+
+class Ed25519 {
+public:
+    static const FieldElement& d() {
+        static const FieldElement value = -(FieldElement::fromU64(121665) * FieldElement::fromU64(121666).inverse());
+        return value;
+    }
+
+    static const FieldElement& d2() {
+        static const FieldElement value = d() + d();
+        return value;
+    }
+
+    // 2^((p - 1) / 4), racine carrée de -1
+    static const FieldElement& sqrtMinusOne() {
+        static const FieldElement value = FieldElement::fromU64(2).pow22523().squared() * FieldElement::fromU64(2);
+        return value;
+    }
+
+    static EdCached cached(const EdPoint& p) {
+        EdCached c = { p.Y + p.X, p.Y - p.X, p.Z + p.Z, p.T * d2() };
+        return c;
+    }
+
+    // add-2008-hwcd-3 : 8 multiplications
+    static EdPoint add(const EdPoint& p, const EdCached& q) {
+        FieldElement a = (p.Y - p.X) * q.yMinusX;
+        FieldElement b = (p.Y + p.X) * q.yPlusX;
+        FieldElement c = p.T * q.t2d;
+        FieldElement dd = p.Z * q.z2;
+        FieldElement e = b - a, f = dd - c, g = dd + c, h = b + a;
+        EdPoint r = { e * f, g * h, f * g, e * h };
+        return r;
+    }
+
+    static EdPoint sub(const EdPoint& p, const EdCached& q) {
+        EdCached neg = { q.yMinusX, q.yPlusX, q.z2, -q.t2d };
+        return add(p, neg);
+    }
+
+    // dbl-2008-hwcd (a = -1) : 4 multiplications et 4 carrés
+    static EdPoint dbl(const EdPoint& p) {
+        FieldElement a = p.X.squared();
+        FieldElement b = p.Y.squared();
+        FieldElement c = p.Z.squared();
+        c = c + c;
+        FieldElement h = a + b;
+        FieldElement e = h - (p.X + p.Y).squared();
+        FieldElement g = a - b;
+        FieldElement f = c + g;
+        // Pour a = -1 : X3 = E*F, Y3 = G*H, T3 = E*H, Z3 = F*G avec G = B - A, F = G - C, H = -(A + B)
+        EdPoint r = { e * f, g * h, f * g, e * h };
+        return r;
+    }
+
+    static bool isIdentity(const EdPoint& p) {
+        return p.X.isZero() && (p.Y - p.Z).isZero();
+    }
+
+    static void encode(const EdPoint& p, uint8_t out[32]) {
+        FieldElement zInv = p.Z.inverse();
+        FieldElement x = p.X * zInv, y = p.Y * zInv;
+        y.toBytes(out);
+        if (x.isNegative()) out[31] |= 0x80;
+    }
+
+    // Décompression (RFC 8032, 5.1.3) : y canonique, x = ±sqrt((y^2 - 1) / (d y^2 + 1))
+    static bool decode(const uint8_t in[32], EdPoint& out) {
+        FieldElement y = FieldElement::fromBytes(in);
+        uint8_t canonical[32];
+        y.toBytes(canonical);
+        canonical[31] |= in[31] & 0x80;
+        if (std::memcmp(canonical, in, 32) != 0) return false;
+
+        FieldElement one = FieldElement::fromU64(1);
+        FieldElement y2 = y.squared();
+        FieldElement u = y2 - one;
+        FieldElement v = d() * y2 + one;
+        FieldElement v3 = v.squared() * v;
+        FieldElement x = u * v3 * (u * v3.squared() * v).pow22523();
+        FieldElement vx2 = v * x.squared();
+        if (!(vx2 - u).isZero()) {
+            if (!(vx2 + u).isZero()) return false;
+            x = x * sqrtMinusOne();
+        }
+        bool negative = (in[31] & 0x80) != 0;
+        if (x.isZero() && negative) return false;
+        if (x.isNegative() != negative) x = -x;
+        out.X = x;
+        out.Y = y;
+        out.Z = one;
+        out.T = x * y;
+        return true;
+    }
+
+    static const EdPoint& basePoint() {
+        static const EdPoint point = []() {
+            uint8_t encoded[32];
+            std::memset(encoded, 0x66, sizeof(encoded));
+            encoded[0] = 0x58;
+            EdPoint p;
+            decode(encoded, p);
+            return p;
+        }();
+        return point;
+    }
+
+    // Multiples impairs P, 3P, ..., 15P pour les fenêtres glissantes
+    static void oddMultiples(const EdPoint& p, EdCached table[8]) {
+        EdCached twice = cached(dbl(p));
+        EdPoint current = p;
+        table[0] = cached(current);
+        for (int i = 1; i < 8; ++i) {
+            current = add(current, twice);
+            table[i] = cached(current);
+        }
+    }
+
+    static const EdCached* baseOddMultiples() {
+        static const std::array<EdCached, 8> table = []() {
+            std::array<EdCached, 8> t;
+            oddMultiples(basePoint(), t.data());
+            return t;
+        }();
+        return table.data();
+    }
+
+    // Chiffres impairs dans [-15, 15], au plus un non nul par fenêtre de 5 bits
+    static void slidingDigits(const uint8_t scalar[32], int8_t digits[256]) {
+        for (int i = 0; i < 256; ++i) digits[i] = int8_t((scalar[i >> 3] >> (i & 7)) & 1);
+        for (int i = 0; i < 256; ++i) {
+            if (!digits[i]) continue;
+            for (int b = 1; b <= 6 && i + b < 256; ++b) {
+                if (!digits[i + b]) continue;
+                int shifted = digits[i + b] << b;
+                if (digits[i] + shifted <= 15) {
+                    digits[i] = int8_t(digits[i] + shifted);
+                    digits[i + b] = 0;
+                }
+                else if (digits[i] - shifted >= -15) {
+                    digits[i] = int8_t(digits[i] - shifted);
+                    for (int k = i + b; k < 256; ++k) {
+                        if (!digits[k]) {
+                            digits[k] = 1;
+                            break;
+                        }
+                        digits[k] = 0;
+                    }
+                }
+                else {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Somme des scalars[i] * P_i par la méthode de Straus : doublements partagés,
+    // une table de multiples impairs par point
+    static EdPoint straus(const EdCached* const* tables, const uint8_t* const* scalars, size_t count) {
+        std::vector<int8_t> digits(count * 256);
+        int top = -1;
+        for (size_t i = 0; i < count; ++i) {
+            slidingDigits(scalars[i], &digits[i * 256]);
+            for (int b = 255; b > top; --b) {
+                if (digits[i * 256 + b]) {
+                    top = b;
+                    break;
+                }
+            }
+        }
+        EdPoint r = EdPoint::identity();
+        for (int b = top; b >= 0; --b) {
+            r = dbl(r);
+            for (size_t i = 0; i < count; ++i) {
+                int digit = digits[i * 256 + b];
+                if (digit > 0) r = add(r, tables[i][digit / 2]);
+                else if (digit < 0) r = sub(r, tables[i][-digit / 2]);
+            }
+        }
+        return r;
+    }
+
+    // Table du point de base : baseTable()[8i + j] = (j + 1) * 256^i * B
+    static const EdCached* baseTable() {
+        static const std::vector<EdCached> table = []() {
+            std::vector<EdCached> t(32 * 8);
+            EdPoint p = basePoint();
+            for (int i = 0; i < 32; ++i) {
+                EdCached step = cached(p);
+                EdPoint multiple = p;
+                for (int j = 0; j < 8; ++j) {
+                    t[8 * i + j] = cached(multiple);
+                    multiple = add(multiple, step);
+                }
+                for (int k = 0; k < 8; ++k) p = dbl(p);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // scalar * B en base 16 signée (64 chiffres dans [-8, 8]) : 64 additions et
+    // 4 doublements. Le scalaire doit être < 2^255.
+    static EdPoint mulBase(const uint8_t scalar[32]) {
+        int e[64];
+        for (int i = 0; i < 32; ++i) {
+            e[2 * i] = scalar[i] & 15;
+            e[2 * i + 1] = scalar[i] >> 4;
+        }
+        int carry = 0;
+        for (int i = 0; i < 63; ++i) {
+            e[i] += carry;
+            carry = (e[i] + 8) >> 4;
+            e[i] -= carry << 4;
+        }
+        e[63] += carry;
+        const EdCached* table = baseTable();
+        EdPoint r = EdPoint::identity();
+        auto addDigit = [&](int i) {
+            if (e[i] > 0) r = add(r, table[8 * (i / 2) + e[i] - 1]);
+            else if (e[i] < 0) r = sub(r, table[8 * (i / 2) - e[i] - 1]);
+        };
+        for (int i = 1; i < 64; i += 2) addDigit(i);
+        for (int k = 0; k < 4; ++k) r = dbl(r);
+        for (int i = 0; i < 64; i += 2) addDigit(i);
+        return r;
+    }
+};
+
+// Scalaire modulo l = 2^252 + 27742317777372353535851937790883648493 (mots little-endian)
+struct EdScalar {
+    static constexpr uint64_t L[4] = { 0x5812631a5cf5d3ed, 0x14def9dea2f79cd6, 0, 0x1000000000000000 };
+
+    uint64_t v[4];
+
+    static EdScalar zero() {
+        EdScalar s = { { 0, 0, 0, 0 } };
+        return s;
+    }
+
+    static EdScalar fromBytes(const uint8_t in[32]) {
+        EdScalar s = { { loadLE64(in), loadLE64(in + 8), loadLE64(in + 16), loadLE64(in + 24) } };
+        return s;
+    }
+
+    void toBytes(uint8_t out[32]) const {
+        for (int i = 0; i < 4; ++i) storeLE64(out + 8 * i, v[i]);
+    }
+
+    bool isCanonical() const {
+        for (int i = 3; i >= 0; --i) {
+            if (v[i] != L[i]) return v[i] < L[i];
+        }
+        return false;
+    }
+
+    bool isZero() const { return (v[0] | v[1] | v[2] | v[3]) == 0; }
+
+    // r -= m * l (r sur 5 mots, résultat positif par construction)
+    static void subtractMultiple(uint64_t r[5], uint64_t m) {
+        uint64_t carry = 0, borrow = 0;
+        for (int i = 0; i < 5; ++i) {
+            WideUInt product = mulWide(m, i < 4 ? L[i] : 0) + WideUInt(carry);
+            uint64_t lo = static_cast<uint64_t>(product);
+            carry = static_cast<uint64_t>(product >> 64);
+            uint64_t before = r[i];
+            r[i] = before - lo - borrow;
+            borrow = (before < lo || (before == lo && borrow)) ? 1 : 0;
+        }
+    }
+
+    // Réduction d'un entier de 512 bits, 32 bits à la fois : r < 2^285, q = r / 2^252
+    // et r - (q - 1) l tombe dans [0, 2l)
+    static EdScalar reduceWide(const uint64_t x[8]) {
+        uint64_t r[5] = { 0, 0, 0, 0, 0 };
+        for (int w = 15; w >= 0; --w) {
+            uint64_t word = (x[w / 2] >> (32 * (w & 1))) & 0xFFFFFFFF;
+            for (int i = 4; i > 0; --i) r[i] = (r[i] << 32) | (r[i - 1] >> 32);
+            r[0] = (r[0] << 32) | word;
+            uint64_t q = (r[3] >> 60) | (r[4] << 4);
+            if (q > 1) subtractMultiple(r, q - 1);
+            bool geq = r[4] != 0;
+            if (!geq) {
+                geq = true;
+                for (int i = 3; i >= 0; --i) {
+                    if (r[i] != L[i]) {
+                        geq = r[i] > L[i];
+                        break;
+                    }
+                }
+            }
+            if (geq) subtractMultiple(r, 1);
+        }
+        EdScalar s = { { r[0], r[1], r[2], r[3] } };
+        return s;
+    }
+
+    static EdScalar fromDigest(const uint8_t digest[64]) {
+        uint64_t x[8];
+        for (int i = 0; i < 8; ++i) x[i] = loadLE64(digest + 8 * i);
+        return reduceWide(x);
+    }
+
+    // a * b + c mod l
+    static EdScalar mulAdd(const EdScalar& a, const EdScalar& b, const EdScalar& c) {
+        uint64_t x[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        for (int i = 0; i < 4; ++i) {
+            uint64_t carry = 0;
+            for (int j = 0; j < 4; ++j) {
+                WideUInt t = mulWide(a.v[i], b.v[j]) + WideUInt(x[i + j]) + WideUInt(carry);
+                x[i + j] = static_cast<uint64_t>(t);
+                carry = static_cast<uint64_t>(t >> 64);
+            }
+            x[i + 4] = carry;
+        }
+        uint64_t carry = 0;
+        for (int k = 0; k < 8; ++k) {
+            WideUInt t = WideUInt(x[k]) + WideUInt(k < 4 ? c.v[k] : 0) + WideUInt(carry);
+            x[k] = static_cast<uint64_t>(t);
+            carry = static_cast<uint64_t>(t >> 64);
+        }
+        return reduceWide(x);
+    }
+
+    EdScalar negated() const {
+        if (isZero()) return *this;
+        EdScalar s;
+        uint64_t borrow = 0;
+        for (int i = 0; i < 4; ++i) {
+            s.v[i] = L[i] - v[i] - borrow;
+            borrow = (L[i] < v[i] || (L[i] == v[i] && borrow)) ? 1 : 0;
+        }
+        return s;
+    }
+};
+
+struct PublicKey {
+    std::array<uint8_t, 32> bytes;
+
+    bool operator==(const PublicKey& o) const { return bytes == o.bytes; }
+    bool operator!=(const PublicKey& o) const { return bytes != o.bytes; }
+    std::string toHex() const { return ::toHex(bytes.data(), bytes.size()); }
+};
+
+// R (point encodé) || S (scalaire < l)
+struct Signature {
+    std::array<uint8_t, 64> bytes;
+
+    bool operator==(const Signature& o) const { return bytes == o.bytes; }
+};
+
+// k = SHA-512(R || A || M) mod l
+inline EdScalar challengeScalar(const uint8_t r[32], const PublicKey& key, const uint8_t* message, size_t len) {
+    Sha512 ctx;
+    ctx.update(r, 32);
+    ctx.update(key.bytes.data(), key.bytes.size());
+    ctx.update(message, len);
+    uint8_t digest[64];
+    ctx.final(digest);
+    return EdScalar::fromDigest(digest);
+}
+
+// Paire de clés dérivée d'une graine de 32 octets (RFC 8032, 5.1.5)
+class KeyPair {
+private:
+    EdScalar secret;  // scalaire "clampé", réduit modulo l
+    uint8_t prefix[32];
+    PublicKey publicKeyBytes;
+
+public:
+    explicit KeyPair(const uint8_t seed[32]) {
+        uint8_t h[64];
+        sha512(seed, 32, h);
+        h[0] &= 248;
+        h[31] &= 127;
+        h[31] |= 64;
+        uint64_t wide[8] = { loadLE64(h), loadLE64(h + 8), loadLE64(h + 16), loadLE64(h + 24), 0, 0, 0, 0 };
+        secret = EdScalar::reduceWide(wide);
+        std::memcpy(prefix, h + 32, 32);
+        uint8_t a[32];
+        secret.toBytes(a);
+        Ed25519::encode(Ed25519::mulBase(a), publicKeyBytes.bytes.data());
+    }
+
+    const PublicKey& publicKey() const { return publicKeyBytes; }
+
+    Signature sign(const uint8_t* message, size_t len) const {
+        uint8_t digest[64];
+        Sha512 ctx;
+        ctx.update(prefix, sizeof(prefix));
+        ctx.update(message, len);
+        ctx.final(digest);
+        EdScalar r = EdScalar::fromDigest(digest);
+        uint8_t rBytes[32];
+        r.toBytes(rBytes);
+        Signature sig;
+        Ed25519::encode(Ed25519::mulBase(rBytes), sig.bytes.data());
+        EdScalar k = challengeScalar(sig.bytes.data(), publicKeyBytes, message, len);
+        EdScalar::mulAdd(k, secret, r).toBytes(sig.bytes.data() + 32);
+        return sig;
+    }
+};
+
+// Clé publique décompressée une fois pour toutes : -A et ses multiples impairs,
+// réutilisés par chaque vérification
+class VerifyingKey {
+private:
+    PublicKey encoded;
+    bool decoded;
+    EdPoint negA;
+    EdCached negTable[8];
+
+    friend class SignatureBatch;
+
+public:
+    VerifyingKey() : decoded(false) {}
+
+    explicit VerifyingKey(const PublicKey& key) : encoded(key), decoded(false) {
+        EdPoint a;
+        if (!Ed25519::decode(key.bytes.data(), a)) return;
+        negA = -a;
+        Ed25519::oddMultiples(negA, negTable);
+        decoded = true;
+    }
+
+    bool valid() const { return decoded; }
+    const PublicKey& publicKey() const { return encoded; }
+
+    // Équation cofactorisée [8]([S]B - [k]A - R) = 0, la même que celle de la
+    // vérification par lot : les deux acceptent exactement les mêmes signatures
+    bool verify(const uint8_t* message, size_t len, const Signature& sig) const {
+        if (!decoded) return false;
+        EdScalar s = EdScalar::fromBytes(sig.bytes.data() + 32);
+        EdPoint r;
+        if (!s.isCanonical() || !Ed25519::decode(sig.bytes.data(), r)) return false;
+        uint8_t k[32];
+        challengeScalar(sig.bytes.data(), encoded, message, len).toBytes(k);
+        const EdCached* tables[2] = { Ed25519::baseOddMultiples(), negTable };
+        const uint8_t* scalars[2] = { sig.bytes.data() + 32, k };
+        EdPoint check = Ed25519::sub(Ed25519::straus(tables, scalars, 2), Ed25519::cached(r));
+        for (int i = 0; i < 3; ++i) check = Ed25519::dbl(check);
+        return Ed25519::isIdentity(check);
+    }
+};
+
+// Vérification par lot : avec des coefficients z_i aléatoires de 128 bits,
+//   [8]( [sum z_i S_i] B - sum [z_i] R_i - sum_A [sum_{i : A} z_i k_i] A ) = 0
+// Une seule multi-multiplication scalaire remplace n doubles multiplications ;
+// les signatures d'une même clé partagent un seul terme en A. Un lot contenant
+// une signature invalide est refusé sauf avec probabilité ~2^-128, sans
+// indiquer laquelle.
+class SignatureBatch {
+private:
+    static constexpr size_t STRAUS_MAX_POINTS = 64;
+
+    std::vector<EdPoint> negR;
+    std::vector<EdScalar> s;
+    std::vector<EdScalar> k;
+    std::vector<const VerifyingKey*> keys;
+    bool malformed;
+
+    static uint64_t windowBits(const EdScalar& x, int pos, int width) {
+        int word = pos / 64, shift = pos % 64;
+        if (word >= 4) return 0;
+        uint64_t bits = x.v[word] >> shift;
+        if (shift + width > 64 && word + 1 < 4) bits |= x.v[word + 1] << (64 - shift);
+        return bits & ((uint64_t(1) << width) - 1);
+    }
+
+    // Méthode de Pippenger à chiffres signés : pour chaque fenêtre de c bits, les
+    // points sont rangés dans 2^(c-1) seaux puis les seaux sont sommés par
+    // sommes partielles. Coût ~ (253 / c) * (n + 2^c) additions au lieu de ~n * 50.
+    static EdPoint pippenger(const std::vector<EdCached>& points, const std::vector<EdScalar>& scalars) {
+        size_t n = points.size();
+        int width = 2;
+        double bestCost = 0;
+        for (int c = 2; c <= 16; ++c) {
+            double cost = std::ceil(253.0 / c) * (static_cast<double>(n) + std::ldexp(1.0, c));
+            if (c == 2 || cost < bestCost) {
+                bestCost = cost;
+                width = c;
+            }
+        }
+        const int windows = (253 + width - 1) / width + 1;
+        const int64_t full = int64_t(1) << width, half = full / 2;
+        std::vector<int16_t> digits(static_cast<size_t>(windows) * n);
+        for (size_t i = 0; i < n; ++i) {
+            int64_t carry = 0;
+            for (int w = 0; w < windows; ++w) {
+                int64_t digit = static_cast<int64_t>(windowBits(scalars[i], w * width, width)) + carry;
+                carry = digit >= half ? 1 : 0;
+                digits[static_cast<size_t>(w) * n + i] = static_cast<int16_t>(digit - carry * full);
+            }
+        }
+        std::vector<EdPoint> buckets(static_cast<size_t>(half));
+        EdPoint acc = EdPoint::identity();
+        for (int w = windows - 1; w >= 0; --w) {
+            for (int b = 0; b < width && w != windows - 1; ++b) acc = Ed25519::dbl(acc);
+            std::fill(buckets.begin(), buckets.end(), EdPoint::identity());
+            const int16_t* row = &digits[static_cast<size_t>(w) * n];
+            for (size_t i = 0; i < n; ++i) {
+                if (row[i] > 0) buckets[row[i] - 1] = Ed25519::add(buckets[row[i] - 1], points[i]);
+                else if (row[i] < 0) buckets[-row[i] - 1] = Ed25519::sub(buckets[-row[i] - 1], points[i]);
+            }
+            EdPoint running = EdPoint::identity(), sum = EdPoint::identity();
+            for (size_t b = buckets.size(); b-- > 0;) {
+                running = Ed25519::add(running, Ed25519::cached(buckets[b]));
+                sum = Ed25519::add(sum, Ed25519::cached(running));
+            }
+            acc = Ed25519::add(acc, Ed25519::cached(sum));
+        }
+        return acc;
+    }
+
+public:
+    SignatureBatch() : malformed(false) {}
+
+    void reserve(size_t count) {
+        negR.reserve(count);
+        s.reserve(count);
+        k.reserve(count);
+        keys.reserve(count);
+    }
+
+    size_t size() const { return keys.size(); }
+
+    void add(const VerifyingKey& key, const uint8_t* message, size_t len, const Signature& sig) {
+        EdScalar scalar = EdScalar::fromBytes(sig.bytes.data() + 32);
+        EdPoint r;
+        if (!key.valid() || !scalar.isCanonical() || !Ed25519::decode(sig.bytes.data(), r)) {
+            malformed = true;
+            return;
+        }
+        negR.push_back(-r);
+        s.push_back(scalar);
+        k.push_back(challengeScalar(sig.bytes.data(), key.publicKey(), message, len));
+        keys.push_back(&key);
+    }
+
+    bool verify() const {
+        if (malformed) return false;
+        if (keys.empty()) return true;
+
+        // z_i = 128 premiers bits de SHA-256(graine aléatoire || i)
+        std::random_device rd;
+        uint32_t seed[8];
+        for (auto& w : seed) w = rd();
+        Sha256 seeded;
+        seeded.update(reinterpret_cast<const uint8_t*>(seed), sizeof(seed));
+
+        std::vector<EdScalar> scalars;
+        std::vector<const EdPoint*> points;
+        scalars.reserve(keys.size() + 1);
+        points.reserve(keys.size() + 1);
+        scalars.push_back(EdScalar::zero()); // coefficient de B, complété plus bas
+        points.push_back(&Ed25519::basePoint());
+
+        std::unordered_map<const VerifyingKey*, size_t> keySlot;
+        std::vector<EdScalar> keyScalars;
+        std::vector<const VerifyingKey*> distinctKeys;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            uint8_t counter[8], digest[32];
+            storeLE64(counter, i);
+            Sha256 ctx = seeded;
+            ctx.update(counter, sizeof(counter));
+            ctx.final(digest);
+            EdScalar z = { { loadLE64(digest), loadLE64(digest + 8), 0, 0 } };
+
+            scalars[0] = EdScalar::mulAdd(z, s[i], scalars[0]);
+            scalars.push_back(z);
+            points.push_back(&negR[i]);
+            auto slot = keySlot.find(keys[i]);
+            if (slot == keySlot.end()) {
+                slot = keySlot.emplace(keys[i], keyScalars.size()).first;
+                keyScalars.push_back(EdScalar::zero());
+                distinctKeys.push_back(keys[i]);
+            }
+            EdScalar& ks = keyScalars[slot->second];
+            ks = EdScalar::mulAdd(z, k[i], ks);
+        }
+        for (size_t j = 0; j < distinctKeys.size(); ++j) {
+            scalars.push_back(keyScalars[j]);
+            points.push_back(&distinctKeys[j]->negA);
+        }
+
+        EdPoint check;
+        if (points.size() <= STRAUS_MAX_POINTS) {
+            std::vector<EdCached> tables(points.size() * 8);
+            std::vector<const EdCached*> tablePtrs(points.size());
+            std::vector<std::array<uint8_t, 32> > bytes(points.size());
+            std::vector<const uint8_t*> bytePtrs(points.size());
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (i == 0) {
+                    tablePtrs[i] = Ed25519::baseOddMultiples();
+                }
+                else if (i > keys.size()) {
+                    tablePtrs[i] = distinctKeys[i - keys.size() - 1]->negTable;
+                }
+                else {
+                    Ed25519::oddMultiples(*points[i], &tables[i * 8]);
+                    tablePtrs[i] = &tables[i * 8];
+                }
+                scalars[i].toBytes(bytes[i].data());
+                bytePtrs[i] = bytes[i].data();
+            }
+            check = Ed25519::straus(tablePtrs.data(), bytePtrs.data(), points.size());
+        }
+        else {
+            std::vector<EdCached> cachedPoints;
+            cachedPoints.reserve(points.size());
+            for (const EdPoint* p : points) cachedPoints.push_back(Ed25519::cached(*p));
+            check = pippenger(cachedPoints, scalars);
+        }
+        for (int i = 0; i < 3; ++i) check = Ed25519::dbl(check);
+        return Ed25519::isIdentity(check);
+    }
+};
+
+// ==================================================
+// TRANSACTION
+// ==================================================
+// Montants en virgule fixe : 1 unité = 10^6 micro-unités (précision de l'ancien
+// affichage std::to_string(double)), sommes et comparaisons exactes.
+typedef int64_t Amount;
+const Amount AMOUNT_SCALE = 1000000;
+// Plus grand montant (ou frais) d'une transaction : montant + frais reste loin de INT64_MAX
+const Amount MAX_MONEY = 21000000 * AMOUNT_SCALE;
+
+inline bool moneyRange(Amount value) {
+    return value >= 0 && value <= MAX_MONEY;
+}
+
+inline Amount toAmount(double value) {
+    return static_cast<Amount>(std::llround(value * static_cast<double>(AMOUNT_SCALE)));
+}
+
+std::string formatAmount(Amount value) {
+    std::string out = value < 0 ? "-" : "";
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    out += std::to_string(magnitude / AMOUNT_SCALE);
+    std::string fraction = std::to_string(magnitude % AMOUNT_SCALE);
+    out += '.';
+    out.append(6 - fraction.size(), '0');
+    out += fraction;
+    return out;
+}
+
+// Allocateur par blocs contigus (bump pointer) : aucune libération individuelle,
+// tout est rendu à la destruction de l'arène.
+class Arena {
+private:
+    std::vector<std::unique_ptr<uint8_t[]> > chunks;
+    uint8_t* cursor;
+    size_t remaining;
+    size_t chunkSize;
+    size_t reserved;
+
+public:
+    explicit Arena(size_t chunkBytes = 64 * 1024)
+        : cursor(nullptr), remaining(0), chunkSize(chunkBytes), reserved(0) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        size_t padding = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        if (!cursor || padding + size > remaining) {
+            size_t bytes = std::max(chunkSize, size + align);
+            chunks.emplace_back(new uint8_t[bytes]);
+            cursor = chunks.back().get();
+            remaining = bytes;
+            reserved += bytes;
+            padding = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        }
+        void* p = cursor + padding;
+        cursor += padding + size;
+        remaining -= padding + size;
+        return p;
+    }
+
+    size_t bytesReserved() const { return reserved; }
+    size_t chunkCount() const { return chunks.size(); }
+};
+
+// Table d'internement des noms de compte : chaque nom distinct reçoit un
+// identifiant dense (AccountId) et n'est stocké qu'une fois, dans une arène.
+// L'insertion est protégée par un mutex ; la lecture d'un nom par son id est
+// sans verrou (tableaux de pages fixes, jamais déplacés).
+typedef uint32_t AccountId;
+
+class AccountNames {
+public:
+    static constexpr size_t MAX_NAME_SIZE = 255; // longueur sur un octet dans l'encodage canonique
+
+private:
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t MAX_PAGES = 16384; // 67M comptes
+
+    std::mutex mutex;
+    Arena arena;
+    std::unordered_map<std::string_view, AccountId> index;
+    std::array<std::atomic<std::string_view*>, MAX_PAGES> pages;
+    std::atomic<uint32_t> count;
+
+    AccountNames() : count(0) {
+        for (auto& p : pages) p.store(nullptr, std::memory_order_relaxed);
+    }
+
+public:
+    static AccountNames& instance() {
+        static AccountNames names;
+        return names;
+    }
+
+    AccountId intern(std::string_view name) {
+        if (name.size() > MAX_NAME_SIZE) throw std::length_error("AccountNames : nom de compte trop long");
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(name);
+        if (it != index.end()) return it->second;
+
+        AccountId id = count.load(std::memory_order_relaxed);
+        if (id / PAGE_SIZE >= MAX_PAGES) throw std::overflow_error("AccountNames : trop de comptes");
+        std::atomic<std::string_view*>& page = pages[id / PAGE_SIZE];
+        if (!page.load(std::memory_order_relaxed)) {
+            void* raw = arena.allocate(PAGE_SIZE * sizeof(std::string_view), alignof(std::string_view));
+            page.store(new (raw) std::string_view[PAGE_SIZE], std::memory_order_release);
+        }
+        char* copy = static_cast<char*>(arena.allocate(name.size() + 1, 1));
+        std::memcpy(copy, name.data(), name.size());
+        copy[name.size()] = '\0';
+        std::string_view stored(copy, name.size());
+        page.load(std::memory_order_relaxed)[id % PAGE_SIZE] = stored;
+        index.emplace(stored, id);
+        count.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    // false si le nom n'a jamais été interné
+    bool find(std::string_view name, AccountId& id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(name);
+        if (it == index.end()) return false;
+        id = it->second;
+        return true;
+    }
+
+    std::string_view name(AccountId id) const {
+        return pages[id / PAGE_SIZE].load(std::memory_order_acquire)[id % PAGE_SIZE];
+    }
+
+    size_t size() const { return count.load(std::memory_order_acquire); }
+};
+
+// Clé publique de chaque compte, décompressée à l'enregistrement. Une clé
+// enregistrée ne change plus : les lots de vérification en cours gardent des
+// pointeurs vers elle.
+// Les clés de démonstration sont dérivées du nom (graine = SHA-256("wallet:" + nom)) :
+// n'importe qui peut les recalculer, elles ne servent qu'aux exemples et aux tests.
+class AccountKeys {
+private:
+    std::mutex mutex;
+    std::unordered_map<AccountId, std::unique_ptr<VerifyingKey> > keys;
+    std::unordered_map<AccountId, std::unique_ptr<KeyPair> > demoPairs;
+
+    AccountKeys() = default;
+
+public:
+    static AccountKeys& instance() {
+        static AccountKeys registry;
+        return registry;
+    }
+
+    // false si la clé n'est pas un point valide ou si le compte a déjà une autre clé
+    bool registerKey(AccountId id, const PublicKey& key) {
+        std::unique_ptr<VerifyingKey> decoded(new VerifyingKey(key));
+        if (!decoded->valid()) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = keys.find(id);
+        if (it != keys.end()) return it->second->publicKey() == key;
+        keys.emplace(id, std::move(decoded));
+        return true;
+    }
+
+    // nullptr si le compte n'a pas de clé
+    const VerifyingKey* find(AccountId id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = keys.find(id);
+        return it == keys.end() ? nullptr : it->second.get();
+    }
+
+    // Paire de démonstration du compte, calculée et enregistrée au premier appel
+    const KeyPair& demoKeyPair(AccountId id) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = demoPairs.find(id);
+            if (it != demoPairs.end()) return *it->second;
+        }
+        Hash256 seed = sha256Hash("wallet:" + std::string(AccountNames::instance().name(id)));
+        std::unique_ptr<KeyPair> pair(new KeyPair(seed.data()));
+        if (!registerKey(id, pair->publicKey())) throw std::runtime_error("AccountKeys : clé déjà enregistrée pour ce compte");
+        std::lock_guard<std::mutex> lock(mutex);
+        return *demoPairs.emplace(id, std::move(pair)).first->second;
+    }
+};
+
+// Transaction compacte et trivialement copiable (104 octets) : comptes internés,
+// montants en virgule fixe, nonce, identifiant binaire et signature de
+// l'émetteur. Un bloc en range donc un tableau contigu.
+//
+// Le nonce numérote les transactions de chaque émetteur (0, 1, 2...) : l'état
+// des comptes n'accepte que le suivant attendu, une transaction signée ne peut
+// donc pas être rejouée.
+//
+// Encodage canonique (version 2, entiers little-endian à largeur fixe) :
+//   version(1) | nonce(8) | amount(8) | fee(8) | len(1) sender | len(1) receiver
+// hash() = SHA-256d de ces octets : c'est la feuille de Merkle, et l'id en
+// reprend les 8 premiers octets (lus en big-endian). La signature Ed25519 porte
+// sur hash() et reste hors de l'encodage canonique (comme un témoin) : l'id et la
+// racine de Merkle n'en dépendent pas, encodeSigned l'ajoute pour le stockage.
+struct Transaction {
+    static constexpr uint8_t ENCODING_VERSION = 2;
+    static constexpr size_t MAX_ENCODED_SIZE = 1 + 8 + 8 + 8 + 2 * (1 + AccountNames::MAX_NAME_SIZE);
+    static constexpr size_t MIN_SIGNED_SIZE = 1 + 8 + 8 + 8 + 2 + sizeof(Signature);
+
+    uint64_t id;
+    AccountId sender;
+    AccountId receiver;
+    Amount amount;
+    Amount fee; // frais offerts au producteur du bloc (priorité dans la mempool)
+    uint64_t nonce; // rang de la transaction parmi celles de l'émetteur
+    Signature signature; // nulle tant que la transaction n'est pas signée
+
+    Transaction() = default;
+
+    Transaction(AccountId _sender, AccountId _receiver, Amount _amount, Amount _fee = 0, uint64_t _nonce = 0)
+        : id(0), sender(_sender), receiver(_receiver), amount(_amount), fee(_fee), nonce(_nonce), signature() {
+        id = hash().word(0);
+    }
+
+    Transaction(const std::string& _sender, const std::string& _receiver, double _amount, double _fee = 0.0,
+        uint64_t _nonce = 0)
+        : Transaction(AccountNames::instance().intern(_sender), AccountNames::instance().intern(_receiver),
+            toAmount(_amount), toAmount(_fee), _nonce) {}
+
+    std::string_view senderName() const { return AccountNames::instance().name(sender); }
+    std::string_view receiverName() const { return AccountNames::instance().name(receiver); }
+
+    void encode(ByteWriter& out) const {
+        out.u8(ENCODING_VERSION);
+        out.u64(nonce);
+        out.i64(amount);
+        out.i64(fee);
+        out.str8(senderName());
+        out.str8(receiverName());
+    }
+
+    // Encodage dans un tampon d'au moins MAX_ENCODED_SIZE octets ; renvoie la taille
+    size_t encode(uint8_t* out) const {
+        ByteWriter w(out, MAX_ENCODED_SIZE);
+        encode(w);
+        return w.size();
+    }
+
+    Hash256 hash() const {
+        uint8_t buffer[MAX_ENCODED_SIZE];
+        size_t size = encode(buffer);
+        Hash256 h;
+        sha256d(buffer, size, h.data());
+        return h;
+    }
+
+private:
+    // Champs lus sans toucher à la table des noms ; h = hash() des octets lus
+    static Transaction decodeFields(ByteReader& in, std::string_view& senderName, std::string_view& receiverName, Hash256& h) {
+        const uint8_t* start = in.position();
+        if (in.u8() != ENCODING_VERSION) throw std::runtime_error("Transaction : version d'encodage inconnue");
+        Transaction tx;
+        tx.nonce = in.u64();
+        tx.amount = in.i64();
+        tx.fee = in.i64();
+        if (!moneyRange(tx.amount) || !moneyRange(tx.fee)) throw std::runtime_error("Transaction : montant hors limites");
+        senderName = in.view8();
+        receiverName = in.view8();
+        sha256d(start, static_cast<size_t>(in.position() - start), h.data());
+        tx.id = h.word(0);
+        tx.signature = Signature();
+        return tx;
+    }
+
+public:
+    // Décodage sans copie : les noms sont internés directement depuis le tampon
+    // et l'id est haché sur les octets lus
+    static Transaction decode(ByteReader& in) {
+        std::string_view senderName, receiverName;
+        Hash256 h;
+        Transaction tx = decodeFields(in, senderName, receiverName, h);
+        tx.sender = AccountNames::instance().intern(senderName);
+        tx.receiver = AccountNames::instance().intern(receiverName);
+        return tx;
+    }
+
+    void encodeSigned(ByteWriter& out) const {
+        encode(out);
+        out.bytes(signature.bytes.data(), signature.bytes.size());
+    }
+
+    static Transaction decodeSigned(ByteReader& in) {
+        Transaction tx = decode(in);
+        std::memcpy(tx.signature.bytes.data(), in.bytes(tx.signature.bytes.size()), tx.signature.bytes.size());
+        return tx;
+    }
+
+    // Transaction venue d'un pair ou d'un client RPC : la table des noms est
+    // globale et jamais purgée, on n'y ajoute rien sur la foi d'octets non
+    // authentifiés. L'émetteur doit déjà être connu ; un destinataire nouveau
+    // n'est interné qu'après vérification de la signature.
+    static Transaction decodeReceived(ByteReader& in) {
+        std::string_view senderName, receiverName;
+        Hash256 h;
+        Transaction tx = decodeFields(in, senderName, receiverName, h);
+        if (!AccountNames::instance().find(senderName, tx.sender)) throw std::runtime_error("Transaction : émetteur inconnu");
+        std::memcpy(tx.signature.bytes.data(), in.bytes(tx.signature.bytes.size()), tx.signature.bytes.size());
+        if (!AccountNames::instance().find(receiverName, tx.receiver)) {
+            const VerifyingKey* key = AccountKeys::instance().find(tx.sender);
+            if (!key || !key->verify(h.data(), 32, tx.signature)) throw std::runtime_error("Transaction : signature invalide");
+            tx.receiver = AccountNames::instance().intern(receiverName);
+        }
+        return tx;
+    }
+
+    void sign(const KeyPair& key) {
+        Hash256 h = hash();
+        signature = key.sign(h.data(), 32);
+    }
+
+    // Vérification isolée avec la clé enregistrée de l'émetteur
+    bool verifySignature() const {
+        const VerifyingKey* key = AccountKeys::instance().find(sender);
+        if (!key) return false;
+        Hash256 h = hash();
+        return key->verify(h.data(), 32, signature);
+    }
+
+    // false si l'émetteur n'a pas de clé enregistrée
+    bool addSignatureTo(SignatureBatch& batch) const {
+        const VerifyingKey* key = AccountKeys::instance().find(sender);
+        if (!key) return false;
+        Hash256 h = hash();
+        batch.add(*key, h.data(), 32, signature);
+        return true;
+    }
+
+    std::string idHex() const {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i) bytes[i] = uint8_t(id >> (56 - 8 * i));
+        return toHex(bytes, 8);
+    }
+
+    // Forme lisible "A->B:montant (frais f)", pour l'affichage uniquement
+    std::string toString() const {
+        std::string text(senderName());
+        text += "->";
+        text += receiverName();
+        text += ":" + formatAmount(amount) + " (frais " + formatAmount(fee) + ")";
+        return text;
+    }
+};
+
+static_assert(std::is_trivially_copyable<Transaction>::value, "Transaction doit rester trivialement copiable");
+static_assert(sizeof(Transaction) == 104, "Transaction : 104 octets attendus");
+
+// Signe chaque transaction avec la clé de démonstration de son émetteur
+void signWithDemoKeys(std::vector<Transaction>& txs) {
+    for (auto& tx : txs) tx.sign(AccountKeys::instance().demoKeyPair(tx.sender));
+}
+
+// Numérote les transactions de chaque émetteur dans l'ordre du tableau, à partir
+// de 'next' (prochain nonce par compte, avancé au passage). Avant la signature :
+// le nonce fait partie du hash.
+void assignNonces(std::vector<Transaction>& txs, std::unordered_map<AccountId, uint64_t>& next) {
+    for (auto& tx : txs) {
+        tx.nonce = next[tx.sender]++;
+        tx.id = tx.hash().word(0);
+    }
+}
+
+// Toutes les signatures d'un ensemble de transactions, en un seul lot
+bool verifySignatures(const std::vector<Transaction>& txs) {
+    SignatureBatch batch;
+    batch.reserve(txs.size());
+    for (const auto& tx : txs) {
+        if (!tx.addSignatureTo(batch)) return false;
+    }
+    return batch.verify();
+}
+
+// ==================================================
+// ARBRE DE MERKLE
+// ==================================================
+// Hache un niveau : dst[p] = H(src[2p] || src[2p+1]), le dernier nœud d'un
+// niveau impair étant dupliqué. Deux frères adjacents forment déjà un message
+// contigu de 64 octets, hachés par lots avec le noyau multi-buffer.
+void hashMerkleLevel(const Hash256* src, size_t count, Hash256* dst) {
+    const size_t lanes = Sha256MultiBuffer::MAX_LANES;
+    const size_t pairs = (count + 1) / 2;
+    Hash256 oddPair[2];
+    for (size_t base = 0; base < pairs; base += lanes) {
+        size_t n = std::min(lanes, pairs - base);
+        const uint8_t* messages[Sha256MultiBuffer::MAX_LANES];
+        for (size_t i = 0; i < n; ++i) {
+            size_t p = base + i;
+            if (2 * p + 1 < count) {
+                messages[i] = src[2 * p].data();
+            }
+            else {
+                oddPair[0] = oddPair[1] = src[2 * p];
+                messages[i] = oddPair[0].data();
+            }
+        }
+        sha256Batch(messages, 64, reinterpret_cast<uint8_t(*)[32]>(dst + base), n);
+    }
+}
+
+Hash256 hashMerklePair(const Hash256& left, const Hash256& right) {
+    uint8_t message[64];
+    std::memcpy(message, left.data(), 32);
+    std::memcpy(message + 32, right.data(), 32);
+    return sha256Hash(message, sizeof(message));
+}
+
+// Preuve d'inclusion : frères rencontrés de la feuille vers la racine.
+// Le bit l de 'index' indique si le nœud courant est à droite au niveau l.
+struct MerkleProof {
+    size_t index;
+    std::vector<Hash256> siblings;
+
+    MerkleProof() : index(0) {}
+};
+
+// Arbre de Merkle à plat : tous les niveaux sont rangés à la suite dans un seul
+// tableau contigu (feuilles d'abord, racine en dernier), alloué une seule fois.
+// Chaque niveau est haché directement dans l'emplacement du niveau suivant.
+class MerkleTree {
+private:
+    std::vector<Hash256> nodes;
+    std::vector<size_t> levelStart; // niveau l : nodes[levelStart[l] .. levelStart[l + 1])
+
+    // Niveaux bas répartis sur le pool par tranches de paires alignées ;
+    // en dessous de PARALLEL_MIN_PAIRS paires (près de la racine), hachage en série.
+    // Chaque paire est hachée exactement comme en série : racine identique bit à bit.
+    void build(ThreadPool* pool = nullptr) {
+        for (size_t l = 0; l + 2 < levelStart.size(); ++l) {
+            size_t count = levelStart[l + 1] - levelStart[l];
+            const Hash256* src = nodes.data() + levelStart[l];
+            Hash256* dst = nodes.data() + levelStart[l + 1];
+            size_t pairs = (count + 1) / 2;
+            if (!pool || pairs < PARALLEL_MIN_PAIRS) {
+                hashMerkleLevel(src, count, dst);
+                continue;
+            }
+            pool->parallelFor(pairs, PARALLEL_GRAIN, [src, count, dst](size_t begin, size_t end) {
+                size_t last = std::min(count, 2 * end);
+                hashMerkleLevel(src + 2 * begin, last - 2 * begin, dst + begin);
+            });
+        }
+    }
+
+    void layout(size_t leafCount) {
+        levelStart.assign(1, 0);
+        size_t total = 0;
+        for (size_t count = leafCount; count > 0; count = (count == 1) ? 0 : (count + 1) / 2) {
+            total += count;
+            levelStart.push_back(total);
+        }
+        nodes.resize(total);
+    }
+
+public:
+    static constexpr size_t PARALLEL_MIN_PAIRS = 4096;
+    static constexpr size_t PARALLEL_GRAIN = 1024;
+
+    MerkleTree() {}
+
+    // Avec un pool, le hachage des feuilles et des niveaux bas est parallélisé
+    explicit MerkleTree(const std::vector<Transaction>& transactions, ThreadPool* pool = nullptr) {
+        METRIC_TIME(MerkleBuild);
+        METRIC_ADD(MerkleBuilds, 1);
+        METRIC_ADD(MerkleLeaves, transactions.size());
+        layout(transactions.size());
+        Hash256* leaves = nodes.data();
+        auto hashLeaves = [&transactions, leaves](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) leaves[i] = leafHash(transactions[i]);
+        };
+        if (pool && transactions.size() >= 2 * PARALLEL_MIN_PAIRS) {
+            pool->parallelFor(transactions.size(), PARALLEL_GRAIN, hashLeaves);
+        }
+        else {
+            hashLeaves(0, transactions.size());
+        }
+        build(pool);
+    }
+
+    explicit MerkleTree(const std::vector<Hash256>& leaves) {
+        layout(leaves.size());
+        std::copy(leaves.begin(), leaves.end(), nodes.begin());
+        build();
+    }
+
+    // Feuille = SHA-256d de l'encodage canonique de la transaction
+    static Hash256 leafHash(const Transaction& tx) {
+        return tx.hash();
+    }
+
+    static Hash256 emptyRoot() {
+        return sha256Hash("empty");
+    }
+
+    size_t leafCount() const { return levelStart.size() > 1 ? levelStart[1] : 0; }
+
+    const Hash256& leaf(size_t i) const { return nodes.at(i); }
+    size_t levelCount() const { return levelStart.size() - 1; }
+
+    Hash256 getRootHash() const {
+        return nodes.empty() ? emptyRoot() : nodes.back();
+    }
+
+    MerkleProof getProof(size_t txIndex) const {
+        if (txIndex >= leafCount()) {
+            throw std::out_of_range("MerkleTree::getProof : index de transaction invalide");
+        }
+        MerkleProof proof;
+        proof.index = txIndex;
+        size_t pos = txIndex;
+        for (size_t l = 0; l + 1 < levelCount(); ++l) {
+            size_t count = levelStart[l + 1] - levelStart[l];
+            size_t sibling = (pos % 2 == 0) ? pos + 1 : pos - 1;
+            if (sibling >= count) sibling = pos; // nœud dupliqué
+            proof.siblings.push_back(nodes[levelStart[l] + sibling]);
+            pos /= 2;
+        }
+        return proof;
+    }
+
+    // O(log n) : ne nécessite que la feuille, la preuve et la racine de l'en-tête
+    static bool verifyProof(const Hash256& leaf, const MerkleProof& proof, const Hash256& root) {
+        Hash256 current = leaf;
+        size_t pos = proof.index;
+        for (const auto& sibling : proof.siblings) {
+            current = (pos % 2 == 0) ? hashMerklePair(current, sibling) : hashMerklePair(sibling, current);
+            pos /= 2;
+        }
+        return pos == 0 && current == root;
+    }
+};
+
+// Accumulateur de Merkle incrémental pour un bloc en cours de remplissage.
+// Seule la "frontière" est conservée : frontier[l] est la racine du sous-arbre
+// complet de 2^l feuilles en attente de son frère (présent si le bit l de
+// 'count' vaut 1). Un ajout coûte O(log n), comme une requête de racine qui
+// replie la frontière en appliquant la même règle de duplication que MerkleTree.
+class MerkleAccumulator {
+private:
+    std::array<Hash256, 64> frontier;
+    size_t count;
+
+public:
+    MerkleAccumulator() : count(0) {}
+
+    void append(const Hash256& leaf) {
+        Hash256 node = leaf;
+        size_t l = 0;
+        while ((count >> l) & 1) {
+            node = hashMerklePair(frontier[l], node);
+            ++l;
+        }
+        frontier[l] = node;
+        ++count;
+    }
+
+    void append(const Transaction& tx) {
+        append(MerkleTree::leafHash(tx));
+    }
+
+    size_t size() const { return count; }
+
+    void clear() { count = 0; }
+
+    Hash256 root() const {
+        if (count == 0) return MerkleTree::emptyRoot();
+        // 'carry' : dernier nœud (incomplet) du niveau l, s'il existe
+        bool hasCarry = false;
+        Hash256 carry;
+        size_t l = 0;
+        for (; (size_t(1) << l) < count; ++l) {
+            bool pending = (count >> l) & 1;
+            if (pending && hasCarry) {
+                carry = hashMerklePair(frontier[l], carry);
+            }
+            else if (pending) {
+                carry = hashMerklePair(frontier[l], frontier[l]);
+                hasCarry = true;
+            }
+            else if (hasCarry) {
+                carry = hashMerklePair(carry, carry);
+            }
+        }
+        return hasCarry ? carry : frontier[l];
+    }
+};
+
+Hash256 computeMerkleRoot(const std::vector<Transaction>& transactions, ThreadPool* pool = nullptr) {
+    return MerkleTree(transactions, pool).getRootHash();
+}
+
+// ==================================================
+// VALIDATEUR
+// ==================================================
+struct Validator {
+    std::string id;
+    uint64_t stake; // en unités entières de monnaie
+    Validator(const std::string& _id, uint64_t _stake) : id(_id), stake(_stake) {}
+};
+
+// Générateur déterministe (splitmix64) initialisé par les octets d'un hash :
+// même tirage sur toutes les plateformes, sans dépendre des distributions de <random>.
+class HashSeededRng {
+private:
+    uint64_t state;
+
+public:
+    explicit HashSeededRng(const Hash256& seed)
+        : state(seed.word(0) ^ seed.word(1) ^ seed.word(2) ^ seed.word(3)) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Entier uniforme dans [0, bound) sans biais (rejet)
+    uint64_t uniform(uint64_t bound) {
+        uint64_t limit = (0 - bound) % bound;
+        for (;;) {
+            uint64_t r = next();
+            if (r >= limit) return r % bound;
+        }
+    }
+};
+
+// Registre des validateurs avec table d'alias de Walker/Vose, reconstruite une
+// fois par époque. La sélection est en O(1) et exacte en arithmétique entière :
+// la colonne c (uniforme parmi n) est gardée si u < threshold[c] (u uniforme
+// dans [0, totalStake)), sinon son alias est élu, ce qui donne à chaque
+// validateur une probabilité stake / totalStake exactement.
+// Les validateurs sont triés par id : le résultat ne dépend pas de l'ordre fourni.
+class ValidatorRegistry {
+private:
+    std::vector<Validator> validators;
+    std::vector<uint64_t> threshold;
+    std::vector<uint32_t> alias;
+    uint64_t totalStake;
+
+public:
+    ValidatorRegistry() : totalStake(0) {}
+
+    explicit ValidatorRegistry(const std::vector<Validator>& vs) : totalStake(0) {
+        build(vs);
+    }
+
+    void build(const std::vector<Validator>& vs) {
+        validators.clear();
+        for (const auto& v : vs) {
+            if (v.stake > 0) validators.push_back(v);
+        }
+        std::sort(validators.begin(), validators.end(),
+            [](const Validator& a, const Validator& b) { return a.id < b.id; });
+
+        const uint64_t n = validators.size();
+        totalStake = 0;
+        for (const auto& v : validators) {
+            if (v.stake > UINT64_MAX - totalStake) throw std::overflow_error("ValidatorRegistry : stake total trop grand");
+            totalStake += v.stake;
+        }
+        if (n > 0 && totalStake > UINT64_MAX / n) {
+            throw std::overflow_error("ValidatorRegistry : stake total x nombre de validateurs dépasse 64 bits");
+        }
+
+        // Poids mis à l'échelle : stake * n, chaque colonne a une capacité de totalStake
+        threshold.assign(n, 0);
+        alias.assign(n, 0);
+        std::vector<uint64_t> scaled(n);
+        std::vector<uint32_t> small, large;
+        for (uint64_t i = 0; i < n; ++i) {
+            scaled[i] = validators[i].stake * n;
+            (scaled[i] < totalStake ? small : large).push_back(static_cast<uint32_t>(i));
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t l = small.back(); small.pop_back();
+            uint32_t g = large.back(); large.pop_back();
+            threshold[l] = scaled[l];
+            alias[l] = g;
+            scaled[g] -= totalStake - scaled[l];
+            (scaled[g] < totalStake ? small : large).push_back(g);
+        }
+        // Colonnes restantes : pleines (capacité exacte en arithmétique entière)
+        for (uint32_t i : large) { threshold[i] = totalStake; alias[i] = i; }
+        for (uint32_t i : small) { threshold[i] = totalStake; alias[i] = i; }
+    }
+
+    size_t size() const { return validators.size(); }
+    uint64_t getTotalStake() const { return totalStake; }
+
+    // Stake d'un validateur (0 s'il est inconnu) : recherche dichotomique par id
+    uint64_t stakeOf(const std::string& id) const {
+        auto it = std::lower_bound(validators.begin(), validators.end(), id,
+            [](const Validator& v, const std::string& key) { return v.id < key; });
+        return it != validators.end() && it->id == id ? it->stake : 0;
+    }
+
+    // Élection déterministe à partir du hash du bloc ; nullptr si aucun stake
+    const Validator* select(const Hash256& seed) const {
+        if (validators.empty()) return nullptr;
+        METRIC_ADD(ValidatorSelections, 1);
+        HashSeededRng rng(seed);
+        uint64_t column = rng.uniform(validators.size());
+        uint64_t u = rng.uniform(totalStake);
+        return &validators[u < threshold[column] ? column : alias[column]];
+    }
+
+    // Pour les tests : validateur élu pour une colonne et un tirage donnés
+    const Validator& pick(uint64_t column, uint64_t u) const {
+        return validators[u < threshold[column] ? column : alias[column]];
+    }
+};
+
+// ==================================================
+// EN-TÊTE BINAIRE ET MIDSTATE
+// ==================================================
+// Horodatage d'un en-tête : UTC à la milliseconde, ISO 8601 compact, exactement
+// les 20 octets du champ ("20241016T183424.123Z"). Sans fuseau ni heure d'été,
+// l'écart entre deux horodatages donne l'intervalle entre blocs du réajustement.
+inline uint64_t currentTimeMillis() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Conversions jours depuis 1970 <-> date civile (algorithmes de H. Hinnant)
+std::string formatBlockTime(uint64_t millis) {
+    uint64_t days = millis / 86400000 + 719468;
+    uint64_t rest = millis % 86400000;
+    uint64_t era = days / 146097;
+    uint64_t doe = days - era * 146097;
+    uint64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint64_t mp = (5 * doy + 2) / 153;
+    unsigned day = static_cast<unsigned>(doy - (153 * mp + 2) / 5 + 1);
+    unsigned month = static_cast<unsigned>(mp < 10 ? mp + 3 : mp - 9);
+    unsigned long long year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+    char text[48];
+    std::snprintf(text, sizeof(text), "%04lluT%02u%02u%02u.%03uZ", year * 10000 + month * 100 + day,
+        static_cast<unsigned>(rest / 3600000), static_cast<unsigned>(rest / 60000 % 60),
+        static_cast<unsigned>(rest / 1000 % 60), static_cast<unsigned>(rest % 1000));
+    return text;
+}
+
+// Millisecondes depuis 1970 ; 0 si le texte n'a pas ce format
+uint64_t parseBlockTime(std::string_view text) {
+    if (text.size() != 20 || text[8] != 'T' || text[15] != '.' || text[19] != 'Z') return 0;
+    auto number = [&text](size_t pos, size_t len, unsigned& out) {
+        out = 0;
+        for (size_t i = pos; i < pos + len; ++i) {
+            if (text[i] < '0' || text[i] > '9') return false;
+            out = out * 10 + static_cast<unsigned>(text[i] - '0');
+        }
+        return true;
+    };
+    unsigned year, month, day, hour, minute, second, millis;
+    if (!number(0, 4, year) || !number(4, 2, month) || !number(6, 2, day) || !number(9, 2, hour) ||
+        !number(11, 2, minute) || !number(13, 2, second) || !number(16, 3, millis)) return 0;
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 59) return 0;
+    uint64_t y = year - (month <= 2 ? 1 : 0);
+    uint64_t era = y / 400;
+    uint64_t yoe = y - era * 400;
+    uint64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint64_t days = era * 146097 + doe - 719468;
+    return ((days * 24 + hour) * 60 + minute) * 60000 + second * 1000 + millis;
+}
+
+// En-tête canonique, disposition fixe (entiers little-endian, texte complété par des zéros) :
+// version(4) | index(8) | previousHash(32) | merkleRoot(32) | timestamp(20) | target(32) | nonce(8)
+// Le hash d'un bloc est le SHA-256 de ces 136 octets (cible et nonce nuls hors PoW).
+// Version 2 : ajout de la cible 256 bits, engagée dans le hash.
+// Version 3 : horodatage UTC à la milliseconde (formatBlockTime).
+struct BlockHeader {
+    static constexpr uint32_t VERSION = 3;
+    static constexpr size_t PREFIX_SIZE = 4 + 8 + 32 + 32 + 20 + 32;
+    static constexpr size_t SIZE = PREFIX_SIZE + 8;
+
+    uint32_t version;
+    uint64_t index;
+    Hash256 previousHash;
+    Hash256 merkleRoot;
+    char timestamp[20];
+    Hash256 target;
+    uint64_t nonce;
+
+    BlockHeader() : version(VERSION), index(0), nonce(0) {
+        std::memset(timestamp, 0, sizeof(timestamp));
+    }
+
+    BlockHeader(size_t idx, const Hash256& prevHash, const Hash256& merkle,
+        const std::string& time, long long n, const Hash256& powTarget = Hash256())
+        : version(VERSION), index(idx), previousHash(prevHash), merkleRoot(merkle), target(powTarget),
+          nonce(static_cast<uint64_t>(n)) {
+        copyField(timestamp, sizeof(timestamp), time);
+    }
+
+    static void copyField(char* dst, size_t size, const std::string& src) {
+        std::memset(dst, 0, size);
+        std::memcpy(dst, src.data(), std::min(size, src.size()));
+    }
+
+    static void writeLE64(uint8_t* out, uint64_t v) {
+        for (int i = 0; i < 8; ++i) out[i] = uint8_t(v >> (8 * i));
+    }
+
+    void serializePrefix(uint8_t out[PREFIX_SIZE]) const {
+        for (int i = 0; i < 4; ++i) out[i] = uint8_t(version >> (8 * i));
+        writeLE64(out + 4, index);
+        std::memcpy(out + 12, previousHash.data(), 32);
+        std::memcpy(out + 44, merkleRoot.data(), 32);
+        std::memcpy(out + 76, timestamp, 20);
+        std::memcpy(out + 96, target.data(), 32);
+    }
+
+    void serialize(uint8_t out[SIZE]) const {
+        serializePrefix(out);
+        writeLE64(out + PREFIX_SIZE, nonce);
+    }
+
+    Hash256 hash() const {
+        uint8_t bytes[SIZE];
+        serialize(bytes);
+        return sha256Hash(bytes, SIZE);
+    }
+
+    std::string timestampString() const {
+        return std::string(timestamp, strnlen(timestamp, sizeof(timestamp)));
+    }
+
+    // Lecture depuis une plage d'octets (sans copie intermédiaire)
+    static BlockHeader decode(ByteReader& in) {
+        BlockHeader h;
+        h.version = in.u32();
+        if (h.version != VERSION) throw std::runtime_error("BlockHeader : version inconnue");
+        h.index = in.u64();
+        h.previousHash = in.hash();
+        h.merkleRoot = in.hash();
+        std::memcpy(h.timestamp, in.bytes(sizeof(h.timestamp)), sizeof(h.timestamp));
+        h.target = in.hash();
+        h.nonce = in.u64();
+        return h;
+    }
+};
+
+// Hachage d'en-tête avec midstate : les blocs complets du préfixe constant sont
+// compressés une fois ; le reste du préfixe, le remplissage et la longueur forment
+// un bloc final modèle dans lequel chaque essai n'écrit que les 8 octets du nonce.
+// Aucune allocation dans la boucle de minage.
+class HeaderHasher {
+private:
+    static constexpr size_t FULL_BLOCKS = BlockHeader::PREFIX_SIZE / 64;
+    static constexpr size_t NONCE_OFFSET = BlockHeader::PREFIX_SIZE % 64;
+    static constexpr size_t TAIL_SIZE = (NONCE_OFFSET + 8 + 9 <= 64) ? 64 : 128;
+
+    uint32_t midstate[8];
+    uint8_t tail[TAIL_SIZE];
+
+public:
+    explicit HeaderHasher(const BlockHeader& header) {
+        uint8_t prefix[BlockHeader::PREFIX_SIZE];
+        header.serializePrefix(prefix);
+        Sha256::initState(midstate);
+        for (size_t b = 0; b < FULL_BLOCKS; ++b) Sha256::compress(midstate, prefix + 64 * b);
+
+        const uint64_t bitLen = uint64_t(BlockHeader::SIZE) * 8;
+        std::memset(tail, 0, sizeof(tail));
+        std::memcpy(tail, prefix + 64 * FULL_BLOCKS, NONCE_OFFSET);
+        tail[NONCE_OFFSET + 8] = 0x80;
+        for (int i = 0; i < 8; ++i) tail[TAIL_SIZE - 1 - i] = uint8_t(bitLen >> (8 * i));
+    }
+
+    void hash(long long nonce, Hash256& out) const {
+        uint32_t st[8];
+        uint8_t block[TAIL_SIZE];
+        std::memcpy(st, midstate, sizeof(st));
+        std::memcpy(block, tail, sizeof(block));
+        BlockHeader::writeLE64(block + NONCE_OFFSET, static_cast<uint64_t>(nonce));
+        for (size_t b = 0; b < TAIL_SIZE / 64; ++b) Sha256::compress(st, block + 64 * b);
+        Sha256::storeDigest(st, out.data());
+    }
+
+    // Essais des nonces first .. first + count - 1 (count <= MAX_LANES) en une passe SIMD
+    void hashBatch(long long first, size_t count, Hash256* out) const {
+        const size_t lanesMax = Sha256MultiBuffer::MAX_LANES;
+        uint32_t st[Sha256MultiBuffer::MAX_LANES][8];
+        uint8_t blocks[Sha256MultiBuffer::MAX_LANES][TAIL_SIZE];
+        const uint8_t* ptrs[Sha256MultiBuffer::MAX_LANES] = {};
+        count = std::min(count, lanesMax);
+        for (size_t l = 0; l < count; ++l) {
+            std::memcpy(st[l], midstate, sizeof(st[l]));
+            std::memcpy(blocks[l], tail, sizeof(blocks[l]));
+            BlockHeader::writeLE64(blocks[l] + NONCE_OFFSET, static_cast<uint64_t>(first + static_cast<long long>(l)));
+        }
+        for (size_t b = 0; b < TAIL_SIZE / 64; ++b) {
+            for (size_t l = 0; l < count; ++l) ptrs[l] = blocks[l] + 64 * b;
+            Sha256MultiBuffer::compress(st, ptrs, count);
+        }
+        for (size_t l = 0; l < count; ++l) Sha256::storeDigest(st[l], out[l].data());
+    }
+};
+
+// ==================================================
+// BLOC DE BASE
+// ==================================================
+class Block {
+public:
+    size_t index;
+    Hash256 previousHash;
+    Hash256 merkleRoot;
+    std::string timestamp;
+    std::vector<Transaction> transactions;
+    Hash256 hash;
+    bool hasBody; // false : en-tête restauré depuis le stockage, transactions non chargées
+
+    // Les transactions sont prises par valeur puis déplacées : passer un
+    // temporaire ou std::move(...) évite toute copie du tableau.
+    // 'pool' (facultatif) parallélise le calcul de la racine de Merkle des gros blocs
+    Block(size_t idx, const Hash256& prevHash, std::vector<Transaction> txs, ThreadPool* pool = nullptr)
+        : index(idx), previousHash(prevHash), timestamp(formatBlockTime(currentTimeMillis())),
+          transactions(std::move(txs)), hasBody(true) {
+        merkleRoot = computeMerkleRoot(transactions, pool);
+        hash = calculateHash();
+    }
+
+    // Restauration d'un en-tête depuis le stockage (transactions chargées à la demande)
+    Block(size_t idx, const Hash256& prevHash, const Hash256& merkle, const std::string& time, const Hash256& h)
+        : index(idx), previousHash(prevHash), merkleRoot(merkle), timestamp(time), hash(h), hasBody(false) {}
+
+    virtual ~Block() {}
+
+    // Horodatage en millisecondes depuis 1970 (0 s'il est mal formé)
+    uint64_t timeMillis() const { return parseBlockTime(timestamp); }
+
+    virtual Hash256 calculateHash() const {
+        return BlockHeader(index, previousHash, merkleRoot, timestamp, 0).hash();
+    }
+
+    MerkleProof getMerkleProof(size_t txIndex) const {
+        return MerkleTree(transactions).getProof(txIndex);
+    }
+
+    virtual void finalize() {}
+    virtual std::string getConsensusInfo() const { return "Base"; }
+
+    // Règle de consensus propre au type de bloc (registre = validateurs de l'époque)
+    virtual bool verifyConsensus(const ValidatorRegistry* registry) const {
+        (void)registry;
+        return true;
+    }
+};
+
+// ==================================================
+// BLOC PoW
+// ==================================================
+class PoWBlock : public Block {
+public:
+    long long nonce;
+    Hash256 target;        // hash valide si <= target (engagée dans l'en-tête)
+
+    PoWBlock(size_t idx, const Hash256& prevHash, std::vector<Transaction> txs, const Hash256& powTarget,
+        ThreadPool* pool = nullptr)
+        : Block(idx, prevHash, std::move(txs), pool), nonce(0), target(powTarget) {
+        hash = calculateHash();
+    }
+
+    // Difficulté en chiffres hexadécimaux nuls (cible 2^(256 - 4 * diff) - 1)
+    PoWBlock(size_t idx, const Hash256& prevHash, std::vector<Transaction> txs, int diff, ThreadPool* pool = nullptr)
+        : PoWBlock(idx, prevHash, std::move(txs), targetFromZeroDigits(diff), pool) {}
+
+    PoWBlock(size_t idx, const Hash256& prevHash, const Hash256& merkle, const std::string& time,
+        const Hash256& h, long long n, const Hash256& powTarget)
+        : Block(idx, prevHash, merkle, time, h), nonce(n), target(powTarget) {}
+
+    HeaderHasher headerHasher() const {
+        return HeaderHasher(BlockHeader(index, previousHash, merkleRoot, timestamp, nonce, target));
+    }
+
+    // Essai d'un nonce sans modifier le bloc (utilisable simultanément par
+    // plusieurs threads de minage)
+    bool tryNonce(const HeaderHasher& hasher, long long n) const {
+        Hash256 digest;
+        hasher.hash(n, digest);
+        return meetsTarget(digest, target);
+    }
+
+    // Premier nonce valide parmi first .. first + count - 1 (count <= MAX_LANES),
+    // décalage par rapport à 'first' ou -1. Le lot est haché en SIMD.
+    int findValidNonce(const HeaderHasher& hasher, long long first, size_t count) const {
+        Hash256 digests[Sha256MultiBuffer::MAX_LANES];
+        count = std::min(count, Sha256MultiBuffer::MAX_LANES);
+        hasher.hashBatch(first, count, digests);
+        for (size_t i = 0; i < count; ++i) {
+            if (meetsTarget(digests[i], target)) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // Hash de l'en-tête binaire pour un nonce donné
+    Hash256 hashWithNonce(long long n) const {
+        Hash256 digest;
+        headerHasher().hash(n, digest);
+        return digest;
+    }
+
+    virtual Hash256 calculateHash() const {
+        return hashWithNonce(nonce);
+    }
+
+    // Minage séquentiel (référence)
+    void finalize() {
+        HeaderHasher hasher = headerHasher();
+        long long first = nonce;
+        while (!tryNonce(hasher, nonce)) {
+            nonce++;
+        }
+        METRIC_ADD(NonceAttempts, static_cast<uint64_t>(nonce - first) + 1);
+        hash = calculateHash();
+    }
+
+    std::string getConsensusInfo() const {
+        std::ostringstream oss;
+        oss << "PoW (nonce=" << nonce << ", diff=" << std::fixed << std::setprecision(1) << targetDifficulty(target) << ")";
+        return oss.str();
+    }
+
+    bool verifyConsensus(const ValidatorRegistry*) const {
+        return !target.isZero() && meetsTarget(hash, target);
+    }
+};
+
+// ==================================================
+// MINAGE PARALLÈLE
+// ==================================================
+struct MiningResult {
+    bool found;
+    long long nonce;
+    Hash256 hash;
+    double seconds;
+    std::vector<unsigned long long> attemptsPerThread;
+
+    MiningResult() : found(false), nonce(0), seconds(0.0) {}
+
+    unsigned long long totalAttempts() const {
+        unsigned long long total = 0;
+        for (auto a : attemptsPerThread) total += a;
+        return total;
+    }
+
+    double hashRate(size_t thread) const {
+        return seconds > 0 ? attemptsPerThread[thread] / seconds : 0.0;
+    }
+};
+
+// Recherche de nonce répartie sur N threads.
+// L'espace des nonces est découpé en tranches distribuées dynamiquement
+// (compteur atomique). Le meilleur nonce trouvé sert de seuil d'arrêt partagé :
+// dès qu'un thread trouve un hash valide, toutes les tranches situées au-delà
+// sont abandonnées, tandis que celles situées en deçà sont terminées.
+// Le résultat est donc toujours le plus petit nonce valide, comme en séquentiel.
+class ParallelMiner {
+private:
+    unsigned threadCount;
+    long long chunkSize;
+    // Recherches numérotées : cancel() arrête toutes celles déjà commencées, sans
+    // qu'une recherche démarrée ensuite ne puisse effacer l'annulation
+    std::atomic<uint64_t> runs;
+    std::atomic<uint64_t> cancelledRuns;
+
+public:
+    explicit ParallelMiner(unsigned threads = 0, long long chunk = 1024)
+        : threadCount(1), chunkSize(chunk > 0 ? chunk : 1), runs(0), cancelledRuns(0) {
+        setThreadCount(threads);
+    }
+
+    // 0 = un thread par cœur disponible
+    void setThreadCount(unsigned threads) {
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        threadCount = threads > 0 ? threads : 1;
+    }
+
+    unsigned getThreadCount() const { return threadCount; }
+
+    // Annulation externe (ex. : un autre nœud a publié le bloc)
+    void cancel() {
+        uint64_t current = runs.load();
+        uint64_t seen = cancelledRuns.load();
+        while (seen < current && !cancelledRuns.compare_exchange_weak(seen, current)) {}
+    }
+
+    MiningResult mine(const PoWBlock& block, long long startNonce = 0) {
+        METRIC_TIME(Mining);
+        MiningResult result;
+        result.attemptsPerThread.assign(threadCount, 0);
+        const uint64_t run = runs.fetch_add(1) + 1;
+        auto stopped = [&] { return cancelledRuns.load(std::memory_order_relaxed) >= run; };
+
+        std::atomic<long long> nextChunk(startNonce);
+        std::atomic<long long> best(LLONG_MAX);
+
+        const HeaderHasher hasher = block.headerHasher();
+
+        auto worker = [&](unsigned t) {
+            unsigned long long attempts = 0;
+            for (;;) {
+                long long begin = nextChunk.fetch_add(chunkSize);
+                if (begin >= best.load() || stopped()) break;
+                long long end = (begin > LLONG_MAX - chunkSize) ? LLONG_MAX : begin + chunkSize;
+
+                // Lots de MAX_LANES nonces hachés ensemble par le noyau multi-buffer
+                const long long batch = static_cast<long long>(Sha256MultiBuffer::MAX_LANES);
+                for (long long n = begin; n < end; n += batch) {
+                    if (n >= best.load(std::memory_order_relaxed) || stopped()) {
+                        break;
+                    }
+                    size_t count = static_cast<size_t>(std::min(batch, end - n));
+                    int hit = block.findValidNonce(hasher, n, count);
+                    if (hit >= 0) {
+                        attempts += static_cast<unsigned long long>(hit) + 1;
+                        long long found = n + hit;
+                        long long current = best.load();
+                        while (found < current && !best.compare_exchange_weak(current, found)) {}
+                        break;
+                    }
+                    attempts += count;
+                }
+            }
+            result.attemptsPerThread[t] = attempts;
+            METRIC_ADD(NonceAttempts, attempts);
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threadCount; ++t) workers.emplace_back(worker, t);
+        worker(0);
+        for (auto& w : workers) w.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        result.seconds = std::chrono::duration<double>(end - start).count();
+
+        if (best.load() != LLONG_MAX) {
+            result.found = true;
+            result.nonce = best.load();
+            result.hash = block.hashWithNonce(result.nonce);
+        }
+        return result;
+    }
+};
+
+// ==================================================
+// BLOC PoS
+// ==================================================
+class PoSBlock : public Block {
+public:
+    std::string validatorId;
+
+    PoSBlock(size_t idx, const Hash256& prevHash, std::vector<Transaction> txs, ThreadPool* pool = nullptr)
+        : Block(idx, prevHash, std::move(txs), pool), validatorId("none") {}
+
+    PoSBlock(size_t idx, const Hash256& prevHash, const Hash256& merkle, const std::string& time,
+        const Hash256& h, const std::string& validator)
+        : Block(idx, prevHash, merkle, time, h), validatorId(validator) {}
+
+    // Sélection O(1) pondérée par le stake, graine = hash du bloc
+    void selectValidator(const ValidatorRegistry& registry) {
+        const Validator* elected = registry.select(hash);
+        validatorId = elected ? elected->id : "default";
+    }
+
+    void finalize() {}
+
+    std::string getConsensusInfo() const {
+        return "PoS (validator=" + validatorId + ")";
+    }
+
+    // Rejoue la sélection ; sans registre connu pour l'époque, rien à vérifier
+    bool verifyConsensus(const ValidatorRegistry* registry) const {
+        if (!registry) return true;
+        const Validator* elected = registry->select(hash);
+        return validatorId == (elected ? elected->id : "default");
+    }
+};
+
+// ==================================================
+// STOCKAGE PERSISTANT
+// ==================================================
+// Projection mémoire d'un fichier (mmap / MapViewOfFile), en lecture seule ou
+// en lecture-écriture (les écritures arrivent dans le fichier via le cache du système)
+class MappedFile {
+private:
+    const uint8_t* ptr;
+    size_t length;
+    bool writable;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+
+public:
+    MappedFile() : ptr(nullptr), length(0), writable(false) {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#endif
+    }
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) { close(); return false; }
+        length = static_cast<size_t>(size.QuadPart);
+        if (length == 0) return true;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) { close(); return false; }
+        ptr = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!ptr) { close(); return false; }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) { ::close(fd); length = 0; return false; }
+            ptr = static_cast<const uint8_t*>(p);
+        }
+        ::close(fd);
+#endif
+        return true;
+    }
+
+    // Projection en lecture-écriture ; le fichier est créé ou agrandi (zéros) à 'size' octets
+    bool openWritable(const std::string& path, size_t size) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER current;
+        if (!GetFileSizeEx(file, &current)) { close(); return false; }
+        length = std::max(size, static_cast<size_t>(current.QuadPart));
+        if (length == 0) return true;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(uint64_t(length) >> 32),
+            static_cast<DWORD>(length), nullptr);
+        if (!mapping) { close(); return false; }
+        ptr = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+        if (!ptr) { close(); return false; }
+#else
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+        length = std::max(size, static_cast<size_t>(st.st_size));
+        if (static_cast<size_t>(st.st_size) < length && ftruncate(fd, static_cast<off_t>(length)) != 0) {
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        if (length > 0) {
+            void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) { ::close(fd); length = 0; return false; }
+            ptr = static_cast<const uint8_t*>(p);
+        }
+        ::close(fd);
+#endif
+        writable = true;
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (ptr) munmap(const_cast<uint8_t*>(ptr), length);
+#endif
+        ptr = nullptr;
+        length = 0;
+        writable = false;
+    }
+
+    const uint8_t* data() const { return ptr; }
+    uint8_t* mutableData() { return writable ? const_cast<uint8_t*>(ptr) : nullptr; }
+    size_t size() const { return length; }
+};
+
+// Magasin de blocs en ajout seul.
+//  - segments "segment_NNNNNN.dat" : enregistrements binaires concaténés, un
+//    nouveau segment est ouvert quand le courant dépasse 'segmentSize'
+//  - "index.dat" : une entrée fixe de 16 octets par hauteur (segment, taille, offset)
+// Enregistrement : magic | taille totale | taille de l'en-tête | type | BlockHeader
+// canonique | hash | consensus || nombre de transactions | encodages canoniques
+// suivis chacun de leur signature (64 octets).
+// À l'ouverture, l'index et les segments sont projetés en mémoire : seuls les
+// en-têtes sont décodés, les corps ne le sont qu'à la demande. Un enregistrement
+// final incomplet (arrêt brutal) est tronqué, un index en retard est complété.
+class BlockStore {
+public:
+    static constexpr uint32_t MAGIC = 0x364B4C42; // "BLK6"
+    static constexpr size_t INDEX_ENTRY_SIZE = 16;
+
+private:
+    struct IndexEntry {
+        uint32_t segment;
+        uint32_t size;
+        uint64_t offset;
+    };
+
+    enum BlockType : uint8_t { BASE = 0, POW = 1, POS = 2 };
+
+    std::string directory;
+    uint64_t segmentSize;
+    std::vector<IndexEntry> entries;
+    std::vector<uint64_t> segmentLengths;
+    std::ofstream segmentOut;
+    std::ofstream indexOut;
+
+    // Projections des segments ; les anciennes projections restent valides
+    // jusqu'à la fermeture (lectures concurrentes pendant un remappage)
+    mutable std::mutex mapMutex;
+    mutable std::vector<std::shared_ptr<MappedFile> > maps;
+    mutable std::vector<std::shared_ptr<MappedFile> > retiredMaps;
+
+    std::string segmentPath(uint32_t segment) const {
+        std::ostringstream oss;
+        oss << directory << "/segment_" << std::setw(6) << std::setfill('0') << segment << ".dat";
+        return oss.str();
+    }
+
+    std::string indexPath() const { return directory + "/index.dat"; }
+
+    const uint8_t* recordData(const IndexEntry& e) const {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        if (maps.size() <= e.segment) maps.resize(e.segment + 1);
+        std::shared_ptr<MappedFile>& m = maps[e.segment];
+        if (!m || m->size() < e.offset + e.size) {
+            if (m) retiredMaps.push_back(m);
+            m = std::make_shared<MappedFile>();
+            if (!m->open(segmentPath(e.segment)) || m->size() < e.offset + e.size) {
+                throw std::runtime_error("BlockStore : segment illisible " + segmentPath(e.segment));
+            }
+        }
+        return m->data() + e.offset;
+    }
+
+    static void writeIndexEntry(std::ofstream& out, const IndexEntry& e) {
+        std::vector<uint8_t> buf;
+        ByteWriter w(buf);
+        w.u32(e.segment);
+        w.u32(e.size);
+        w.u64(e.offset);
+        out.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+    }
+
+    // Relit l'index projeté, puis parcourt les segments après la dernière entrée
+    // pour récupérer les enregistrements écrits mais pas encore indexés
+    void open() {
+        std::filesystem::create_directories(directory);
+        for (uint32_t s = 0;; ++s) {
+            std::error_code ec;
+            uint64_t len = std::filesystem::file_size(segmentPath(s), ec);
+            if (ec) break;
+            segmentLengths.push_back(len);
+        }
+
+        MappedFile index;
+        if (index.open(indexPath()) && index.size() > 0) {
+            size_t count = index.size() / INDEX_ENTRY_SIZE;
+            ByteReader r(index.data(), count * INDEX_ENTRY_SIZE);
+            for (size_t i = 0; i < count; ++i) {
+                IndexEntry e;
+                e.segment = r.u32();
+                e.size = r.u32();
+                e.offset = r.u64();
+                if (e.segment >= segmentLengths.size() || e.offset + e.size > segmentLengths[e.segment]) break;
+                entries.push_back(e);
+            }
+        }
+        bool indexComplete = index.size() == entries.size() * INDEX_ENTRY_SIZE;
+        index.close();
+
+        uint32_t segment = entries.empty() ? 0 : entries.back().segment;
+        uint64_t offset = entries.empty() ? 0 : entries.back().offset + entries.back().size;
+        size_t recovered = 0;
+        while (segment < segmentLengths.size()) {
+            MappedFile seg;
+            seg.open(segmentPath(segment));
+            while (offset + 12 <= seg.size()) {
+                ByteReader r(seg.data() + offset, seg.size() - offset);
+                uint32_t magic = r.u32();
+                uint32_t size = r.u32();
+                if (magic != MAGIC || size < 12 || offset + size > seg.size()) break;
+                entries.push_back(IndexEntry{ segment, size, offset });
+                offset += size;
+                ++recovered;
+            }
+            if (offset < segmentLengths[segment]) {
+                // Fin de segment corrompue ou incomplète : on la coupe
+                seg.close();
+                std::filesystem::resize_file(segmentPath(segment), offset);
+                segmentLengths[segment] = offset;
+            }
+            if (segment + 1 >= segmentLengths.size()) break;
+            ++segment;
+            offset = 0;
+        }
+
+        if (!indexComplete || recovered > 0) {
+            std::ofstream rebuilt(indexPath(), std::ios::binary | std::ios::trunc);
+            for (const auto& e : entries) writeIndexEntry(rebuilt, e);
+        }
+        if (segmentLengths.empty()) segmentLengths.push_back(0);
+        segmentOut.open(segmentPath(static_cast<uint32_t>(segmentLengths.size() - 1)), std::ios::binary | std::ios::app);
+        indexOut.open(indexPath(), std::ios::binary | std::ios::app);
+        if (!segmentOut || !indexOut) throw std::runtime_error("BlockStore : impossible d'ouvrir " + directory);
+    }
+
+public:
+    // Codec des enregistrements, repris tel quel par le relais réseau
+    static void encode(const Block& block, std::vector<uint8_t>& out);
+    static std::unique_ptr<Block> decodeHeader(const uint8_t* data, size_t size);
+    // received : corps reçu du réseau, décodé par Transaction::decodeReceived
+    static std::vector<Transaction> decodeTransactions(const uint8_t* data, size_t size, bool received = false);
+
+    explicit BlockStore(const std::string& dir, uint64_t maxSegmentSize = 64ull << 20)
+        : directory(dir), segmentSize(maxSegmentSize) {
+        open();
+    }
+
+    size_t size() const { return entries.size(); }
+
+    uint64_t diskSize() const {
+        uint64_t total = entries.size() * INDEX_ENTRY_SIZE;
+        for (auto len : segmentLengths) total += len;
+        return total;
+    }
+
+    void append(const Block& block) {
+        std::vector<uint8_t> record;
+        encode(block, record);
+
+        uint32_t segment = static_cast<uint32_t>(segmentLengths.size() - 1);
+        if (segmentLengths[segment] > 0 && segmentLengths[segment] + record.size() > segmentSize) {
+            segmentOut.close();
+            segmentLengths.push_back(0);
+            ++segment;
+            segmentOut.open(segmentPath(segment), std::ios::binary | std::ios::app);
+        }
+        IndexEntry e{ segment, static_cast<uint32_t>(record.size()), segmentLengths[segment] };
+        segmentOut.write(reinterpret_cast<const char*>(record.data()), static_cast<std::streamsize>(record.size()));
+        segmentOut.flush();
+        writeIndexEntry(indexOut, e);
+        indexOut.flush();
+        if (!segmentOut || !indexOut) throw std::runtime_error("BlockStore : écriture impossible dans " + directory);
+        segmentLengths[segment] += record.size();
+        entries.push_back(e);
+    }
+
+    // Ne garde que les 'height' premiers blocs (réorganisation de la chaîne).
+    // Segments coupés avant l'index, du dernier au premier : après un arrêt en
+    // cours de route, open() ignore les entrées d'index qui dépassent les segments
+    // et ne retrouve aucun enregistrement coupé. Aucune lecture concurrente.
+    void truncate(size_t height) {
+        if (height >= entries.size()) return;
+        uint32_t last = height == 0 ? 0 : entries[height - 1].segment;
+        uint64_t length = height == 0 ? 0 : entries[height - 1].offset + entries[height - 1].size;
+        segmentOut.close();
+        indexOut.close();
+        {
+            std::lock_guard<std::mutex> lock(mapMutex);
+            maps.clear();
+            retiredMaps.clear();
+        }
+        for (size_t s = segmentLengths.size() - 1; s > last; --s) std::filesystem::remove(segmentPath(static_cast<uint32_t>(s)));
+        std::filesystem::resize_file(segmentPath(last), length);
+        std::filesystem::resize_file(indexPath(), height * INDEX_ENTRY_SIZE);
+        segmentLengths.resize(last + 1);
+        segmentLengths[last] = length;
+        entries.resize(height);
+        segmentOut.open(segmentPath(last), std::ios::binary | std::ios::app);
+        indexOut.open(indexPath(), std::ios::binary | std::ios::app);
+        if (!segmentOut || !indexOut) throw std::runtime_error("BlockStore : impossible de rouvrir " + directory);
+    }
+
+    // En-tête seul (Block, PoWBlock ou PoSBlock sans transactions)
+    std::unique_ptr<Block> loadHeader(size_t height) const {
+        const IndexEntry& e = entries.at(height);
+        return decodeHeader(recordData(e), e.size);
+    }
+
+    std::vector<Transaction> loadTransactions(size_t height) const {
+        const IndexEntry& e = entries.at(height);
+        return decodeTransactions(recordData(e), e.size);
+    }
+
+    // Enregistrement brut, tel qu'écrit sur disque
+    void loadRecord(size_t height, std::vector<uint8_t>& out) const {
+        const IndexEntry& e = entries.at(height);
+        const uint8_t* data = recordData(e);
+        out.assign(data, data + e.size);
+    }
+};
+
+std::vector<Transaction> BlockStore::decodeTransactions(const uint8_t* data, size_t size, bool received) {
+    // Préfixe fixe : magic, taille totale, taille de l'en-tête (12 octets)
+    if (size < 12) throw std::runtime_error("BlockStore : enregistrement tronqué");
+    ByteReader header(data, size);
+    if (header.u32() != MAGIC) throw std::runtime_error("BlockStore : enregistrement invalide");
+    header.u32();
+    uint32_t headerSize = header.u32();
+    if (headerSize < 12 || headerSize > size) throw std::runtime_error("BlockStore : en-tête invalide");
+    ByteReader r(data + headerSize, size - headerSize);
+    uint32_t count = r.u32();
+    if (count > r.remaining() / Transaction::MIN_SIGNED_SIZE) throw std::runtime_error("BlockStore : nombre de transactions invalide");
+    std::vector<Transaction> txs;
+    txs.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) txs.push_back(received ? Transaction::decodeReceived(r) : Transaction::decodeSigned(r));
+    return txs;
+}
+
+void BlockStore::encode(const Block& block, std::vector<uint8_t>& out) {
+    out.clear();
+    ByteWriter w(out);
+    w.u32(MAGIC);
+    w.u32(0); // taille totale, complétée à la fin
+    w.u32(0); // taille de l'en-tête
+    const PoWBlock* pow = dynamic_cast<const PoWBlock*>(&block);
+    const PoSBlock* pos = dynamic_cast<const PoSBlock*>(&block);
+    w.u8(pow ? POW : (pos ? POS : BASE));
+    uint8_t header[BlockHeader::SIZE];
+    BlockHeader(block.index, block.previousHash, block.merkleRoot, block.timestamp,
+        pow ? pow->nonce : 0, pow ? pow->target : Hash256()).serialize(header);
+    w.bytes(header, sizeof(header));
+    w.hash(block.hash);
+    if (pos) w.str16(pos->validatorId);
+    uint32_t headerSize = static_cast<uint32_t>(out.size());
+
+    w.u32(static_cast<uint32_t>(block.transactions.size()));
+    for (const auto& tx : block.transactions) tx.encodeSigned(w);
+
+    uint32_t total = static_cast<uint32_t>(out.size());
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = uint8_t(total >> (8 * i));
+        out[8 + i] = uint8_t(headerSize >> (8 * i));
+    }
+}
+
+std::unique_ptr<Block> BlockStore::decodeHeader(const uint8_t* data, size_t size) {
+    ByteReader r(data, size);
+    if (r.u32() != MAGIC) throw std::runtime_error("BlockStore : enregistrement invalide");
+    r.u32();
+    r.u32();
+    uint8_t type = r.u8();
+    BlockHeader header = BlockHeader::decode(r);
+    size_t index = static_cast<size_t>(header.index);
+    const Hash256& prev = header.previousHash;
+    const Hash256& merkle = header.merkleRoot;
+    std::string timestamp = header.timestampString();
+    Hash256 hash = r.hash();
+    if (type == POW) {
+        long long nonce = static_cast<long long>(header.nonce);
+        return std::unique_ptr<Block>(new PoWBlock(index, prev, merkle, timestamp, hash, nonce, header.target));
+    }
+    if (type == POS) {
+        std::string validatorId = r.str16();
+        if (validatorId.size() > AccountNames::MAX_NAME_SIZE) throw std::runtime_error("BlockStore : validateur invalide");
+        return std::unique_ptr<Block>(new PoSBlock(index, prev, merkle, timestamp, hash, validatorId));
+    }
+    return std::unique_ptr<Block>(new Block(index, prev, merkle, timestamp, hash));
+}
+
+// ==================================================
+// INDEX DE LA CHAÎNE (EN-TÊTES)
+// ==================================================
+enum class BlockKind : uint8_t { Base, PoW, PoS };
+
+// En-têtes de taille fixe rangés colonne par colonne (structure de tableaux) :
+// un parcours qui ne lit que hash et previousHash ne charge que ces deux
+// colonnes, les transactions restant dans les blocs complets (ou sur disque).
+// Recherche hash -> hauteur en O(1) par adressage ouvert (sondage linéaire).
+class ChainIndex {
+public:
+    static constexpr size_t npos = SIZE_MAX;
+
+private:
+    std::vector<Hash256> hashes;
+    std::vector<Hash256> previousHashes;
+    std::vector<Hash256> merkleRoots;
+    std::vector<std::array<char, 20> > timestamps;
+    std::vector<Hash256> targets;     // PoW uniquement (nulle sinon)
+    std::vector<uint64_t> consensus;  // nonce (PoW) ou id interné du validateur (PoS)
+    std::vector<BlockKind> kinds;
+    std::vector<double> cumulativeWork; // poids cumulé depuis la génèse (choix de branche)
+
+    // Case = hauteur + 1 (0 = vide) ; facteur de charge <= 1/2
+    std::vector<uint32_t> table;
+
+    // Derniers octets du hash : les premiers sont nuls pour les blocs PoW
+    static size_t slotOf(const Hash256& h) {
+        return static_cast<size_t>(h.word(3));
+    }
+
+    void insert(size_t height) {
+        size_t mask = table.size() - 1;
+        size_t slot = slotOf(hashes[height]) & mask;
+        while (table[slot] != 0) slot = (slot + 1) & mask;
+        table[slot] = static_cast<uint32_t>(height + 1);
+    }
+
+    void rehash(size_t capacity) {
+        table.assign(capacity, 0);
+        for (size_t h = 0; h < hashes.size(); ++h) insert(h);
+    }
+
+    // Suppression par décalage arrière : une entrée suivante du groupe revient
+    // dans le trou si sa case d'origine ne se trouve pas entre le trou et elle
+    void erase(size_t height) {
+        size_t mask = table.size() - 1;
+        size_t hole = slotOf(hashes[height]) & mask;
+        while (table[hole] != height + 1) hole = (hole + 1) & mask;
+        for (size_t next = (hole + 1) & mask; table[next] != 0; next = (next + 1) & mask) {
+            size_t home = slotOf(hashes[table[next] - 1]) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                table[hole] = table[next];
+                hole = next;
+            }
+        }
+        table[hole] = 0;
+    }
+
+public:
+    ChainIndex() : table(16, 0) {}
+
+    size_t size() const { return hashes.size(); }
+
+    void clear() {
+        hashes.clear();
+        previousHashes.clear();
+        merkleRoots.clear();
+        timestamps.clear();
+        targets.clear();
+        consensus.clear();
+        kinds.clear();
+        cumulativeWork.clear();
+        table.assign(16, 0);
+    }
+
+    void reserve(size_t count) {
+        hashes.reserve(count);
+        previousHashes.reserve(count);
+        merkleRoots.reserve(count);
+        timestamps.reserve(count);
+        targets.reserve(count);
+        consensus.reserve(count);
+        kinds.reserve(count);
+        cumulativeWork.reserve(count);
+        size_t capacity = table.size();
+        while (capacity < 2 * count) capacity *= 2;
+        if (capacity != table.size()) rehash(capacity);
+    }
+
+    // Le bloc doit être le suivant de la chaîne (block.index == size())
+    void append(const Block& block, double blockWork = 0.0) {
+        if (block.index != hashes.size()) throw std::invalid_argument("ChainIndex : hauteur inattendue");
+        if (hashes.size() >= UINT32_MAX - 1) throw std::length_error("ChainIndex : chaîne trop longue");
+        hashes.push_back(block.hash);
+        previousHashes.push_back(block.previousHash);
+        merkleRoots.push_back(block.merkleRoot);
+        std::array<char, 20> time;
+        BlockHeader::copyField(time.data(), time.size(), block.timestamp);
+        timestamps.push_back(time);
+
+        Hash256 target;
+        uint64_t word = 0;
+        BlockKind kind = BlockKind::Base;
+        if (const PoWBlock* pow = dynamic_cast<const PoWBlock*>(&block)) {
+            kind = BlockKind::PoW;
+            target = pow->target;
+            word = static_cast<uint64_t>(pow->nonce);
+        }
+        else if (const PoSBlock* pos = dynamic_cast<const PoSBlock*>(&block)) {
+            kind = BlockKind::PoS;
+            word = AccountNames::instance().intern(pos->validatorId);
+        }
+        targets.push_back(target);
+        consensus.push_back(word);
+        kinds.push_back(kind);
+        cumulativeWork.push_back((cumulativeWork.empty() ? 0.0 : cumulativeWork.back()) + blockWork);
+
+        if (2 * hashes.size() > table.size()) rehash(2 * table.size());
+        else insert(hashes.size() - 1);
+    }
+
+    // Hauteur du bloc de hash 'h', ou npos
+    size_t find(const Hash256& h) const {
+        size_t mask = table.size() - 1;
+        for (size_t slot = slotOf(h) & mask; table[slot] != 0; slot = (slot + 1) & mask) {
+            size_t height = table[slot] - 1;
+            if (hashes[height] == h) return height;
+        }
+        return npos;
+    }
+
+    bool contains(const Hash256& h) const { return find(h) != npos; }
+
+    // Retire les en-têtes à partir de 'newSize' : coût proportionnel au nombre retiré
+    void truncate(size_t newSize) {
+        while (hashes.size() > newSize) {
+            erase(hashes.size() - 1);
+            hashes.pop_back();
+            previousHashes.pop_back();
+            merkleRoots.pop_back();
+            timestamps.pop_back();
+            targets.pop_back();
+            consensus.pop_back();
+            kinds.pop_back();
+            cumulativeWork.pop_back();
+        }
+    }
+
+    const Hash256& hash(size_t height) const { return hashes[height]; }
+    const Hash256& previousHash(size_t height) const { return previousHashes[height]; }
+    const Hash256& merkleRoot(size_t height) const { return merkleRoots[height]; }
+    const Hash256& target(size_t height) const { return targets[height]; }
+    BlockKind kind(size_t height) const { return kinds[height]; }
+    long long nonce(size_t height) const { return static_cast<long long>(consensus[height]); }
+    double work(size_t height) const { return cumulativeWork[height]; }
+
+    std::string timestamp(size_t height) const {
+        const std::array<char, 20>& t = timestamps[height];
+        return std::string(t.data(), strnlen(t.data(), t.size()));
+    }
+
+    uint64_t timeMillis(size_t height) const {
+        const std::array<char, 20>& t = timestamps[height];
+        return parseBlockTime(std::string_view(t.data(), strnlen(t.data(), t.size())));
+    }
+
+    std::string_view validator(size_t height) const {
+        return AccountNames::instance().name(static_cast<AccountId>(consensus[height]));
+    }
+
+    // En-tête canonique (cible et nonce nuls hors PoW)
+    BlockHeader header(size_t height) const {
+        bool pow = kinds[height] == BlockKind::PoW;
+        return BlockHeader(height, previousHashes[height], merkleRoots[height], timestamp(height),
+            pow ? nonce(height) : 0, targets[height]);
+    }
+
+    // Même texte que Block::getConsensusInfo, sans toucher au bloc complet
+    std::string consensusInfo(size_t height) const {
+        std::ostringstream oss;
+        switch (kinds[height]) {
+        case BlockKind::PoW:
+            oss << "PoW (nonce=" << nonce(height) << ", diff=" << std::fixed << std::setprecision(1)
+                << targetDifficulty(targets[height]) << ")";
+            break;
+        case BlockKind::PoS:
+            oss << "PoS (validator=" << validator(height) << ")";
+            break;
+        default:
+            oss << "Base";
+        }
+        return oss.str();
+    }
+
+    // Première hauteur >= from dont previousHash ne désigne pas le bloc précédent
+    // (ou dont le hash PoW dépasse la cible engagée), npos si aucune
+    size_t firstInvalidHeader(size_t from = 1) const {
+        for (size_t h = std::max<size_t>(from, 1); h < hashes.size(); ++h) {
+            if (previousHashes[h] != hashes[h - 1]) return h;
+            if (kinds[h] == BlockKind::PoW && (targets[h].isZero() || !meetsTarget(hashes[h], targets[h]))) return h;
+        }
+        return npos;
+    }
+};
+
+// ==================================================
+// VALIDATION COMPLÈTE
+// ==================================================
+enum class BlockError { None, Index, Hash, MerkleRoot, Consensus, Signature, Link };
+
+inline const char* blockErrorName(BlockError e) {
+    switch (e) {
+    case BlockError::Index: return "index incohérent";
+    case BlockError::Hash: return "hash de l'en-tête incorrect";
+    case BlockError::MerkleRoot: return "racine de Merkle ne correspond pas aux transactions";
+    case BlockError::Consensus: return "règle de consensus non respectée";
+    case BlockError::Signature: return "signature de transaction invalide";
+    case BlockError::Link: return "previousHash invalide";
+    default: return "aucune";
+    }
+}
+
+struct ValidationReport {
+    bool valid;
+    size_t firstInvalid;   // hauteur du premier bloc invalide (si !valid)
+    BlockError error;
+    size_t blocksChecked;
+    double seconds;
+
+    ValidationReport() : valid(true), firstInvalid(0), error(BlockError::None), blocksChecked(0), seconds(0) {}
+
+    double blocksPerSecond() const {
+        return seconds > 0 ? blocksChecked / seconds : 0.0;
+    }
+};
+
+// ==================================================
+// ÉTAT DES COMPTES
+// ==================================================
+// Soldes et prochains nonces indexés directement par AccountId (noms internés).
+// Chaque bloc appliqué empile un journal des comptes d'avant-bloc, ce qui permet
+// d'annuler les blocs dans l'ordre inverse.
+// Une transaction est acceptée si son nonce est le prochain de l'expéditeur,
+// 0 < montant <= MAX_MONEY, 0 <= frais <= MAX_MONEY, expéditeur différent du
+// destinataire, solde de l'expéditeur >= montant + frais et solde du
+// destinataire sans débordement ; sinon elle est ignorée sans effet (son nonce
+// reste libre).
+//
+// Application parallèle : chaque transaction est placée dans la vague qui suit
+// la dernière vague ayant touché son expéditeur ou son destinataire. Les
+// transactions d'une même vague portent sur des comptes disjoints et sont
+// appliquées en parallèle ; chaque compte voit ses transactions dans l'ordre du
+// bloc, d'où un résultat identique (au bit près) à l'application série.
+class AccountLedger {
+public:
+    struct BlockResult {
+        std::vector<uint8_t> accepted; // 1 si la transaction i a été appliquée
+        size_t acceptedCount;
+        Amount fees;                   // somme des frais des transactions acceptées
+        size_t waves;                  // nombre de vagues sans conflit
+
+        BlockResult() : acceptedCount(0), fees(0), waves(0) {}
+    };
+
+private:
+    static constexpr size_t PARALLEL_MIN_TX = 1024;
+    static constexpr size_t PARALLEL_GRAIN = 256;
+
+    // Compte tel qu'avant le bloc, pour l'annulation
+    struct JournalEntry {
+        size_t slot;
+        Amount balance;
+        uint64_t nonce;
+    };
+
+    std::vector<Amount> balances;
+    std::vector<uint64_t> nonces; // prochain nonce attendu de chaque compte
+    std::deque<std::vector<JournalEntry> > journals; // MAX_JOURNAL_DEPTH derniers blocs
+    // Dernière vague de chaque compte dans le bloc en cours, valable seulement
+    // si waveEpochs[slot] == epoch : rien à remettre à zéro entre deux blocs
+    std::vector<uint32_t> lastWaves;
+    std::vector<uint32_t> waveEpochs;
+    uint32_t epoch = 0;
+
+    size_t slotFor(AccountId account) {
+        if (account >= balances.size()) {
+            balances.resize(static_cast<size_t>(account) + 1, 0);
+            nonces.resize(balances.size(), 0);
+            lastWaves.resize(balances.size(), 0);
+            waveEpochs.resize(balances.size(), 0);
+        }
+        return account;
+    }
+
+    uint32_t lastWave(size_t slot) const { return waveEpochs[slot] == epoch ? lastWaves[slot] : 0; }
+
+public:
+    // Blocs annulables par rollbackBlock ; une réorganisation plus profonde
+    // reconstruit l'état depuis la chaîne (Blockchain::rebuildLedger)
+    static constexpr size_t MAX_JOURNAL_DEPTH = 1024;
+
+    bool applyOne(const Transaction& tx, size_t sender, size_t receiver) {
+        if (sender == receiver || tx.nonce != nonces[sender] || tx.amount <= 0 || !moneyRange(tx.amount) ||
+            !moneyRange(tx.fee)) return false;
+        Amount debit, credited;
+        if (__builtin_add_overflow(tx.amount, tx.fee, &debit) || balances[sender] < debit) return false;
+        if (__builtin_add_overflow(balances[receiver], tx.amount, &credited)) return false;
+        balances[sender] -= debit;
+        balances[receiver] = credited;
+        ++nonces[sender];
+        return true;
+    }
+
+public:
+    // Allocation initiale (hors journal, non annulable)
+    void credit(AccountId account, Amount amount) {
+        balances[slotFor(account)] += amount;
+    }
+
+    void credit(const std::string& account, Amount amount) {
+        credit(AccountNames::instance().intern(account), amount);
+    }
+
+    Amount balance(AccountId account) const {
+        return account < balances.size() ? balances[account] : 0;
+    }
+
+    Amount balance(const std::string& account) const {
+        AccountId id;
+        return AccountNames::instance().find(account, id) ? balance(id) : 0;
+    }
+
+    // Nonce que doit porter la prochaine transaction émise par le compte
+    uint64_t nextNonce(AccountId account) const {
+        return account < nonces.size() ? nonces[account] : 0;
+    }
+
+    uint64_t nextNonce(const std::string& account) const {
+        AccountId id;
+        return AccountNames::instance().find(account, id) ? nextNonce(id) : 0;
+    }
+
+    size_t accountCount() const { return balances.size(); }
+    size_t depth() const { return journals.size(); }
+
+    // Applique un bloc ; 'pool' (facultatif) parallélise les grands blocs
+    BlockResult applyBlock(const std::vector<Transaction>& txs, ThreadPool* pool = nullptr) {
+        const size_t n = txs.size();
+        BlockResult result;
+        result.accepted.assign(n, 0);
+        if (journals.size() == MAX_JOURNAL_DEPTH) journals.pop_front();
+        journals.emplace_back();
+        std::vector<JournalEntry>& journal = journals.back();
+
+        std::vector<size_t> senders(n), receivers(n);
+        for (size_t i = 0; i < n; ++i) {
+            senders[i] = slotFor(txs[i].sender);
+            receivers[i] = slotFor(txs[i].receiver);
+        }
+
+        // Vagues : 1 + dernière vague de l'un des deux comptes
+        if (++epoch == 0) {
+            std::fill(waveEpochs.begin(), waveEpochs.end(), 0);
+            epoch = 1;
+        }
+        std::vector<uint32_t> txWave(n);
+        uint32_t waves = 0;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t slot : { senders[i], receivers[i] }) {
+                if (lastWave(slot) == 0) journal.push_back(JournalEntry{ slot, balances[slot], nonces[slot] });
+            }
+            uint32_t w = std::max(lastWave(senders[i]), lastWave(receivers[i])) + 1;
+            for (size_t slot : { senders[i], receivers[i] }) {
+                lastWaves[slot] = w;
+                waveEpochs[slot] = epoch;
+            }
+            txWave[i] = w;
+            waves = std::max(waves, w);
+        }
+        result.waves = waves;
+
+        if (!pool || pool->size() == 0 || n < PARALLEL_MIN_TX) {
+            for (size_t i = 0; i < n; ++i) result.accepted[i] = applyOne(txs[i], senders[i], receivers[i]) ? 1 : 0;
+        }
+        else {
+            // Tri par comptage des transactions par vague (ordre du bloc conservé)
+            std::vector<size_t> waveStart(waves + 2, 0);
+            for (size_t i = 0; i < n; ++i) ++waveStart[txWave[i] + 1];
+            for (size_t w = 1; w < waveStart.size(); ++w) waveStart[w] += waveStart[w - 1];
+            std::vector<size_t> order(n);
+            std::vector<size_t> fill(waveStart.begin(), waveStart.end() - 1);
+            for (size_t i = 0; i < n; ++i) order[fill[txWave[i]]++] = i;
+
+            for (uint32_t w = 1; w <= waves; ++w) {
+                const size_t* wave = order.data() + waveStart[w];
+                pool->parallelFor(waveStart[w + 1] - waveStart[w], PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+                    for (size_t k = begin; k < end; ++k) {
+                        size_t i = wave[k];
+                        result.accepted[i] = applyOne(txs[i], senders[i], receivers[i]) ? 1 : 0;
+                    }
+                });
+            }
+        }
+
+        // Somme plafonnée à INT64_MAX : l'excédent est brûlé
+        for (size_t i = 0; i < n; ++i) {
+            if (!result.accepted[i]) continue;
+            ++result.acceptedCount;
+            if (__builtin_add_overflow(result.fees, txs[i].fee, &result.fees)) result.fees = INT64_MAX;
+        }
+        return result;
+    }
+
+    // Verse les frais du dernier bloc appliqué à son producteur ; false (frais
+    // brûlés, comme pour un bloc PoW) si son solde déborderait
+    bool payFees(const std::string& recipient, Amount amount) {
+        if (journals.empty()) throw std::logic_error("AccountLedger : aucun bloc appliqué");
+        size_t slot = slotFor(AccountNames::instance().intern(recipient));
+        Amount credited;
+        if (amount < 0 || __builtin_add_overflow(balances[slot], amount, &credited)) return false;
+        journals.back().push_back(JournalEntry{ slot, balances[slot], nonces[slot] });
+        balances[slot] = credited;
+        return true;
+    }
+
+    // Annule le dernier bloc appliqué ; false si aucun
+    bool rollbackBlock() {
+        if (journals.empty()) return false;
+        const auto& journal = journals.back();
+        // Ordre inverse : la première valeur enregistrée d'un compte l'emporte
+        for (auto it = journal.rbegin(); it != journal.rend(); ++it) {
+            balances[it->slot] = it->balance;
+            nonces[it->slot] = it->nonce;
+        }
+        journals.pop_back();
+        return true;
+    }
+};
+
+// ==================================================
+// ENSEMBLE UTXO
+// ==================================================
+// Modèle facultatif à sorties non dépensées, à côté du modèle à comptes : une
+// transaction consomme des sorties antérieures (ses entrées) et en crée de
+// nouvelles. Une sortie ne se dépense qu'une fois ; la double dépense se
+// détecte par une recherche dans l'ensemble des sorties non dépensées, sans
+// parcourir l'historique.
+
+// Référence compacte à une sortie : txid binaire et numéro de sortie (36 octets)
+struct OutPoint {
+    Hash256 txid;
+    uint32_t index;
+
+    OutPoint() : txid(), index(0) {}
+    OutPoint(const Hash256& id, uint32_t i) : txid(id), index(i) {}
+
+    bool operator==(const OutPoint& o) const { return index == o.index && txid == o.txid; }
+    bool operator!=(const OutPoint& o) const { return !(*this == o); }
+
+    // Derniers octets du txid (déjà uniformes) mélangés au numéro de sortie
+    static uint64_t mix(uint64_t txidWord, uint32_t index) { return txidWord ^ (uint64_t(index) * 0x9E3779B97F4A7C15ULL); }
+    uint64_t slotHash() const { return mix(txid.word(3), index); }
+};
+
+struct OutPointHasher {
+    size_t operator()(const OutPoint& o) const { return static_cast<size_t>(o.slotHash()); }
+};
+
+struct TxOutput {
+    AccountId owner;
+    Amount value;
+};
+
+// Sortie non dépensée : propriétaire, montant et hauteur du bloc créateur
+struct Coin {
+    AccountId owner;
+    uint32_t height;
+    Amount value;
+
+    Coin() : owner(0), height(0), value(0) {}
+    Coin(AccountId o, Amount v, uint32_t h) : owner(o), height(h), value(v) {}
+
+    bool operator==(const Coin& c) const { return owner == c.owner && height == c.height && value == c.value; }
+    bool operator!=(const Coin& c) const { return !(*this == c); }
+};
+
+// Transaction UTXO. Sans entrée, c'est la création monétaire du bloc : seule
+// la première transaction peut l'être, et sa hauteur de verrouillage doit être
+// celle du bloc (deux récompenses identiques n'ont donc jamais le même txid).
+// Toutes les entrées appartiennent au même compte, qui signe le txid.
+//
+// Encodage canonique (version 1) :
+//   version(1) | hauteur de verrouillage(4) | n entrées(4) | (txid, index(4))*
+//   | n sorties(4) | (len(1) propriétaire, montant(8))*
+// txid = SHA-256d de ces octets ; la signature reste hors encodage, comme pour Transaction.
+struct UtxoTransaction {
+    static constexpr uint8_t ENCODING_VERSION = 1;
+
+    uint32_t lockHeight;
+    std::vector<OutPoint> inputs;
+    std::vector<TxOutput> outputs;
+    Signature signature;
+
+    UtxoTransaction() : lockHeight(0), signature() {}
+
+    bool isCoinbase() const { return inputs.empty(); }
+
+    void encode(ByteWriter& out) const {
+        out.u8(ENCODING_VERSION);
+        out.u32(lockHeight);
+        out.u32(static_cast<uint32_t>(inputs.size()));
+        for (const auto& in : inputs) {
+            out.hash(in.txid);
+            out.u32(in.index);
+        }
+        out.u32(static_cast<uint32_t>(outputs.size()));
+        for (const auto& o : outputs) {
+            out.str8(AccountNames::instance().name(o.owner));
+            out.i64(o.value);
+        }
+    }
+
+    Hash256 txid() const {
+        std::vector<uint8_t> buffer;
+        buffer.reserve(9 + 36 * inputs.size() + 4 + 24 * outputs.size());
+        ByteWriter w(buffer);
+        encode(w);
+        Hash256 h;
+        sha256d(buffer.data(), buffer.size(), h.data());
+        return h;
+    }
+
+    void sign(const KeyPair& key) {
+        Hash256 h = txid();
+        signature = key.sign(h.data(), 32);
+    }
+};
+
+// Annulation d'un bloc : sorties dépensées, dans l'ordre de dépense
+struct UtxoUndo {
+    std::vector<std::pair<OutPoint, Coin> > spent;
+};
+
+enum class UtxoError { None, MissingInput, WrongOwner, BadOutput, Overspend, BadCoinbase, DuplicateOutput, Signature };
+
+inline const char* utxoErrorName(UtxoError e) {
+    switch (e) {
+    case UtxoError::MissingInput: return "entrée inconnue ou déjà dépensée";
+    case UtxoError::WrongOwner: return "entrées de propriétaires différents";
+    case UtxoError::BadOutput: return "sortie sans montant positif";
+    case UtxoError::Overspend: return "sorties supérieures aux entrées";
+    case UtxoError::BadCoinbase: return "création monétaire invalide";
+    case UtxoError::DuplicateOutput: return "sortie déjà existante";
+    case UtxoError::Signature: return "signature de transaction invalide";
+    default: return "aucune";
+    }
+}
+
+// Magasin UTXO sur disque : table à adressage ouvert projetée en mémoire
+// ("utxo.dat"), sondage linéaire, facteur de charge <= 1/2 (doublée au-delà).
+//   en-tête (64 octets) : magic | version | capacité(8) | nombre(8) | blocs appliqués(8) | hash du sommet
+//   case (56 octets)    : occupée(1) | réservé(3) | index(4) | txid | propriétaire(4) | hauteur(4) | montant(8)
+// Les propriétaires sont des ids propres au disque : "accounts.dat" liste les
+// noms dans l'ordre d'attribution (AccountId n'est valable que dans le processus).
+// Un lot est d'abord écrit en entier dans "utxo.log", puis appliqué à la table,
+// puis le journal est supprimé : un lot interrompu est rejoué à l'ouverture
+// (insertions et suppressions sont idempotentes), un journal incomplet est ignoré.
+class UtxoStore {
+public:
+    static constexpr uint32_t MAGIC = 0x31585455;     // "UTX1"
+    static constexpr uint32_t LOG_MAGIC = 0x474F4C55; // "ULOG"
+    static constexpr size_t HEADER_SIZE = 64;
+    static constexpr size_t SLOT_SIZE = 56;
+    static constexpr size_t RECORD_SIZE = 53;
+    static constexpr uint64_t INITIAL_CAPACITY = 1024;
+
+    // Écriture d'un lot : insertion ou remplacement, ou suppression si 'spent'
+    struct Record {
+        OutPoint key;
+        Coin coin;
+        bool spent;
+    };
+
+private:
+    std::string directory;
+    MappedFile table;
+    uint8_t* base;
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t appliedBlocks;
+    Hash256 best;
+    std::vector<AccountId> owners;                 // id disque -> AccountId
+    std::unordered_map<AccountId, uint32_t> diskIds;
+    std::ofstream namesOut;
+    mutable std::mutex mutex;
+
+    std::string tablePath() const { return directory + "/utxo.dat"; }
+    std::string logPath() const { return directory + "/utxo.log"; }
+    std::string namesPath() const { return directory + "/accounts.dat"; }
+
+    uint8_t* slot(uint64_t i) const { return base + HEADER_SIZE + i * SLOT_SIZE; }
+
+    static uint32_t indexAt(const uint8_t* s) {
+        return uint32_t(s[4]) | uint32_t(s[5]) << 8 | uint32_t(s[6]) << 16 | uint32_t(s[7]) << 24;
+    }
+
+    static uint64_t slotHashAt(const uint8_t* s) { return OutPoint::mix(loadBE64(s + 8 + 24), indexAt(s)); }
+
+    static bool matches(const uint8_t* s, const OutPoint& key) {
+        return indexAt(s) == key.index && std::memcmp(s + 8, key.txid.data(), 32) == 0;
+    }
+
+    // Case de la clé, ou première case libre de son groupe
+    uint64_t probe(const OutPoint& key, bool& found) const {
+        uint64_t mask = capacity - 1;
+        uint64_t i = key.slotHash() & mask;
+        while (slot(i)[0] != 0) {
+            if (matches(slot(i), key)) {
+                found = true;
+                return i;
+            }
+            i = (i + 1) & mask;
+        }
+        found = false;
+        return i;
+    }
+
+    static void writeSlot(uint8_t* s, const OutPoint& key, uint32_t owner, const Coin& coin) {
+        ByteWriter w(s, SLOT_SIZE);
+        w.u8(1);
+        w.u8(0);
+        w.u16(0);
+        w.u32(key.index);
+        w.hash(key.txid);
+        w.u32(owner);
+        w.u32(coin.height);
+        w.i64(coin.value);
+    }
+
+    static void writeHeader(uint8_t* h, uint64_t slots, uint64_t entries, uint64_t blocks, const Hash256& tip) {
+        ByteWriter w(h, HEADER_SIZE);
+        w.u32(MAGIC);
+        w.u32(1);
+        w.u64(slots);
+        w.u64(entries);
+        w.u64(blocks);
+        w.hash(tip);
+    }
+
+    void mapTable(uint64_t slots) {
+        if (!table.openWritable(tablePath(), HEADER_SIZE + slots * SLOT_SIZE)) {
+            throw std::runtime_error("UtxoStore : projection impossible de " + tablePath());
+        }
+        base = table.mutableData();
+    }
+
+    // Copie dans une table deux fois plus grande, écrite à côté puis renommée :
+    // un arrêt en cours de route laisse l'ancienne table intacte
+    void grow() {
+        std::string next = tablePath() + ".new";
+        std::filesystem::remove(next);
+        uint64_t slots = capacity * 2;
+        {
+            MappedFile bigger;
+            if (!bigger.openWritable(next, HEADER_SIZE + slots * SLOT_SIZE)) {
+                throw std::runtime_error("UtxoStore : impossible de créer " + next);
+            }
+            uint8_t* target = bigger.mutableData();
+            for (uint64_t i = 0; i < capacity; ++i) {
+                const uint8_t* s = slot(i);
+                if (s[0] == 0) continue;
+                uint64_t j = slotHashAt(s) & (slots - 1);
+                while (target[HEADER_SIZE + j * SLOT_SIZE] != 0) j = (j + 1) & (slots - 1);
+                std::memcpy(target + HEADER_SIZE + j * SLOT_SIZE, s, SLOT_SIZE);
+            }
+            writeHeader(target, slots, count, appliedBlocks, best);
+        }
+        table.close();
+        std::filesystem::rename(next, tablePath());
+        capacity = slots;
+        mapTable(capacity);
+    }
+
+    // Suppression par décalage arrière (voir ChainIndex::erase)
+    void eraseAt(uint64_t hole) {
+        uint64_t mask = capacity - 1;
+        for (uint64_t next = (hole + 1) & mask; slot(next)[0] != 0; next = (next + 1) & mask) {
+            uint64_t home = slotHashAt(slot(next)) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                std::memcpy(slot(hole), slot(next), SLOT_SIZE);
+                hole = next;
+            }
+        }
+        std::memset(slot(hole), 0, SLOT_SIZE);
+    }
+
+    void put(const OutPoint& key, uint32_t owner, const Coin& coin) {
+        bool found;
+        uint64_t i = probe(key, found);
+        if (!found && (count + 1) * 2 > capacity) {
+            grow();
+            i = probe(key, found);
+        }
+        writeSlot(slot(i), key, owner, coin);
+        if (!found) ++count;
+    }
+
+    void erase(const OutPoint& key) {
+        bool found;
+        uint64_t i = probe(key, found);
+        if (!found) return;
+        eraseAt(i);
+        --count;
+    }
+
+    uint32_t diskIdOf(AccountId owner) {
+        auto it = diskIds.find(owner);
+        if (it != diskIds.end()) return it->second;
+        std::vector<uint8_t> buf;
+        ByteWriter w(buf);
+        w.str8(AccountNames::instance().name(owner));
+        namesOut.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+        uint32_t id = static_cast<uint32_t>(owners.size());
+        owners.push_back(owner);
+        diskIds.emplace(owner, id);
+        return id;
+    }
+
+    // Journal : magic | blocs appliqués(8) | hash du sommet | nombre(8) | enregistrements | magic
+    //   enregistrement : supprimé(1) | txid | index(4) | propriétaire(4) | hauteur(4) | montant(8)
+    bool replayLog() {
+        MappedFile log;
+        if (!log.open(logPath())) return false;
+        const size_t fixed = 4 + 8 + 32 + 8 + 4;
+        if (log.size() < fixed) return false;
+        ByteReader r(log.data(), log.size());
+        if (r.u32() != LOG_MAGIC) return false;
+        uint64_t blocks = r.u64();
+        Hash256 tip = r.hash();
+        uint64_t n = r.u64();
+        if (n > (log.size() - fixed) / RECORD_SIZE || log.size() != fixed + n * RECORD_SIZE) return false;
+        ByteReader end(log.data() + log.size() - 4, 4);
+        if (end.u32() != LOG_MAGIC) return false;
+        for (uint64_t k = 0; k < n; ++k) {
+            bool spent = r.u8() != 0;
+            OutPoint key;
+            key.txid = r.hash();
+            key.index = r.u32();
+            uint32_t owner = r.u32();
+            Coin coin;
+            coin.height = r.u32();
+            coin.value = r.i64();
+            if (owner >= owners.size()) throw std::runtime_error("UtxoStore : propriétaire inconnu dans " + logPath());
+            if (spent) erase(key);
+            else put(key, owner, coin);
+        }
+        appliedBlocks = blocks;
+        best = tip;
+        writeHeader(base, capacity, count, appliedBlocks, best);
+        return true;
+    }
+
+    void open() {
+        std::filesystem::create_directories(directory);
+        std::filesystem::remove(tablePath() + ".new");
+
+        // Noms des propriétaires ; un nom final incomplet est coupé
+        {
+            MappedFile names;
+            size_t valid = 0;
+            if (names.open(namesPath()) && names.size() > 0) {
+                ByteReader r(names.data(), names.size());
+                try {
+                    while (r.remaining() > 0) {
+                        AccountId id = AccountNames::instance().intern(r.view8());
+                        diskIds.emplace(id, static_cast<uint32_t>(owners.size()));
+                        owners.push_back(id);
+                        valid = static_cast<size_t>(r.position() - names.data());
+                    }
+                }
+                catch (const std::runtime_error&) {
+                }
+            }
+            size_t size = names.size();
+            names.close();
+            if (valid < size) std::filesystem::resize_file(namesPath(), valid);
+        }
+
+        std::error_code ec;
+        uint64_t existing = std::filesystem::file_size(tablePath(), ec);
+        if (ec || existing < HEADER_SIZE) {
+            capacity = INITIAL_CAPACITY;
+            count = 0;
+            appliedBlocks = 0;
+            best = Hash256();
+            std::filesystem::remove(tablePath());
+            mapTable(capacity);
+            writeHeader(base, capacity, count, appliedBlocks, best);
+        }
+        else {
+            mapTable(0);
+            ByteReader r(base, HEADER_SIZE);
+            if (r.u32() != MAGIC || r.u32() != 1) throw std::runtime_error("UtxoStore : table inconnue " + tablePath());
+            capacity = r.u64();
+            count = r.u64();
+            appliedBlocks = r.u64();
+            best = r.hash();
+            if (capacity == 0 || (capacity & (capacity - 1)) != 0 || table.size() < HEADER_SIZE + capacity * SLOT_SIZE) {
+                throw std::runtime_error("UtxoStore : table tronquée " + tablePath());
+            }
+        }
+
+        replayLog();
+        std::filesystem::remove(logPath());
+        namesOut.open(namesPath(), std::ios::binary | std::ios::app);
+        if (!namesOut) throw std::runtime_error("UtxoStore : impossible d'ouvrir " + namesPath());
+    }
+
+public:
+    explicit UtxoStore(const std::string& dir)
+        : directory(dir), base(nullptr), capacity(0), count(0), appliedBlocks(0) {
+        open();
+    }
+
+    UtxoStore(const UtxoStore&) = delete;
+    UtxoStore& operator=(const UtxoStore&) = delete;
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<size_t>(count);
+    }
+
+    uint64_t diskSize() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return HEADER_SIZE + capacity * SLOT_SIZE;
+    }
+
+    // Nombre de blocs appliqués et sommet correspondant au dernier lot écrit
+    uint64_t blocks() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return appliedBlocks;
+    }
+
+    Hash256 tip() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return best;
+    }
+
+    bool get(const OutPoint& key, Coin& coin) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool found;
+        uint64_t i = probe(key, found);
+        if (!found) return false;
+        ByteReader r(slot(i) + 40, SLOT_SIZE - 40);
+        coin.owner = owners.at(r.u32());
+        coin.height = r.u32();
+        coin.value = r.i64();
+        return true;
+    }
+
+    // Écrit un lot et le sommet qu'il reflète
+    void apply(const std::vector<Record>& batch, uint64_t blocks, const Hash256& tip) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<uint8_t> log;
+        log.reserve(56 + batch.size() * RECORD_SIZE);
+        ByteWriter w(log);
+        w.u32(LOG_MAGIC);
+        w.u64(blocks);
+        w.hash(tip);
+        w.u64(batch.size());
+        std::vector<uint32_t> ids(batch.size(), 0);
+        for (size_t k = 0; k < batch.size(); ++k) {
+            const Record& rec = batch[k];
+            if (!rec.spent) ids[k] = diskIdOf(rec.coin.owner);
+            w.u8(rec.spent ? 1 : 0);
+            w.hash(rec.key.txid);
+            w.u32(rec.key.index);
+            w.u32(ids[k]);
+            w.u32(rec.coin.height);
+            w.i64(rec.coin.value);
+        }
+        w.u32(LOG_MAGIC);
+        namesOut.flush();
+        {
+            std::ofstream out(logPath(), std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(log.data()), static_cast<std::streamsize>(log.size()));
+            out.flush();
+            if (!out || !namesOut) throw std::runtime_error("UtxoStore : écriture impossible dans " + directory);
+        }
+
+        for (size_t k = 0; k < batch.size(); ++k) {
+            if (batch[k].spent) erase(batch[k].key);
+            else put(batch[k].key, ids[k], batch[k].coin);
+        }
+        appliedBlocks = blocks;
+        best = tip;
+        writeHeader(base, capacity, count, appliedBlocks, best);
+        std::filesystem::remove(logPath());
+    }
+};
+
+// Ensemble UTXO : cache en mémoire devant un UtxoStore (facultatif).
+//  - table à adressage ouvert de cases de 64 octets (une ligne de cache),
+//    sondage linéaire, capacité fixée par le budget mémoire ; sans magasin,
+//    la table s'agrandit au-delà de 3/4 de remplissage
+//  - une sortie dépensée pas encore écrite reste en "tombe" (SPENT) ; une sortie
+//    créée depuis la dernière écriture (FRESH) disparaît simplement si elle est
+//    dépensée avant : elle n'atteint jamais le disque
+//  - un thread d'écriture prend un instantané des cases modifiées entre deux
+//    blocs (au-delà de capacité / 4 entrées modifiées, ou à la demande), les
+//    écrit sans bloquer l'application des blocs suivants, puis les rend
+//    évictables ; les cases en cours d'écriture sont épinglées (PINNED)
+//  - éviction des cases propres par algorithme de l'horloge (seconde chance via
+//    REFERENCED) : les sorties consultées récemment restent en mémoire
+// Avant chaque bloc, assez de cases sont libérées pour toutes ses entrées et
+// sorties ; au pire on attend une écriture. Au-delà du budget (bloc énorme),
+// la table grandit plutôt que d'échouer.
+class UtxoSet {
+public:
+    static constexpr Amount BLOCK_REWARD = 50 * AMOUNT_SCALE;
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t flushes;
+        uint64_t flushedEntries;
+
+        Stats() : hits(0), misses(0), evictions(0), flushes(0), flushedEntries(0) {}
+    };
+
+private:
+    enum SlotFlag : uint8_t { PRESENT = 1, DIRTY = 2, FRESH = 4, SPENT = 8, PINNED = 16, REFERENCED = 32 };
+
+    struct alignas(64) Slot {
+        OutPoint key;
+        Coin coin;
+        uint8_t flags; // 0 = case vide
+    };
+
+    static constexpr size_t npos = SIZE_MAX;
+
+    UtxoStore* store;
+    std::vector<Slot> table;
+    size_t used;      // cases occupées, tombes comprises
+    size_t dirty;     // cases à écrire
+    size_t coins;     // sorties non dépensées (cache et disque)
+    size_t clockHand;
+    uint64_t appliedBlocks;
+    Hash256 best;
+    Stats counters;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    bool stopping;
+    bool flushRequested;
+    uint64_t snapshots;
+    uint64_t flushesDone;
+    std::exception_ptr failure;
+    std::thread flusher;
+
+    size_t highWater() const { return table.size() / 4 * 3; }
+    size_t dirtyLimit() const { return table.size() / 4; }
+
+    size_t find(const OutPoint& key) const {
+        size_t mask = table.size() - 1;
+        for (size_t i = key.slotHash() & mask; table[i].flags != 0; i = (i + 1) & mask) {
+            if (table[i].key == key) return i;
+        }
+        return npos;
+    }
+
+    size_t insert(const OutPoint& key, const Coin& coin, uint8_t flags) {
+        // Garde-fou : makeRoom réserve normalement la place du bloc entier
+        if ((used + 1) * 16 > table.size() * 15) rehash(table.size() * 2);
+        size_t mask = table.size() - 1;
+        size_t i = key.slotHash() & mask;
+        while (table[i].flags != 0) i = (i + 1) & mask;
+        table[i].key = key;
+        table[i].coin = coin;
+        table[i].flags = flags;
+        ++used;
+        return i;
+    }
+
+    // Suppression par décalage arrière (voir ChainIndex::erase)
+    void eraseAt(size_t hole) {
+        size_t mask = table.size() - 1;
+        for (size_t next = (hole + 1) & mask; table[next].flags != 0; next = (next + 1) & mask) {
+            size_t home = table[next].key.slotHash() & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                table[hole] = table[next];
+                hole = next;
+            }
+        }
+        table[hole].flags = 0;
+        --used;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        old.swap(table);
+        for (auto& s : table) s.flags = 0;
+        used = 0;
+        for (const auto& s : old) {
+            if (s.flags != 0) insert(s.key, s.coin, s.flags);
+        }
+        clockHand = 0;
+    }
+
+    // Case de la sortie, relue du disque si elle n'est pas en cache
+    size_t fetch(const OutPoint& key) {
+        size_t i = find(key);
+        if (i != npos) {
+            ++counters.hits;
+            METRIC_ADD(UtxoCacheHits, 1);
+            table[i].flags |= REFERENCED;
+            return i;
+        }
+        Coin coin;
+        if (!store || !store->get(key, coin)) return npos;
+        ++counters.misses;
+        METRIC_ADD(UtxoCacheMisses, 1);
+        return insert(key, coin, PRESENT);
+    }
+
+    bool spend(const OutPoint& key, Coin& coin) {
+        size_t i = fetch(key);
+        if (i == npos || (table[i].flags & SPENT)) return false;
+        coin = table[i].coin;
+        if (table[i].flags & FRESH) {
+            eraseAt(i);
+            --dirty;
+        }
+        else {
+            if (!(table[i].flags & DIRTY)) ++dirty;
+            table[i].flags = uint8_t((table[i].flags | SPENT | DIRTY) & ~REFERENCED);
+        }
+        --coins;
+        return true;
+    }
+
+    // false si la sortie existe déjà (non dépensée) en cache ; les txid uniques
+    // rendent inutile la consultation du disque
+    bool add(const OutPoint& key, const Coin& coin) {
+        size_t i = find(key);
+        if (i != npos) {
+            if (!(table[i].flags & SPENT)) return false;
+            if (!(table[i].flags & DIRTY)) ++dirty;
+            table[i].coin = coin;
+            table[i].flags = uint8_t((table[i].flags & ~SPENT) | DIRTY);
+        }
+        else {
+            insert(key, coin, PRESENT | DIRTY | FRESH);
+            ++dirty;
+        }
+        ++coins;
+        return true;
+    }
+
+    // Horloge : une case référencée perd son bit, une case propre non référencée part.
+    // L'aiguille avance d'un pas impair proche de size / nombre d'or (toutes les
+    // cases sont visitées une fois par tour) : vider une zone contiguë laisserait
+    // le reste de la table presque plein, avec des groupes de sondage démesurés.
+    void evict(size_t target) {
+        const size_t mask = table.size() - 1;
+        const size_t stride = static_cast<size_t>(static_cast<double>(table.size()) * 0.6180339887) | 1;
+        for (size_t budget = 2 * table.size(); used > target && budget > 0; --budget) {
+            Slot& s = table[clockHand];
+            if (s.flags == PRESENT) {
+                eraseAt(clockHand);
+                ++counters.evictions;
+            }
+            else if (s.flags & REFERENCED) {
+                s.flags = uint8_t(s.flags & ~REFERENCED);
+            }
+            clockHand = (clockHand + stride) & mask;
+        }
+    }
+
+    void makeRoom(std::unique_lock<std::mutex>& lock, size_t needed) {
+        if (used + needed <= highWater()) return;
+        if (store) {
+            size_t low = table.size() / 2;
+            size_t target = low > needed ? low - needed : 0;
+            evict(target);
+            if (used + needed > highWater()) {
+                waitForFlush(lock);
+                evict(target);
+            }
+        }
+        while (used + needed > highWater()) rehash(table.size() * 2);
+    }
+
+    void waitForFlush(std::unique_lock<std::mutex>& lock) {
+        uint64_t ticket = snapshots + 1;
+        flushRequested = true;
+        wake.notify_one();
+        flushed.wait(lock, [&] { return flushesDone >= ticket || failure; });
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    // Cases modifiées à écrire ; elles restent épinglées jusqu'à release()
+    std::vector<UtxoStore::Record> snapshot() {
+        std::vector<UtxoStore::Record> batch;
+        batch.reserve(dirty);
+        for (auto& s : table) {
+            if (!(s.flags & DIRTY)) continue;
+            batch.push_back(UtxoStore::Record{ s.key, s.coin, (s.flags & SPENT) != 0 });
+            s.flags = uint8_t((s.flags & ~(DIRTY | FRESH)) | PINNED);
+        }
+        dirty = 0;
+        ++snapshots;
+        return batch;
+    }
+
+    // Lot écrit : les cases redeviennent évictables, les tombes écrites disparaissent
+    void release() {
+        for (size_t i = 0; i < table.size();) {
+            Slot& s = table[i];
+            if (s.flags & PINNED) {
+                s.flags = uint8_t(s.flags & ~PINNED);
+                if ((s.flags & SPENT) && !(s.flags & DIRTY)) {
+                    eraseAt(i);
+                    continue;
+                }
+            }
+            ++i;
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || flushRequested || dirty >= dirtyLimit(); });
+            flushRequested = false;
+            bool last = stopping;
+            std::vector<UtxoStore::Record> batch = snapshot();
+            uint64_t blocks = appliedBlocks;
+            Hash256 tip = best;
+            lock.unlock();
+            try {
+                METRIC_TIME(UtxoFlush);
+                store->apply(batch, blocks, tip);
+            }
+            catch (...) {
+                lock.lock();
+                failure = std::current_exception();
+                flushed.notify_all();
+                return;
+            }
+            lock.lock();
+            release();
+            ++counters.flushes;
+            counters.flushedEntries += batch.size();
+            METRIC_ADD(UtxoEntriesFlushed, batch.size());
+            flushesDone = snapshots;
+            flushed.notify_all();
+            if (last) return;
+        }
+    }
+
+    // Retire les sorties des transactions [0, count) (dernière d'abord) et remet
+    // leurs entrées, lues à rebours dans 'spent' à partir de 'spentEnd'
+    bool undoTransactions(const std::vector<UtxoTransaction>& txs, const std::vector<Hash256>& txids, size_t count,
+        const std::vector<std::pair<OutPoint, Coin> >& spent, size_t spentEnd) {
+        bool consistent = true;
+        size_t k = spentEnd;
+        for (size_t i = count; i-- > 0;) {
+            Coin removed;
+            for (size_t j = txs[i].outputs.size(); j-- > 0;) {
+                if (!spend(OutPoint(txids[i], static_cast<uint32_t>(j)), removed)) consistent = false;
+            }
+            for (size_t j = txs[i].inputs.size(); j-- > 0;) {
+                --k;
+                if (!add(spent[k].first, spent[k].second)) consistent = false;
+            }
+        }
+        return consistent;
+    }
+
+    void checkFailure() const {
+        if (failure) std::rethrow_exception(failure);
+    }
+
+public:
+    // 'memoryBudget' : octets alloués à la table (arrondis à une puissance de
+    // deux de cases) ; sans magasin, la table démarre à cette taille puis grandit
+    explicit UtxoSet(UtxoStore* backing = nullptr, size_t memoryBudget = 64u << 20)
+        : store(backing), used(0), dirty(0), coins(0), clockHand(0), appliedBlocks(0),
+          stopping(false), flushRequested(false), snapshots(0), flushesDone(0) {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity * 2 * sizeof(Slot) <= memoryBudget) capacity *= 2;
+        table.resize(capacity);
+        for (auto& s : table) s.flags = 0;
+        if (store) {
+            coins = store->size();
+            appliedBlocks = store->blocks();
+            best = store->tip();
+            flusher = std::thread(&UtxoSet::run, this);
+        }
+    }
+
+    // Dernière écriture de toutes les cases modifiées
+    ~UtxoSet() {
+        if (!flusher.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        flusher.join();
+    }
+
+    UtxoSet(const UtxoSet&) = delete;
+    UtxoSet& operator=(const UtxoSet&) = delete;
+
+    // Applique un bloc dont la hauteur est blocks() ; en cas de refus l'ensemble
+    // reste inchangé. 'undo' reçoit les sorties dépensées (disconnectBlock).
+    UtxoError connectBlock(const std::vector<UtxoTransaction>& txs, const Hash256& blockHash, UtxoUndo& undo,
+        bool checkSignatures = true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        checkFailure();
+        size_t needed = 0;
+        for (const auto& tx : txs) needed += tx.inputs.size() + tx.outputs.size();
+        makeRoom(lock, needed);
+
+        const uint32_t height = static_cast<uint32_t>(appliedBlocks);
+        const size_t n = txs.size();
+        std::vector<Hash256> txids(n);
+        SignatureBatch batch;
+        if (checkSignatures) batch.reserve(n);
+        undo.spent.clear();
+
+        UtxoError error = UtxoError::None;
+        Amount fees = 0, minted = 0;
+        size_t applied = 0; // transactions entièrement appliquées
+        for (; applied < n; ++applied) {
+            const UtxoTransaction& tx = txs[applied];
+            txids[applied] = tx.txid();
+            const size_t spentBefore = undo.spent.size();
+
+            Amount in = 0;
+            AccountId owner = 0;
+            if (tx.isCoinbase()) {
+                if (applied != 0 || tx.lockHeight != height) error = UtxoError::BadCoinbase;
+            }
+            for (size_t k = 0; k < tx.inputs.size() && error == UtxoError::None; ++k) {
+                Coin coin;
+                if (!spend(tx.inputs[k], coin)) {
+                    error = UtxoError::MissingInput;
+                    break;
+                }
+                undo.spent.emplace_back(tx.inputs[k], coin);
+                if (k == 0) owner = coin.owner;
+                else if (coin.owner != owner) error = UtxoError::WrongOwner;
+                in += coin.value;
+            }
+
+            Amount out = 0;
+            for (size_t j = 0; j < tx.outputs.size() && error == UtxoError::None; ++j) {
+                Amount value = tx.outputs[j].value;
+                if (value <= 0 || (tx.isCoinbase() && value > BLOCK_REWARD)) error = UtxoError::BadOutput;
+                else if (!tx.isCoinbase() && value > in - out) error = UtxoError::Overspend;
+                else out += value;
+            }
+            if (error == UtxoError::None && tx.outputs.empty()) error = UtxoError::BadOutput;
+
+            if (error == UtxoError::None && checkSignatures && !tx.isCoinbase()) {
+                const VerifyingKey* key = AccountKeys::instance().find(owner);
+                if (key) batch.add(*key, txids[applied].data(), 32, tx.signature);
+                else error = UtxoError::Signature;
+            }
+
+            size_t created = 0;
+            for (; created < tx.outputs.size() && error == UtxoError::None; ++created) {
+                const TxOutput& o = tx.outputs[created];
+                if (!add(OutPoint(txids[applied], static_cast<uint32_t>(created)), Coin(o.owner, o.value, height))) {
+                    error = UtxoError::DuplicateOutput;
+                }
+            }
+
+            if (error != UtxoError::None) {
+                // Transaction fautive à moitié appliquée : sorties créées puis entrées dépensées
+                Coin removed;
+                size_t keep = error == UtxoError::DuplicateOutput ? created - 1 : created;
+                for (size_t j = keep; j-- > 0;) spend(OutPoint(txids[applied], static_cast<uint32_t>(j)), removed);
+                for (size_t k = undo.spent.size(); k-- > spentBefore;) add(undo.spent[k].first, undo.spent[k].second);
+                undo.spent.resize(spentBefore);
+                break;
+            }
+            if (tx.isCoinbase()) minted = out;
+            else fees += in - out;
+        }
+
+        if (error == UtxoError::None && minted > BLOCK_REWARD + fees) error = UtxoError::BadCoinbase;
+        if (error == UtxoError::None && checkSignatures && !batch.verify()) error = UtxoError::Signature;
+        if (error != UtxoError::None) {
+            undoTransactions(txs, txids, applied, undo.spent, undo.spent.size());
+            undo.spent.clear();
+            return error;
+        }
+
+        ++appliedBlocks;
+        best = blockHash;
+        if (store && dirty >= dirtyLimit()) wake.notify_one();
+        return UtxoError::None;
+    }
+
+    // Annule le dernier bloc appliqué ; false si l'annulation ne correspond pas à l'état
+    bool disconnectBlock(const std::vector<UtxoTransaction>& txs, const UtxoUndo& undo, const Hash256& previousHash) {
+        std::unique_lock<std::mutex> lock(mutex);
+        checkFailure();
+        if (appliedBlocks == 0) return false;
+        size_t needed = undo.spent.size(), inputs = 0;
+        for (const auto& tx : txs) {
+            needed += tx.outputs.size();
+            inputs += tx.inputs.size();
+        }
+        if (inputs != undo.spent.size()) return false;
+        makeRoom(lock, needed);
+
+        std::vector<Hash256> txids(txs.size());
+        for (size_t i = 0; i < txs.size(); ++i) txids[i] = txs[i].txid();
+        bool consistent = undoTransactions(txs, txids, txs.size(), undo.spent, undo.spent.size());
+        --appliedBlocks;
+        best = previousHash;
+        if (store && dirty >= dirtyLimit()) wake.notify_one();
+        return consistent;
+    }
+
+    bool getCoin(const OutPoint& key, Coin& coin) {
+        std::unique_lock<std::mutex> lock(mutex);
+        checkFailure();
+        makeRoom(lock, 1);
+        size_t i = fetch(key);
+        if (i == npos || (table[i].flags & SPENT)) return false;
+        coin = table[i].coin;
+        return true;
+    }
+
+    // Écrit toutes les cases modifiées et attend la fin de l'écriture
+    void flush() {
+        if (!store) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        waitForFlush(lock);
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return coins;
+    }
+
+    // Blocs appliqués, c'est-à-dire hauteur du prochain bloc
+    uint64_t blocks() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return appliedBlocks;
+    }
+
+    Hash256 tip() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return best;
+    }
+
+    size_t cachedEntries() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used;
+    }
+
+    size_t memoryBytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return table.size() * sizeof(Slot);
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return counters;
+    }
+};
+
+// ==================================================
+// MEMPOOL
+// ==================================================
+// Ensemble concurrent d'identifiants (64 bits) réparti en segments verrouillés
+// séparément : deux producteurs ne se bloquent que s'ils tombent sur le même segment.
+class ConcurrentIdSet {
+private:
+    static constexpr size_t SHARDS = 64;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> ids;
+    };
+
+    std::array<Shard, SHARDS> shards;
+
+    Shard& shardFor(uint64_t id) {
+        return shards[(id ^ (id >> 29)) % SHARDS];
+    }
+
+public:
+    // false si l'identifiant était déjà présent
+    bool insert(uint64_t id) {
+        Shard& s = shardFor(id);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.ids.insert(id).second;
+    }
+
+    void erase(uint64_t id) {
+        Shard& s = shardFor(id);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.ids.erase(id);
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (auto& s : shards) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            total += s.ids.size();
+        }
+        return total;
+    }
+};
+
+// File MPSC sans verrou (liste chaînée intrusive de Vyukov) : un push est un
+// seul échange atomique, un seul consommateur dépile.
+class MpscTransactionQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        Transaction tx;
+        explicit Node(const Transaction& t) : next(nullptr), tx(t) {}
+    };
+
+    alignas(64) std::atomic<Node*> head; // côté producteurs
+    alignas(64) Node* tail;              // côté consommateur (nœud sentinelle)
+
+public:
+    MpscTransactionQueue() {
+        Node* stub = new Node(Transaction());
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    ~MpscTransactionQueue() {
+        Transaction ignored;
+        while (pop(ignored)) {}
+        delete tail;
+    }
+
+    MpscTransactionQueue(const MpscTransactionQueue&) = delete;
+    MpscTransactionQueue& operator=(const MpscTransactionQueue&) = delete;
+
+    // Appelable depuis n'importe quel thread
+    void push(const Transaction& tx) {
+        Node* node = new Node(tx);
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consommateur unique ; false si la file est vide (ou un push est en cours)
+    bool pop(Transaction& out) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->tx);
+        delete tail;
+        tail = next;
+        return true;
+    }
+};
+
+// Transactions en attente d'inclusion.
+//  - submit() : thread-safe et sans verrou global (dédoublonnage par id dans
+//    ConcurrentIdSet, puis file MPSC) tant que l'index et la file tiennent
+//    sous le plafond mémoire ; au-delà, la file est vidée sur place
+//  - drain() / takeBest() : côté constructeur de blocs ; les transactions de la
+//    file sont classées par frais décroissants (puis ordre d'arrivée) dans un
+//    index trié, les moins bien payées étant évincées au-delà du plafond mémoire.
+//    Un second index range celles de chaque émetteur par nonce : seule la
+//    première de chaque émetteur (sa « tête ») est candidate à un bloc.
+class Mempool {
+private:
+    struct Priority {
+        Amount fee;
+        uint64_t sequence;
+        uint64_t id;
+
+        bool operator<(const Priority& other) const {
+            if (fee != other.fee) return fee > other.fee;
+            return sequence < other.sequence;
+        }
+    };
+
+    ConcurrentIdSet ids;
+    MpscTransactionQueue queue;
+    std::atomic<size_t> queued;
+
+    std::mutex consumerMutex;
+    std::map<Priority, Transaction> pending;
+    std::unordered_map<AccountId, std::set<std::pair<uint64_t, Priority> > > bySender; // par nonce
+    std::set<Priority> heads; // plus petit nonce en attente de chaque émetteur
+    std::unordered_map<uint64_t, Priority> byId; // retrait des transactions confirmées ailleurs
+    uint64_t nextSequence;
+    // Modifiés sous consumerMutex, lus sans verrou par submit()
+    std::atomic<size_t> memoryCap;
+    std::atomic<size_t> memoryUsed;
+    size_t evicted;
+
+    // Estimation de l'empreinte d'une entrée : nœuds des trois index et entrée de
+    // l'ensemble d'identifiants (Transaction n'alloue rien sur le tas)
+    static size_t entryFootprint(const Transaction&) {
+        const size_t nodeOverhead = 4 * sizeof(void*);
+        const size_t idSetEntry = 4 * sizeof(void*);
+        return 3 * nodeOverhead + sizeof(Priority) + sizeof(Transaction) + sizeof(uint64_t) + sizeof(Priority) +
+            sizeof(uint64_t) + sizeof(Priority) + idSetEntry;
+    }
+
+    void link(const Transaction& tx, const Priority& key) {
+        auto& queue = bySender[tx.sender];
+        if (!queue.empty()) heads.erase(queue.begin()->second);
+        queue.emplace(tx.nonce, key);
+        heads.insert(queue.begin()->second);
+    }
+
+    void unlink(const Transaction& tx, const Priority& key) {
+        auto queue = bySender.find(tx.sender);
+        bool head = queue->second.begin()->second.sequence == key.sequence;
+        if (head) heads.erase(key);
+        queue->second.erase(std::make_pair(tx.nonce, key));
+        if (queue->second.empty()) bySender.erase(queue);
+        else if (head) heads.insert(queue->second.begin()->second);
+    }
+
+    // Retire une entrée de tous les index
+    std::map<Priority, Transaction>::iterator erase(std::map<Priority, Transaction>::iterator entry) {
+        memoryUsed -= entryFootprint(entry->second);
+        ids.erase(entry->first.id);
+        byId.erase(entry->first.id);
+        unlink(entry->second, entry->first);
+        return pending.erase(entry);
+    }
+
+    void evictLowest() {
+        erase(std::prev(pending.end()));
+        ++evicted;
+    }
+
+    void drainLocked() {
+        Transaction tx;
+        while (queue.pop(tx)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            Priority key{ tx.fee, nextSequence++, tx.id };
+            memoryUsed += entryFootprint(tx);
+            link(tx, key);
+            byId.emplace(key.id, key);
+            pending.emplace(key, std::move(tx));
+            while (memoryUsed > memoryCap && !pending.empty()) evictLowest();
+        }
+    }
+
+public:
+    explicit Mempool(size_t memoryCapBytes = 512u << 20)
+        : queued(0), nextSequence(0), memoryCap(memoryCapBytes), memoryUsed(0), evicted(0) {}
+
+    // false si une transaction de même id est déjà en attente. Les entrées
+    // encore dans la file comptent dans le plafond : s'il est dépassé, la file
+    // est vidée ici (éviction des moins bien payées) sans attendre le prochain bloc.
+    bool submit(const Transaction& tx) {
+        if (!ids.insert(tx.id)) return false;
+        queue.push(tx);
+        size_t waiting = queued.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (memoryUsed.load(std::memory_order_relaxed) + waiting * entryFootprint(tx) >
+            memoryCap.load(std::memory_order_relaxed)) {
+            drain();
+        }
+        return true;
+    }
+
+    // Déplace les transactions soumises vers l'index de priorité
+    void drain() {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        drainLocked();
+    }
+
+    // Retire jusqu'à 'count' transactions, la tête la mieux payée d'abord :
+    // O(count log M). Chaque émetteur y voit les siennes par nonce croissant,
+    // l'ordre attendu par l'état des comptes.
+    std::vector<Transaction> takeBest(size_t count) {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        drainLocked();
+        std::vector<Transaction> best;
+        best.reserve(std::min(count, pending.size()));
+        while (best.size() < count && !heads.empty()) {
+            auto entry = pending.find(*heads.begin());
+            best.push_back(entry->second);
+            erase(entry);
+        }
+        return best;
+    }
+
+    // Retire les transactions confirmées par un bloc produit ailleurs, par
+    // recherche de leur id : O(bloc), indépendant de la taille de la mempool ;
+    // renvoie le nombre retiré
+    size_t removeConfirmed(const std::vector<Transaction>& confirmed) {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        drainLocked();
+        size_t removed = 0;
+        for (const auto& tx : confirmed) {
+            auto key = byId.find(tx.id);
+            if (key == byId.end()) continue;
+            erase(pending.find(key->second));
+            ++removed;
+        }
+        return removed;
+    }
+
+    // Copie des transactions en attente, par priorité décroissante
+    std::vector<Transaction> pendingTransactions() {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        drainLocked();
+        std::vector<Transaction> txs;
+        txs.reserve(pending.size());
+        for (const auto& entry : pending) txs.push_back(entry.second);
+        return txs;
+    }
+
+    void setMemoryCap(size_t bytes) {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        memoryCap = bytes;
+        while (memoryUsed > memoryCap && !pending.empty()) evictLowest();
+    }
+
+    // Transactions indexées + encore dans la file
+    size_t size() {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        return pending.size() + queued.load(std::memory_order_relaxed);
+    }
+
+    size_t memoryUsage() {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        return memoryUsed;
+    }
+
+    size_t evictedCount() {
+        std::lock_guard<std::mutex> lock(consumerMutex);
+        return evicted;
+    }
+};
+
+// ==================================================
+// PRODUCTION EN PIPELINE
+// ==================================================
+// Récépissé d'un bloc PoW produit par le pipeline : temps passé dans chaque
+// étage, et latence totale de submitBlock à l'écriture (attente dans les files comprise)
+struct BlockReceipt {
+    size_t index;
+    Hash256 hash;
+    size_t transactions;
+    double assemblySeconds; // sélection, état des comptes, racine de Merkle
+    double miningSeconds;
+    double commitSeconds;   // vérification et écriture
+    double latencySeconds;
+
+    BlockReceipt()
+        : index(0), transactions(0), assemblySeconds(0), miningSeconds(0), commitSeconds(0), latencySeconds(0) {}
+};
+
+// Étage du pipeline PoW où un auto-test peut provoquer un échec
+enum class PipelineStage { Mine, Commit };
+
+struct PipelineStats {
+    size_t blocks;
+    double assemblySeconds; // cumuls sur tous les blocs écrits
+    double miningSeconds;
+    double commitSeconds;
+    double latencySeconds;
+    double steadySeconds;   // du premier au dernier bloc écrit
+
+    PipelineStats()
+        : blocks(0), assemblySeconds(0), miningSeconds(0), commitSeconds(0), latencySeconds(0), steadySeconds(0) {}
+
+    void add(const BlockReceipt& r) {
+        ++blocks;
+        assemblySeconds += r.assemblySeconds;
+        miningSeconds += r.miningSeconds;
+        commitSeconds += r.commitSeconds;
+        latencySeconds += r.latencySeconds;
+    }
+
+    double average(double total) const { return blocks > 0 ? total / blocks : 0.0; }
+
+    // Débit en régime établi : le remplissage du pipeline (premier bloc) est exclu
+    double blocksPerSecond() const {
+        return blocks > 1 && steadySeconds > 0 ? (blocks - 1) / steadySeconds : 0.0;
+    }
+};
+
+// ==================================================
+// SYNCHRONISATION INITIALE
+// ==================================================
+// Blocs d'une chaîne distante, par hauteur : un pair local, ou un fichier qui
+// en tient lieu. body() est appelé depuis plusieurs threads à la fois.
+class BlockSource {
+public:
+    virtual ~BlockSource() {}
+    virtual size_t size() = 0;
+    virtual std::unique_ptr<Block> header(size_t height) = 0; // sans transactions
+    virtual std::vector<Transaction> body(size_t height) = 0;
+};
+
+// Chaîne écrite par un BlockStore (lectures concurrentes sur les projections)
+class StoreBlockSource : public BlockSource {
+private:
+    const BlockStore& store;
+
+public:
+    explicit StoreBlockSource(const BlockStore& blockStore) : store(blockStore) {}
+
+    size_t size() override { return store.size(); }
+    std::unique_ptr<Block> header(size_t height) override { return store.loadHeader(height); }
+    std::vector<Transaction> body(size_t height) override { return store.loadTransactions(height); }
+};
+
+struct SyncReport {
+    size_t headers;      // en-têtes reçus
+    size_t validHeaders; // préfixe dont chaînage, hash et consensus sont corrects
+    size_t blocks;       // blocs de la chaîne synchronisée, génèse comprise
+    size_t transactions;
+    size_t failedHeight; // premier bloc refusé (SIZE_MAX si aucun)
+    std::string failure;
+    double headerSeconds;
+    double bodySeconds;
+
+    SyncReport()
+        : headers(0), validHeaders(0), blocks(0), transactions(0), failedHeight(SIZE_MAX), headerSeconds(0), bodySeconds(0) {}
+};
+
+// ==================================================
+// BLOCKCHAIN
+// ==================================================
+// Issue de Blockchain::acceptBlock pour un bloc reçu d'ailleurs
+enum class AcceptResult { Connected, SideBranch, Reorganized, Duplicate, Orphan, Invalid };
+
+inline const char* acceptResultName(AcceptResult r) {
+    switch (r) {
+    case AcceptResult::Connected: return "ajouté au sommet";
+    case AcceptResult::SideBranch: return "branche concurrente";
+    case AcceptResult::Reorganized: return "réorganisation";
+    case AcceptResult::Duplicate: return "déjà connu";
+    case AcceptResult::Orphan: return "parent inconnu";
+    default: return "invalide";
+    }
+}
+
+// Sommet de la branche active, lu depuis un autre thread
+struct ChainTip {
+    size_t height;
+    Hash256 hash;
+    double work;
+    size_t mempoolSize;
+};
+
+class Blockchain {
+private:
+    std::vector<std::unique_ptr<Block> > chain;
+    ChainIndex headers; // en-têtes compacts, tenus à jour avec 'chain'
+    // Lecteurs d'autres threads (serveur RPC) : verrou partagé. Exclusif pour
+    // modifier 'chain', 'headers' ou le stockage : commit, disconnectTip,
+    // troncature et chargement des corps de blocs.
+    mutable std::shared_mutex chainMutex;
+    ValidatorRegistry validators;
+    std::vector<Validator> nextEpochValidators;
+    bool validatorsChanged;
+    size_t epochLength;
+    DifficultyRetargeter retargeter; // règle seule (cible initiale, temps visé, fenêtre), rejouée par retargeterAt
+    ParallelMiner miner;
+    ThreadPool workers;
+    BlockStore* store; // facultatif, non possédé
+    Mempool mempool;
+    size_t maxBlockTransactions;
+    AccountLedger ledger;
+    std::vector<std::pair<std::string, Amount> > allocations; // soldes de la génèse
+
+    // Pipeline PoW : assemblage du bloc N+1 pendant le minage du bloc N et
+    // l'écriture du bloc N-1. Chaque étage est seul à toucher à son état :
+    // mempool et comptes (assemblage), réajustement et mineur (minage), chaîne
+    // et stockage (écriture).
+    typedef std::function<void(const BlockReceipt&, std::exception_ptr)> BlockCallback;
+    struct PipelineJob {
+        std::vector<Transaction> transactions;
+        bool fromMempool;
+        std::unique_ptr<PoWBlock> block;
+        std::promise<BlockReceipt> done;
+        BlockCallback onCommitted;
+        std::chrono::high_resolution_clock::time_point submitted;
+        BlockReceipt receipt;
+        std::exception_ptr error;
+        uint64_t sequence; // numéro d'assemblage (entrée de pendingBlocks)
+
+        PipelineJob() : fromMempool(false), sequence(0) {}
+    };
+    std::unique_ptr<BoundedQueue<PipelineJob> > toAssemble;
+    std::unique_ptr<BoundedQueue<PipelineJob> > toMine;
+    std::unique_ptr<BoundedQueue<PipelineJob> > toCommit;
+    std::vector<std::thread> stages;
+    // Blocs assemblés (comptes déjà avancés, un journal chacun au sommet de
+    // 'ledger') mais pas encore écrits, du plus ancien au plus récent
+    struct PendingBlock {
+        uint64_t sequence;
+        size_t index;
+        std::vector<Transaction> transactions;
+        bool fromMempool;
+    };
+    std::mutex pendingMutex; // pendingBlocks, ledger et assembleIndex pendant le pipeline
+    std::deque<PendingBlock> pendingBlocks;
+    uint64_t pipelineSequence;
+    size_t assembleIndex;
+    std::mutex statsMutex;
+    PipelineStats pipelineStats;
+    std::chrono::high_resolution_clock::time_point firstCommit;
+    std::function<void(size_t, PipelineStage)> pipelineFault; // auto-tests uniquement
+
+    static double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    bool isPending(uint64_t sequence) const {
+        for (const auto& pending : pendingBlocks) {
+            if (pending.sequence == sequence) return true;
+        }
+        return false;
+    }
+
+    // Échec du bloc assemblé 'sequence' : ses comptes et ceux de tous les blocs
+    // assemblés après lui sont annulés (journaux, du plus récent au plus ancien),
+    // leurs transactions venues de la mempool y retournent et l'assemblage
+    // reprend à sa hauteur. Les blocs annulés échouent à leur tour, sans rien
+    // annuler de plus ; une recherche de nonce en cours pour l'un d'eux est
+    // interrompue.
+    void abandonFrom(uint64_t sequence) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (!isPending(sequence)) return;
+        while (!pendingBlocks.empty() && pendingBlocks.back().sequence >= sequence) {
+            PendingBlock& pending = pendingBlocks.back();
+            ledger.rollbackBlock();
+            if (pending.fromMempool) {
+                for (const auto& tx : pending.transactions) mempool.submit(tx);
+            }
+            assembleIndex = pending.index;
+            pendingBlocks.pop_back();
+        }
+        miner.cancel();
+    }
+
+    // Étage 1 : transactions, état des comptes et racine de Merkle. previousHash
+    // et cible restent à fixer : le hash du bloc précédent n'est pas encore connu.
+    void assembleStage() {
+        PipelineJob job;
+        while (toAssemble->pop(job)) {
+            auto start = std::chrono::high_resolution_clock::now();
+            try {
+                size_t index;
+                {
+                    std::lock_guard<std::mutex> lock(pendingMutex);
+                    if (job.fromMempool) job.transactions = mempool.takeBest(maxBlockTransactions);
+                    applyToLedger(job.transactions, job.fromMempool);
+                    index = assembleIndex++;
+                    job.sequence = ++pipelineSequence;
+                    pendingBlocks.push_back(PendingBlock{ job.sequence, index, job.transactions, job.fromMempool });
+                }
+                job.block.reset(new PoWBlock(index, Hash256(), std::move(job.transactions), Hash256(), &workers));
+            }
+            catch (...) {
+                job.error = std::current_exception();
+            }
+            job.receipt.assemblySeconds = secondsSince(start);
+            toMine->push(std::move(job));
+        }
+        toMine->close();
+    }
+
+    // Étage 2 : chaînage sur le dernier bloc miné, horodatage au début de la
+    // recherche, cible exigée après ce bloc et recherche du nonce. Après un
+    // échec, le bloc repris à une hauteur déjà minée se chaîne sur la chaîne écrite.
+    void mineStage(Hash256 tip, uint64_t tipMillis, DifficultyRetargeter next) {
+        size_t nextHeight = chain.size();
+        PipelineJob job;
+        while (toMine->pop(job)) {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (!job.error) {
+                try {
+                    PoWBlock& block = *job.block;
+                    {
+                        std::lock_guard<std::mutex> lock(pendingMutex);
+                        if (!isPending(job.sequence)) {
+                            throw std::runtime_error("bloc " + std::to_string(block.index) + " abandonné après un échec");
+                        }
+                    }
+                    if (pipelineFault) pipelineFault(block.index, PipelineStage::Mine);
+                    if (block.index != nextHeight) {
+                        std::shared_lock<std::shared_mutex> lock(chainMutex);
+                        tip = chain.back()->hash;
+                        tipMillis = chain.back()->timeMillis();
+                        next = retargeterAt(chain.size());
+                    }
+                    block.previousHash = tip;
+                    block.timestamp = formatBlockTime(currentTimeMillis());
+                    block.target = next.target();
+                    MiningResult result = miner.mine(block);
+                    if (!result.found) throw std::runtime_error("aucun nonce valide pour le bloc " + std::to_string(block.index));
+                    block.nonce = result.nonce;
+                    block.hash = result.hash;
+                    next.record(blockInterval(tipMillis, block.timeMillis()), block.target);
+                    tip = block.hash;
+                    tipMillis = block.timeMillis();
+                    nextHeight = block.index + 1;
+                }
+                catch (...) {
+                    job.error = std::current_exception();
+                    abandonFrom(job.sequence);
+                }
+            }
+            job.receipt.miningSeconds = secondsSince(start);
+            toCommit->push(std::move(job));
+        }
+        toCommit->close();
+    }
+
+    // Étage 3 : vérification contre la chaîne puis écriture. Un échec annule ce
+    // bloc et tous ceux assemblés après lui (abandonFrom) ; seul cet étage retire
+    // un bloc écrit de pendingBlocks.
+    void commitStage() {
+        PipelineJob job;
+        while (toCommit->pop(job)) {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (!job.error) {
+                try {
+                    const PoWBlock& block = *job.block;
+                    {
+                        std::lock_guard<std::mutex> lock(pendingMutex);
+                        if (pendingBlocks.empty() || pendingBlocks.front().sequence != job.sequence) {
+                            throw std::runtime_error("bloc " + std::to_string(block.index) + " abandonné après un échec");
+                        }
+                    }
+                    if (pipelineFault) pipelineFault(block.index, PipelineStage::Commit);
+                    if (block.index != chain.size() || block.previousHash != chain.back()->hash ||
+                        block.calculateHash() != block.hash || block.target != retargeterAt(chain.size()).target() ||
+                        !block.verifyConsensus(nullptr)) {
+                        throw std::runtime_error("bloc " + std::to_string(block.index) + " rejeté à l'écriture");
+                    }
+                    job.receipt.index = block.index;
+                    job.receipt.hash = block.hash;
+                    job.receipt.transactions = block.transactions.size();
+                    commit(std::move(job.block));
+                    std::lock_guard<std::mutex> lock(pendingMutex);
+                    pendingBlocks.pop_front();
+                }
+                catch (...) {
+                    job.error = std::current_exception();
+                }
+            }
+            if (job.error) abandonFrom(job.sequence);
+            job.receipt.commitSeconds = secondsSince(start);
+            job.receipt.latencySeconds = secondsSince(job.submitted);
+
+            if (!job.error) {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                auto now = std::chrono::high_resolution_clock::now();
+                if (pipelineStats.blocks == 0) firstCommit = now;
+                pipelineStats.add(job.receipt);
+                pipelineStats.steadySeconds = std::chrono::duration<double>(now - firstCommit).count();
+            }
+            if (job.onCommitted) job.onCommitted(job.receipt, job.error);
+            if (job.error) job.done.set_exception(job.error);
+            else job.done.set_value(job.receipt);
+        }
+    }
+
+    std::future<BlockReceipt> enqueue(PipelineJob job) {
+        if (stages.empty()) throw std::logic_error("submitBlock : pipeline non démarré");
+        job.submitted = std::chrono::high_resolution_clock::now();
+        std::future<BlockReceipt> result = job.done.get_future();
+        if (!toAssemble->push(std::move(job))) throw std::logic_error("submitBlock : pipeline arrêté");
+        return result;
+    }
+
+    void requireIdlePipeline() const {
+        if (!stages.empty()) throw std::logic_error("pipeline en cours : utiliser submitBlock ou stopPipeline");
+    }
+
+    // Écarte (sur place) les transactions mal signées : un lot pour tout le bloc,
+    // puis une vérification par transaction seulement si le lot échoue
+    void dropBadSignatures(std::vector<Transaction>& transactions) {
+        if (verifySignatures(transactions)) return;
+        size_t kept = 0;
+        for (size_t i = 0; i < transactions.size(); ++i) {
+            if (transactions[i].verifySignature()) transactions[kept++] = transactions[i];
+        }
+        std::cout << " " << transactions.size() - kept << " transaction(s) rejetée(s) (signature invalide)\n";
+        transactions.resize(kept);
+    }
+
+    // Applique les transactions à l'état des comptes et ne garde (sur place) que
+    // les valides. Les transactions issues de la mempool ont déjà été vérifiées
+    // à la soumission ; celles refusées dont le nonce reste à venir (une
+    // précédente du même émetteur refusée, ou pas encore reçue) y retournent,
+    // seules celles au nonce déjà consommé sont abandonnées.
+    Amount applyToLedger(std::vector<Transaction>& transactions, bool signaturesChecked) {
+        if (!signaturesChecked) dropBadSignatures(transactions);
+        AccountLedger::BlockResult result = ledger.applyBlock(transactions, &workers);
+        if (result.acceptedCount < transactions.size()) {
+            size_t kept = 0, returned = 0;
+            for (size_t i = 0; i < transactions.size(); ++i) {
+                const Transaction& tx = transactions[i];
+                if (result.accepted[i]) transactions[kept++] = tx;
+                else if (signaturesChecked && tx.nonce >= ledger.nextNonce(tx.sender) && mempool.submit(tx)) ++returned;
+            }
+            std::cout << " " << transactions.size() - result.acceptedCount
+                << " transaction(s) rejetée(s) (solde insuffisant, nonce ou montant invalide)";
+            if (returned > 0) std::cout << ", dont " << returned << " remise(s) en attente";
+            std::cout << "\n";
+            transactions.resize(kept);
+        }
+        return result.fees;
+    }
+    // Registre en vigueur à partir de chaque hauteur (pour rejouer la sélection PoS)
+    std::map<size_t, std::shared_ptr<const ValidatorRegistry> > validatorHistory;
+
+    static constexpr size_t VALIDATION_GRAIN = 64;
+    static constexpr size_t SYNC_RANGE = 64; // blocs par tranche de téléchargement (un lot de signatures)
+
+    void recordValidators() {
+        // Le premier ensemble configuré vaut depuis la génèse
+        size_t from = validatorHistory.empty() ? 0 : chain.size();
+        validatorHistory[from] = std::make_shared<const ValidatorRegistry>(validators);
+    }
+
+    const ValidatorRegistry* validatorsAt(size_t height) const {
+        auto it = validatorHistory.upper_bound(height);
+        if (it == validatorHistory.begin()) return nullptr;
+        return (--it)->second.get();
+    }
+
+    // Hash, racine de Merkle, règle de consensus et signatures d'un bloc,
+    // indépendamment des autres blocs. 'powTarget' : cible exigée par le
+    // réajustement pour un bloc PoW (nullptr : déjà vérifiée par l'appelant).
+    // Avec 'batch', les signatures y sont ajoutées et vérifiées plus tard avec
+    // celles d'autres blocs.
+    BlockError checkContents(const Block& block, const std::vector<Transaction>& txs, const Hash256* powTarget,
+        SignatureBatch* batch = nullptr) const {
+        if (block.calculateHash() != block.hash) return BlockError::Hash;
+        if (computeMerkleRoot(txs) != block.merkleRoot) return BlockError::MerkleRoot;
+        if (!block.verifyConsensus(validatorsAt(block.index))) return BlockError::Consensus;
+        const PoWBlock* pow = dynamic_cast<const PoWBlock*>(&block);
+        if (pow && (retargeter.powLimit() < pow->target || (powTarget && pow->target != *powTarget))) {
+            return BlockError::Consensus;
+        }
+        if (!batch) return verifySignatures(txs) ? BlockError::None : BlockError::Signature;
+        for (const auto& tx : txs) {
+            if (!tx.addSignatureTo(*batch)) return BlockError::Signature;
+        }
+        return BlockError::None;
+    }
+
+    BlockError checkBlock(size_t height, const Hash256& powTarget, SignatureBatch* batch = nullptr) const {
+        const Block& block = *chain[height];
+        if (block.index != height) return BlockError::Index;
+        std::vector<Transaction> stored;
+        if (!block.hasBody && store) stored = store->loadTransactions(height);
+        return checkContents(block, block.hasBody ? block.transactions : stored, &powTarget, batch);
+    }
+
+    static double blockInterval(uint64_t parentMillis, uint64_t millis) {
+        return millis > parentMillis ? static_cast<double>(millis - parentMillis) / 1000.0 : 0.0;
+    }
+
+    // Cible exigée de chaque bloc PoW parmi les 'count' premiers de 'index'
+    // (nulle pour les autres) : le réajustement est rejoué sur les horodatages et
+    // les cibles des en-têtes, couverts par leur hash, donc identique sur tous les nœuds
+    std::vector<Hash256> expectedTargets(const ChainIndex& index, size_t count) const {
+        std::vector<Hash256> targets(count);
+        DifficultyRetargeter replay = retargeter;
+        replay.restart();
+        for (size_t h = 1; h < count; ++h) {
+            if (index.kind(h) != BlockKind::PoW) continue;
+            targets[h] = replay.target();
+            replay.record(blockInterval(index.timeMillis(h - 1), index.timeMillis(h)), index.target(h));
+        }
+        return targets;
+    }
+
+    // Réajustement après le bloc 'parent', sur sa propre branche : blocs en
+    // attente d'abord, puis branche active à partir du point de bifurcation. Sa
+    // cible est celle qu'exige un bloc PoW construit sur 'parent'.
+    DifficultyRetargeter retargeterAfter(const Hash256& parent) const {
+        struct Ancestor {
+            uint64_t millis;
+            bool pow;
+            Hash256 target;
+        };
+        DifficultyRetargeter replay = retargeter;
+        replay.restart();
+        // Ancêtres du plus récent au plus ancien, jusqu'au parent du plus ancien
+        // bloc PoW de la fenêtre
+        std::vector<Ancestor> ancestors;
+        size_t powCount = 0;
+        auto complete = [&](const Ancestor& a) {
+            ancestors.push_back(a);
+            if (powCount == replay.windowSize()) return true;
+            if (a.pow) ++powCount;
+            return false;
+        };
+        Hash256 cursor = parent;
+        size_t height = headers.find(cursor);
+        while (height == ChainIndex::npos) {
+            auto side = sideBlocks.find(cursor);
+            if (side == sideBlocks.end()) return replay;
+            const Block& block = *side->second.block;
+            const PoWBlock* pow = dynamic_cast<const PoWBlock*>(&block);
+            if (complete(Ancestor{ block.timeMillis(), pow != nullptr, pow ? pow->target : Hash256() })) break;
+            cursor = block.previousHash;
+            height = headers.find(cursor);
+        }
+        for (size_t h = height + 1; height != ChainIndex::npos && h-- > 0;) {
+            bool pow = h > 0 && headers.kind(h) == BlockKind::PoW;
+            if (complete(Ancestor{ headers.timeMillis(h), pow, pow ? headers.target(h) : Hash256() })) break;
+        }
+        for (size_t i = ancestors.size(); i-- > 0;) {
+            if (ancestors[i].pow && i + 1 < ancestors.size()) {
+                replay.record(blockInterval(ancestors[i + 1].millis, ancestors[i].millis), ancestors[i].target);
+            }
+        }
+        return replay;
+    }
+
+    // Réajustement après les 'height' premiers blocs de la branche active
+    DifficultyRetargeter retargeterAt(size_t height) const {
+        return retargeterAfter(headers.hash(height - 1));
+    }
+
+    // Poids d'un bloc pour le choix de branche : travail attendu d'après la cible
+    // (PoW) ou stake du validateur élu (PoS). Les deux unités ne se comparent pas :
+    // une bifurcation oppose en pratique des blocs de même type.
+    double blockWork(const Block& block) const {
+        if (const PoWBlock* pow = dynamic_cast<const PoWBlock*>(&block)) return targetDifficulty(pow->target);
+        if (const PoSBlock* pos = dynamic_cast<const PoSBlock*>(&block)) {
+            const ValidatorRegistry* registry = validatorsAt(block.index);
+            uint64_t stake = registry ? registry->stakeOf(pos->validatorId) : 0;
+            return stake > 0 ? static_cast<double>(stake) : 1.0;
+        }
+        return 0.0;
+    }
+
+    void commit(std::unique_ptr<Block> block) {
+        METRIC_TIME(BlockCommit);
+        METRIC_ADD(BlocksCommitted, 1);
+        std::unique_lock<std::shared_mutex> lock(chainMutex);
+        if (store) store->append(*block);
+        headers.append(*block, blockWork(*block));
+        chain.push_back(std::move(block));
+    }
+
+    // Arbre des blocs : tout bloc valide connu hors de la branche active (branches
+    // concurrentes, blocs déconnectés par une réorganisation) avec son poids cumulé
+    struct SideBlock {
+        std::unique_ptr<Block> block;
+        double work;
+        bool wasActive; // déjà connecté une fois : ses transactions ignorées sont tolérées
+    };
+    std::unordered_map<Hash256, SideBlock, Hash256Hasher> sideBlocks;
+    std::unordered_set<Hash256, Hash256Hasher> invalidBlocks;
+
+    // Retire le bloc au sommet : état des comptes annulé (journal du bloc, sauf
+    // si 'rollback' est faux : état déjà reconstruit en dessous), bloc rangé
+    // parmi les branches concurrentes avec son corps
+    void disconnectTip(bool rollback = true) {
+        std::unique_lock<std::shared_mutex> lock(chainMutex);
+        std::unique_ptr<Block>& tip = chain.back();
+        if (!tip->hasBody && store) {
+            tip->transactions = store->loadTransactions(tip->index);
+            tip->hasBody = true;
+        }
+        double work = headers.work(chain.size() - 1);
+        if (rollback) ledger.rollbackBlock();
+        Hash256 hash = tip->hash;
+        sideBlocks[hash] = SideBlock{ std::move(tip), work, true };
+        chain.pop_back();
+        headers.truncate(chain.size());
+    }
+
+    void truncateStore(size_t height) {
+        if (!store) return;
+        std::unique_lock<std::shared_mutex> lock(chainMutex);
+        store->truncate(height);
+    }
+
+    // Connecte au sommet un bloc de l'arbre. Contrairement aux blocs produits
+    // localement, une seule transaction refusée invalide un bloc reçu (oublié).
+    bool connectSide(const Hash256& hash) {
+        auto node = sideBlocks.find(hash);
+        std::unique_ptr<Block> block = std::move(node->second.block);
+        bool wasActive = node->second.wasActive;
+        sideBlocks.erase(node);
+        AccountLedger::BlockResult result = ledger.applyBlock(block->transactions, &workers);
+        if (!wasActive && result.acceptedCount != block->transactions.size()) {
+            ledger.rollbackBlock();
+            invalidBlocks.insert(hash);
+            return false;
+        }
+        if (const PoSBlock* pos = dynamic_cast<const PoSBlock*>(block.get())) ledger.payFees(pos->validatorId, result.fees);
+        mempool.removeConfirmed(block->transactions);
+        commit(std::move(block));
+        return true;
+    }
+
+    // Bascule vers la branche terminée par 'tip' : seuls les blocs au-dessus du
+    // point de bifurcation sont déconnectés puis connectés, le coût dépend de la
+    // profondeur et non de la longueur de la chaîne. Si un bloc de la nouvelle
+    // branche est refusé, l'ancienne branche est rétablie.
+    bool reorganize(const Hash256& tip) {
+        std::vector<Hash256> branch;
+        for (Hash256 cursor = tip; !headers.contains(cursor);) {
+            auto node = sideBlocks.find(cursor);
+            if (node == sideBlocks.end()) return false; // ancêtre invalide
+            branch.push_back(cursor);
+            cursor = node->second.block->previousHash;
+        }
+        std::reverse(branch.begin(), branch.end());
+        size_t fork = sideBlocks.at(branch.front()).block->index - 1;
+        std::vector<Hash256> abandoned;
+        for (size_t h = fork + 1; h < chain.size(); ++h) abandoned.push_back(headers.hash(h));
+
+        // Journaux manquants (chaîne rechargée sans rebuildLedger, ou bifurcation
+        // plus profonde que AccountLedger::MAX_JOURNAL_DEPTH) : état reconstruit
+        // jusqu'au point de bifurcation, blocs abandonnés retirés sans annulation
+        bool rebuilt = ledger.depth() < abandoned.size();
+        if (rebuilt) rebuildLedger(fork + 1);
+        while (chain.size() > fork + 1) disconnectTip(!rebuilt);
+        truncateStore(fork + 1);
+
+        for (size_t i = 0; i < branch.size(); ++i) {
+            if (connectSide(branch[i])) continue;
+            // Descendants du bloc refusé : invalides eux aussi
+            for (size_t j = i + 1; j < branch.size(); ++j) {
+                sideBlocks.erase(branch[j]);
+                invalidBlocks.insert(branch[j]);
+            }
+            while (chain.size() > fork + 1) disconnectTip();
+            truncateStore(fork + 1);
+            for (const auto& old : abandoned) connectSide(old);
+            return false;
+        }
+
+        // Transactions des blocs abandonnés absentes de la nouvelle branche : retour en mempool
+        std::unordered_set<uint64_t> included;
+        for (size_t h = fork + 1; h < chain.size(); ++h) {
+            for (const auto& tx : chain[h]->transactions) included.insert(tx.id);
+        }
+        for (const auto& old : abandoned) {
+            for (const auto& tx : sideBlocks.at(old).block->transactions) {
+                if (!included.count(tx.id)) mempool.submit(tx);
+            }
+        }
+        return true;
+    }
+
+public:
+    // workerThreads : pool de validation et de construction de Merkle (0 = un par cœur)
+    Blockchain(int difficulty = 2, unsigned miningThreads = 0, unsigned workerThreads = 0)
+        : validatorsChanged(false), epochLength(100),
+          retargeter(targetFromZeroDigits(difficulty), 0.0, 10, targetFromZeroDigits(difficulty)), miner(miningThreads),
+          workers(workerThreads), store(nullptr),
+          maxBlockTransactions(1000), pipelineSequence(0), assembleIndex(0) {
+
+        chain.push_back(std::unique_ptr<Block>(new Block(0, Hash256(), std::vector<Transaction>())));
+        headers.append(*chain.back(), 0.0);
+
+        std::cout << " Blockchain créée (bloc génèse)\n";
+    }
+
+    ~Blockchain() {
+        stopPipeline();
+    }
+
+    // Génèse partagée par plusieurs nœuds (celle du constructeur est horodatée
+    // à la création, donc propre à chaque instance)
+    void setGenesis(const Block& genesis) {
+        if (chain.size() != 1 || store) throw std::logic_error("setGenesis : chaîne déjà commencée");
+        chain[0].reset(new Block(0, Hash256(), genesis.merkleRoot, genesis.timestamp, genesis.hash));
+        chain[0]->hasBody = true;
+        headers.clear();
+        headers.append(*chain[0], 0.0);
+    }
+
+    // Remplace l'ensemble des validateurs immédiatement (table d'alias reconstruite)
+    void setValidators(const std::vector<Validator>& _validators) {
+        nextEpochValidators = _validators;
+        validators.build(nextEpochValidators);
+        validatorsChanged = false;
+        recordValidators();
+    }
+
+    // Modifie (ou ajoute, ou retire avec stake = 0) un validateur ; pris en compte
+    // au début de l'époque suivante
+    void updateStake(const std::string& id, uint64_t stake) {
+        auto it = std::find_if(nextEpochValidators.begin(), nextEpochValidators.end(),
+            [&id](const Validator& v) { return v.id == id; });
+        if (it != nextEpochValidators.end()) it->stake = stake;
+        else nextEpochValidators.push_back(Validator(id, stake));
+        validatorsChanged = true;
+    }
+
+    void setEpochLength(size_t blocks) {
+        epochLength = blocks > 0 ? blocks : 1;
+    }
+
+    void setMiningThreads(unsigned threads) {
+        miner.setThreadCount(threads);
+    }
+
+    // Temps de bloc PoW visé (secondes) et taille de la fenêtre glissante ; <= 0 : cible fixe
+    void setTargetBlockTime(double seconds, size_t windowBlocks = 10) {
+        retargeter.configure(seconds, windowBlocks);
+    }
+
+    // Cible exigée du prochain bloc PoW
+    Hash256 getPowTarget() const { return retargeterAt(chain.size()).target(); }
+
+    void setMaxBlockTransactions(size_t count) {
+        maxBlockTransactions = count > 0 ? count : 1;
+    }
+
+    // Auto-tests : 'hook' est appelé avec la hauteur du bloc au début des étages
+    // de minage et d'écriture ; une exception qu'il lève fait échouer le bloc
+    // comme une vraie erreur de l'étage
+    void setPipelineFaultHook(std::function<void(size_t, PipelineStage)> hook) {
+        requireIdlePipeline();
+        pipelineFault = std::move(hook);
+    }
+
+    // Soumission thread-safe des transactions en attente ; la signature est
+    // vérifiée ici, une fois pour toutes
+    bool submitTransaction(const Transaction& tx) {
+        return tx.verifySignature() && mempool.submit(tx);
+    }
+
+    Mempool& getMempool() { return mempool; }
+
+    // Blocs assemblés à partir des transactions les mieux payées de la mempool
+    void addBlockPoW() {
+        produceBlockPoW(mempool.takeBest(maxBlockTransactions), true);
+    }
+
+    void addBlockPoS() {
+        produceBlockPoS(mempool.takeBest(maxBlockTransactions), true);
+    }
+
+    // Solde initial d'un compte (génèse)
+    void credit(const std::string& account, Amount amount) {
+        allocations.emplace_back(account, amount);
+        ledger.credit(account, amount);
+    }
+
+    Amount getBalance(const std::string& account) const {
+        return ledger.balance(account);
+    }
+
+    // Nonce de la prochaine transaction du compte dans un bloc (hors mempool)
+    uint64_t getNextNonce(const std::string& account) const {
+        return ledger.nextNonce(account);
+    }
+
+    // Reconstruit l'état des comptes en rejouant les blocs depuis la génèse,
+    // jusqu'à la hauteur 'height' exclue (toute la chaîne par défaut) ;
+    // renvoie le nombre de transactions invalides rencontrées
+    size_t rebuildLedger(size_t height = SIZE_MAX) {
+        ledger = AccountLedger();
+        for (const auto& a : allocations) ledger.credit(a.first, a.second);
+        size_t invalid = 0;
+        for (size_t i = 1; i < std::min(height, chain.size()); ++i) {
+            const Block& block = *chain[i];
+            std::vector<Transaction> stored;
+            if (!block.hasBody && store) stored = store->loadTransactions(i);
+            const std::vector<Transaction>& txs = block.hasBody ? block.transactions : stored;
+            AccountLedger::BlockResult result = ledger.applyBlock(txs, &workers);
+            invalid += txs.size() - result.acceptedCount;
+            if (const PoSBlock* pos = dynamic_cast<const PoSBlock*>(&block)) ledger.payFees(pos->validatorId, result.fees);
+        }
+        return invalid;
+    }
+
+    // Branche un stockage persistant. S'il est vide, la chaîne actuelle y est
+    // écrite ; sinon la chaîne est rechargée depuis lui, en-têtes seulement
+    // (les transactions sont lues à la demande par getBlock). Dans ce cas,
+    // rebuildLedger() recalcule les soldes.
+    void attachStore(BlockStore& blockStore) {
+        store = &blockStore;
+        if (store->size() == 0) {
+            for (const auto& block : chain) store->append(*block);
+            return;
+        }
+        chain.clear();
+        chain.reserve(store->size());
+        headers.clear();
+        headers.reserve(store->size());
+        for (size_t i = 0; i < store->size(); ++i) {
+            chain.push_back(store->loadHeader(i));
+            headers.append(*chain.back(), blockWork(*chain.back()));
+        }
+        std::cout << " Chaîne rechargée depuis le disque (" << chain.size() << " blocs)\n";
+    }
+
+    // Démarre les trois étages ; 'depth' = capacité de chaque file entre étages.
+    // Tant que le pipeline tourne, la chaîne n'est modifiée que par lui : les
+    // blocs sont ajoutés par submitBlock et suivis par leurs récépissés.
+    void startPipeline(size_t depth = 2) {
+        if (!stages.empty()) return;
+        toAssemble.reset(new BoundedQueue<PipelineJob>(depth));
+        toMine.reset(new BoundedQueue<PipelineJob>(depth));
+        toCommit.reset(new BoundedQueue<PipelineJob>(depth));
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            pipelineStats = PipelineStats();
+        }
+        pendingBlocks.clear();
+        assembleIndex = chain.size();
+        stages.emplace_back(&Blockchain::assembleStage, this);
+        stages.emplace_back(&Blockchain::mineStage, this, chain.back()->hash, chain.back()->timeMillis(),
+            retargeterAt(chain.size()));
+        stages.emplace_back(&Blockchain::commitStage, this);
+    }
+
+    // Termine les blocs déjà soumis puis arrête les étages
+    void stopPipeline() {
+        if (stages.empty()) return;
+        toAssemble->close();
+        for (auto& stage : stages) stage.join();
+        stages.clear();
+    }
+
+    bool pipelineRunning() const { return !stages.empty(); }
+
+    // Soumet un bloc PoW au pipeline. Bloque si la file d'assemblage est pleine
+    // (contre-pression). Le futur et le rappel éventuel (appelé sur le thread
+    // d'écriture, ne doit pas lever d'exception) reçoivent le récépissé ou l'erreur.
+    std::future<BlockReceipt> submitBlock(std::vector<Transaction> transactions, BlockCallback onCommitted = nullptr) {
+        PipelineJob job;
+        job.transactions = std::move(transactions);
+        job.onCommitted = std::move(onCommitted);
+        return enqueue(std::move(job));
+    }
+
+    // Bloc rempli à l'assemblage avec les transactions les mieux payées de la mempool
+    std::future<BlockReceipt> submitBlock(BlockCallback onCommitted = nullptr) {
+        PipelineJob job;
+        job.fromMempool = true;
+        job.onCommitted = std::move(onCommitted);
+        return enqueue(std::move(job));
+    }
+
+    PipelineStats getPipelineStats() {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return pipelineStats;
+    }
+
+    // Frais brûlés : un bloc PoW n'identifie pas son mineur
+    void addBlockPoW(std::vector<Transaction> transactions) {
+        produceBlockPoW(std::move(transactions), false);
+    }
+
+    // Frais versés au validateur élu
+    void addBlockPoS(std::vector<Transaction> transactions) {
+        produceBlockPoS(std::move(transactions), false);
+    }
+
+private:
+    void produceBlockPoW(std::vector<Transaction> transactions, bool signaturesChecked) {
+        requireIdlePipeline();
+        applyToLedger(transactions, signaturesChecked);
+        Hash256 lastHash = chain.back()->hash;
+        DifficultyRetargeter next = retargeterAt(chain.size());
+        //  unique_ptr
+        std::unique_ptr<PoWBlock> block(new PoWBlock(chain.size(), lastHash, std::move(transactions),
+            next.target(), &workers));
+        MiningResult result = miner.mine(*block);
+        if (!result.found) {
+            ledger.rollbackBlock();
+            throw std::runtime_error("aucun nonce valide pour le bloc " + std::to_string(block->index));
+        }
+        block->nonce = result.nonce;
+        block->hash = result.hash;
+        next.record(blockInterval(chain.back()->timeMillis(), block->timeMillis()), block->target);
+        auto ms = static_cast<long long>(result.seconds * 1000.0);
+
+        std::cout << " Bloc PoW ajouté [" << block->index << "] en " << ms << " ms\n";
+        std::cout << "   Hash : " << block->hash << "\n";
+        std::cout << "   " << block->getConsensusInfo() << "\n";
+        for (size_t t = 0; t < result.attemptsPerThread.size(); ++t) {
+            std::cout << "   Thread " << t << " : " << result.attemptsPerThread[t] << " hashes, "
+                << static_cast<long long>(result.hashRate(t)) << " H/s\n";
+        }
+        if (next.enabled()) {
+            std::cout << "   Cible suivante : diff " << std::fixed << std::setprecision(1)
+                << targetDifficulty(next.target()) << " (moyenne " << next.averageSeconds() * 1000.0
+                << " ms sur " << next.sampleCount() << " blocs)\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+        std::cout << "\n";
+
+        commit(std::move(block));
+    }
+
+    void produceBlockPoS(std::vector<Transaction> transactions, bool signaturesChecked) {
+        requireIdlePipeline();
+        if (validatorsChanged && chain.size() % epochLength == 0) {
+            validators.build(nextEpochValidators);
+            validatorsChanged = false;
+            recordValidators();
+        }
+        if (validators.size() == 0) {
+            std::cerr << "  Aucun validateur configuré pour PoS !\n";
+            return;
+        }
+        Amount fees = applyToLedger(transactions, signaturesChecked);
+        Hash256 lastHash = chain.back()->hash;
+        std::unique_ptr<PoSBlock> block(new PoSBlock(chain.size(), lastHash, std::move(transactions), &workers));
+        block->selectValidator(validators);
+        ledger.payFees(block->validatorId, fees);
+        auto start = std::chrono::high_resolution_clock::now();
+        block->finalize();
+        auto end = std::chrono::high_resolution_clock::now();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        std::cout << " Bloc PoS ajouté [" << block->index << "] en " << us << " µs\n";
+        std::cout << "   Hash : " << block->hash << "\n";
+        std::cout << "   " << block->getConsensusInfo() << "\n\n";
+
+        commit(std::move(block));
+    }
+
+public:
+    size_t size() const { return chain.size(); }
+
+    // Bloc produit ailleurs (autre nœud, autre mineur) : vérifié seul, rangé dans
+    // l'arbre, puis connecté si son poids cumulé dépasse celui de la branche active
+    // (à égalité, la branche vue en premier est conservée)
+    AcceptResult acceptBlock(std::unique_ptr<Block> block) {
+        requireIdlePipeline();
+        const Hash256 hash = block->hash;
+        if (headers.contains(hash) || sideBlocks.count(hash) || invalidBlocks.count(hash)) return AcceptResult::Duplicate;
+
+        double parentWork;
+        size_t parentHeight = headers.find(block->previousHash);
+        if (parentHeight != ChainIndex::npos) {
+            parentWork = headers.work(parentHeight);
+        }
+        else {
+            auto parent = sideBlocks.find(block->previousHash);
+            if (parent == sideBlocks.end()) {
+                if (!invalidBlocks.count(block->previousHash)) return AcceptResult::Orphan;
+                invalidBlocks.insert(hash);
+                return AcceptResult::Invalid;
+            }
+            parentWork = parent->second.work;
+            parentHeight = parent->second.block->index;
+        }
+        // Cible exigée rejouée sur la branche du bloc, qu'elle soit active ou non
+        Hash256 required = retargeterAfter(block->previousHash).target();
+        if (block->index != parentHeight + 1 || !block->hasBody ||
+            checkContents(*block, block->transactions, &required) != BlockError::None) {
+            invalidBlocks.insert(hash);
+            return AcceptResult::Invalid;
+        }
+
+        double work = parentWork + blockWork(*block);
+        bool extendsTip = block->previousHash == headers.hash(headers.size() - 1);
+        sideBlocks[hash] = SideBlock{ std::move(block), work, false };
+        if (extendsTip) {
+            return connectSide(hash) ? AcceptResult::Connected : AcceptResult::Invalid;
+        }
+        if (work <= headers.work(chain.size() - 1)) return AcceptResult::SideBranch;
+        return reorganize(hash) ? AcceptResult::Reorganized : AcceptResult::Invalid;
+    }
+
+    // Poids cumulé de la branche active
+    double getTipWork() const { return headers.work(headers.size() - 1); }
+
+    size_t sideBlockCount() const { return sideBlocks.size(); }
+
+    // Bloc complet : charge ses transactions depuis le stockage si nécessaire
+    const Block& getBlock(size_t i) {
+        Block& block = *chain.at(i);
+        if (!block.hasBody && store) {
+            std::unique_lock<std::shared_mutex> lock(chainMutex);
+            block.transactions = store->loadTransactions(i);
+            block.hasBody = true;
+        }
+        return block;
+    }
+
+    // En-tête seul (transactions éventuellement non chargées)
+    const Block& getHeader(size_t i) const { return *chain.at(i); }
+
+    const ChainIndex& getIndex() const { return headers; }
+
+    // Hauteur du bloc de hash donné sur la branche active, ChainIndex::npos s'il
+    // n'y est pas ; sûre depuis n'importe quel thread
+    size_t findHeight(const Hash256& hash) const {
+        std::shared_lock<std::shared_mutex> lock(chainMutex);
+        return headers.find(hash);
+    }
+
+    // Lectures sûres depuis n'importe quel thread, même pendant la production
+    // de blocs ou une réorganisation
+    ChainTip getTip() {
+        ChainTip tip;
+        {
+            std::shared_lock<std::shared_mutex> lock(chainMutex);
+            tip.height = chain.size() - 1;
+            tip.hash = headers.hash(tip.height);
+            tip.work = headers.work(tip.height);
+        }
+        tip.mempoolSize = mempool.size();
+        return tip;
+    }
+
+    bool blockHashAt(size_t height, Hash256& hash) const {
+        std::shared_lock<std::shared_mutex> lock(chainMutex);
+        if (height >= chain.size()) return false;
+        hash = headers.hash(height);
+        return true;
+    }
+
+    // Bloc de la branche active au format du BlockStore ; false s'il n'y est pas
+    bool readBlockRecord(const Hash256& hash, std::vector<uint8_t>& record) const {
+        std::shared_lock<std::shared_mutex> lock(chainMutex);
+        size_t height = headers.find(hash);
+        if (height == ChainIndex::npos) return false;
+        const Block& block = *chain[height];
+        if (block.hasBody || !store) BlockStore::encode(block, record);
+        else store->loadRecord(height, record);
+        return true;
+    }
+
+    // Chaînage, preuve de travail et cible de chaque bloc PoW (réajustement
+    // rejoué sur les horodatages) vérifiés sur les seuls en-têtes
+    bool isValid() const {
+        size_t bad = headers.firstInvalidHeader();
+        std::vector<Hash256> targets = expectedTargets(headers, headers.size());
+        for (size_t h = 1; h < std::min(bad, headers.size()); ++h) {
+            if (headers.kind(h) == BlockKind::PoW && headers.target(h) != targets[h]) {
+                std::cerr << " Erreur : cible hors règle de réajustement au bloc " << h << "\n";
+                return false;
+            }
+        }
+        if (bad == ChainIndex::npos) return true;
+        if (headers.previousHash(bad) != headers.hash(bad - 1)) {
+            std::cerr << " Erreur : previousHash invalide au bloc " << bad << "\n";
+        }
+        else {
+            std::cerr << " Erreur : hash au-dessus de la cible au bloc " << bad << "\n";
+        }
+        return false;
+    }
+
+    // Validation complète : hash recalculé, racine de Merkle, règle de consensus
+    // (cible PoW rejouée, sélection PoS rejouée) et signatures des transactions
+    // vérifiés en parallèle bloc par bloc, puis chaînage des previousHash en un
+    // passage séquentiel.
+    ValidationReport validate() {
+        METRIC_TIME(ChainValidation);
+        METRIC_ADD(BlocksValidated, chain.size());
+        ValidationReport report;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<BlockError> errors(chain.size(), BlockError::None);
+        std::vector<Hash256> targets = expectedTargets(headers, chain.size());
+        // Un lot de signatures par tranche de blocs ; s'il échoue, les blocs de la
+        // tranche sont revérifiés un par un pour situer le fautif
+        workers.parallelFor(chain.size(), VALIDATION_GRAIN, [this, &errors, &targets](size_t begin, size_t end) {
+            SignatureBatch batch;
+            for (size_t i = begin; i < end; ++i) errors[i] = checkBlock(i, targets[i], &batch);
+            if (batch.verify()) return;
+            for (size_t i = begin; i < end; ++i) {
+                if (errors[i] == BlockError::None) errors[i] = checkBlock(i, targets[i]);
+            }
+        });
+        for (size_t i = 1; i < chain.size(); ++i) {
+            if (errors[i] == BlockError::None && headers.previousHash(i) != headers.hash(i - 1)) {
+                errors[i] = BlockError::Link;
+            }
+        }
+
+        auto firstBad = std::find_if(errors.begin(), errors.end(), [](BlockError e) { return e != BlockError::None; });
+        if (firstBad != errors.end()) {
+            report.valid = false;
+            report.firstInvalid = static_cast<size_t>(firstBad - errors.begin());
+            report.error = *firstBad;
+        }
+        report.blocksChecked = chain.size();
+        report.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        return report;
+    }
+
+    // Synchronisation initiale, en-têtes d'abord. 1) Tous les en-têtes : chaînage,
+    // hash, preuve de travail, cible exigée par le réajustement (rejoué sur les
+    // en-têtes reçus) et règle de consensus, sans aucune transaction. 2) Les
+    // corps du préfixe valide, téléchargés en parallèle et dans le désordre par
+    // tranches de SYNC_RANGE blocs (racine de Merkle contre l'en-tête validé, un
+    // lot de signatures par tranche), au plus 'window' blocs en avance sur
+    // l'écriture. 3) Connexion dans l'ordre : état des comptes puis commit.
+    // Chaîne neuve requise (génèse seule) : la génèse de la source est adoptée ;
+    // les soldes de génèse (credit) doivent être ceux de la source.
+    SyncReport syncFrom(BlockSource& source, size_t window = 4096) {
+        requireIdlePipeline();
+        if (chain.size() != 1) throw std::logic_error("syncFrom : chaîne déjà commencée");
+        window = std::max(window, 2 * SYNC_RANGE);
+        SyncReport report;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        size_t count = source.size();
+        std::vector<std::unique_ptr<Block> > fetched;
+        fetched.reserve(count);
+        ChainIndex candidate;
+        candidate.reserve(count);
+        size_t valid = count;
+        for (size_t h = 0; h < count; ++h) {
+            std::unique_ptr<Block> header;
+            try {
+                header = source.header(h);
+            }
+            catch (const std::exception&) {
+                valid = h;
+                break;
+            }
+            if (header->index != h) {
+                valid = h;
+                break;
+            }
+            fetched.push_back(std::move(header));
+        }
+        // Hash et consensus avant l'index : append interne les validateurs PoS
+        // dans la table globale des noms, jamais purgée
+        std::atomic<size_t> firstBadHash(valid);
+        workers.parallelFor(valid, VALIDATION_GRAIN * 64, [&](size_t begin, size_t end) {
+            for (size_t h = begin; h < end; ++h) {
+                const Block& block = *fetched[h];
+                if (block.calculateHash() == block.hash && block.verifyConsensus(validatorsAt(h))) continue;
+                size_t seen = firstBadHash.load();
+                while (h < seen && !firstBadHash.compare_exchange_weak(seen, h)) {}
+                return;
+            }
+        });
+        for (size_t h = 0; h < firstBadHash.load(); ++h) candidate.append(*fetched[h], blockWork(*fetched[h]));
+        std::vector<Hash256> targets = expectedTargets(candidate, candidate.size());
+        size_t badTarget = candidate.size();
+        for (size_t h = 1; h < candidate.size() && badTarget == candidate.size(); ++h) {
+            if (candidate.kind(h) == BlockKind::PoW && candidate.target(h) != targets[h]) badTarget = h;
+        }
+        valid = std::min({ valid, firstBadHash.load(), candidate.firstInvalidHeader(), badTarget });
+        report.headers = count;
+        report.validHeaders = valid;
+        if (valid < count) {
+            report.failedHeight = valid;
+            report.failure = "en-tête invalide";
+        }
+        auto headersDone = std::chrono::high_resolution_clock::now();
+        report.headerSeconds = std::chrono::duration<double>(headersDone - start).count();
+        if (valid == 0) return report;
+
+        {
+            std::unique_lock<std::shared_mutex> lock(chainMutex);
+            chain[0] = std::move(fetched[0]);
+            chain[0]->transactions = source.body(0);
+            chain[0]->hasBody = true;
+            headers.clear();
+            headers.append(*chain[0], 0.0);
+            if (store) {
+                store->truncate(0);
+                store->append(*chain[0]);
+            }
+        }
+
+        struct Slot {
+            std::vector<Transaction> transactions;
+            std::string failure;
+            bool ready;
+            Slot() : ready(false) {}
+        };
+        std::vector<Slot> slots(window);
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t nextFetch = 1, nextCommit = 1, running = 0;
+        bool stopping = false;
+
+        auto fetch = [&]() {
+            for (;;) {
+                size_t begin, end;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] {
+                        return stopping || nextFetch >= valid || std::min(valid, nextFetch + SYNC_RANGE) <= nextCommit + window;
+                    });
+                    if (stopping || nextFetch >= valid) {
+                        --running;
+                        changed.notify_all();
+                        return;
+                    }
+                    begin = nextFetch;
+                    end = std::min(valid, begin + SYNC_RANGE);
+                    nextFetch = end;
+                }
+                std::vector<std::vector<Transaction> > bodies(end - begin);
+                std::vector<std::string> failures(end - begin);
+                SignatureBatch batch;
+                for (size_t h = begin; h < end; ++h) {
+                    std::vector<Transaction>& txs = bodies[h - begin];
+                    try {
+                        txs = source.body(h);
+                    }
+                    catch (const std::exception& e) {
+                        failures[h - begin] = e.what();
+                        continue;
+                    }
+                    if (computeMerkleRoot(txs) != fetched[h]->merkleRoot) {
+                        failures[h - begin] = blockErrorName(BlockError::MerkleRoot);
+                        continue;
+                    }
+                    for (const auto& tx : txs) {
+                        if (!tx.addSignatureTo(batch)) failures[h - begin] = blockErrorName(BlockError::Signature);
+                    }
+                }
+                // Lot refusé : vérification bloc par bloc pour situer le fautif
+                if (!batch.verify()) {
+                    for (size_t i = 0; i < bodies.size(); ++i) {
+                        if (failures[i].empty() && !verifySignatures(bodies[i])) failures[i] = blockErrorName(BlockError::Signature);
+                    }
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (size_t h = begin; h < end; ++h) {
+                        Slot& slot = slots[h % window];
+                        slot.transactions = std::move(bodies[h - begin]);
+                        slot.failure = std::move(failures[h - begin]);
+                        slot.ready = true;
+                    }
+                }
+                changed.notify_all();
+            }
+        };
+        running = std::max<size_t>(1, workers.size());
+        for (size_t t = 0; t < running; ++t) workers.submit(fetch);
+
+        for (size_t h = 1; h < valid; ++h) {
+            Slot& slot = slots[h % window];
+            std::vector<Transaction> txs;
+            std::string failure;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return slot.ready; });
+                txs = std::move(slot.transactions);
+                failure = std::move(slot.failure);
+                slot.ready = false;
+                nextCommit = h + 1;
+            }
+            changed.notify_all();
+            if (!failure.empty()) {
+                report.failedHeight = h;
+                report.failure = failure;
+                break;
+            }
+            std::unique_ptr<Block> block = std::move(fetched[h]);
+            block->transactions = std::move(txs);
+            block->hasBody = true;
+            AccountLedger::BlockResult result = ledger.applyBlock(block->transactions);
+            if (result.acceptedCount != block->transactions.size()) {
+                ledger.rollbackBlock();
+                report.failedHeight = h;
+                report.failure = "transaction refusée par l'état des comptes";
+                break;
+            }
+            if (const PoSBlock* pos = dynamic_cast<const PoSBlock*>(block.get())) ledger.payFees(pos->validatorId, result.fees);
+            if (mempool.size() > 0) mempool.removeConfirmed(block->transactions);
+            report.transactions += block->transactions.size();
+            commit(std::move(block));
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+            changed.notify_all();
+            changed.wait(lock, [&] { return running == 0; });
+        }
+        report.blocks = chain.size();
+        report.bodySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - headersDone).count();
+        return report;
+    }
+
+    void printChain() const {
+        std::cout << "\n=== BLOCKCHAIN ===\n";
+        for (size_t i = 0; i < headers.size(); ++i) {
+            std::cout << "Bloc #" << i
+                << " | Hash: " << headers.hash(i).toHex().substr(0, 10) << "..."
+                << " | Merkle: " << headers.merkleRoot(i).toHex().substr(0, 10) << "..."
+                << " | " << headers.consensusInfo(i) << "\n";
+        }
+        std::cout << "==================\n\n";
+    }
+};
+
+// Pair local : lectures sous le verrou partagé de sa chaîne, qui peut continuer
+// à produire des blocs pendant la synchronisation (hauteur figée à la construction)
+class PeerBlockSource : public BlockSource {
+private:
+    Blockchain& peer;
+    size_t count;
+
+    std::vector<uint8_t> record(size_t height) {
+        Hash256 hash;
+        std::vector<uint8_t> bytes;
+        if (!peer.blockHashAt(height, hash) || !peer.readBlockRecord(hash, bytes)) {
+            throw std::runtime_error("PeerBlockSource : bloc " + std::to_string(height) + " retiré par le pair");
+        }
+        return bytes;
+    }
+
+public:
+    explicit PeerBlockSource(Blockchain& chain) : peer(chain), count(chain.getTip().height + 1) {}
+
+    size_t size() override { return count; }
+
+    std::unique_ptr<Block> header(size_t height) override {
+        std::vector<uint8_t> bytes = record(height);
+        return BlockStore::decodeHeader(bytes.data(), bytes.size());
+    }
+
+    std::vector<Transaction> body(size_t height) override {
+        std::vector<uint8_t> bytes = record(height);
+        return BlockStore::decodeTransactions(bytes.data(), bytes.size(), true);
+    }
+};
+
+// ==================================================
+// UTILITAIRE TRANSACTIONS
+// ==================================================
+// Nonces à la suite de 'nonces' s'il est fourni (plusieurs lots pour une même
+// chaîne), sinon à partir de 0
+std::vector<Transaction> createSampleTransactions(int count, std::unordered_map<AccountId, uint64_t>* nonces = nullptr) {
+    std::vector<Transaction> txs;
+    std::vector<std::string> users = { "Alice", "Bob", "Charlie", "Dave", "Eve" };
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> userDist(0, static_cast<int>(users.size()) - 1);
+    std::uniform_real_distribution<> amountDist(0.1, 10.0);
+    std::uniform_real_distribution<> feeDist(0.001, 0.1);
+
+    for (int i = 0; i < count; ++i) {
+        std::string sender = users[userDist(gen)];
+        std::string receiver;
+        do {
+            receiver = users[userDist(gen)];
+        } while (receiver == sender);
+        double amount = amountDist(gen);
+        txs.push_back(Transaction(sender, receiver, amount, feeDist(gen)));
+    }
+    std::unordered_map<AccountId, uint64_t> fromZero;
+    assignNonces(txs, nonces ? *nonces : fromZero);
+    return txs;
+}
+
+// ==================================================
+// SIMULATEUR DE RÉSEAU (GOSSIP)
+// ==================================================
+// N nœuds complets (une Blockchain chacun) dans un même processus, reliés par
+// des liens simulés : latence propre à chaque lien, débit montant partagé par
+// les connexions d'un nœud. Simulation à événements discrets : les délais du
+// réseau sont calculés, le temps de traitement d'un message est le temps
+// réellement mesuré sur la machine, ajouté à l'horloge du nœud qui le traite.
+//
+// Relais par inventaire : un nœud annonce le hash (INV) à ses pairs, qui ne
+// demandent (GETDATA) que ce qu'ils ne connaissent pas encore. Blocs compacts
+// (BIP 152) : en-tête et identifiants courts de 6 octets ; le récepteur
+// reconstruit le bloc depuis sa mempool et ne demande (GETBLOCKTXN) que les
+// transactions manquantes. Les messages sont de vrais octets (codec du
+// BlockStore pour les blocs) : les tailles mesurées sont celles du fil.
+
+// Coupe la console pendant la préparation des données (Blockchain est bavarde)
+struct QuietOutput {
+    QuietOutput() { std::cout.setstate(std::ios::failbit); }
+    ~QuietOutput() { std::cout.clear(); }
+};
+
+enum class NetMessageType : uint8_t { Inv, GetData, Tx, Block, CompactBlock, GetBlockTxn, BlockTxn };
+enum class InventoryKind : uint8_t { Tx, Block };
+
+struct NetMessage {
+    static constexpr size_t ENVELOPE_SIZE = 24; // magic, commande, longueur, somme de contrôle
+
+    NetMessageType type;
+    uint32_t from;
+    std::vector<uint8_t> payload;
+
+    size_t wireSize() const { return ENVELOPE_SIZE + payload.size(); }
+
+    bool isBlockRelay() const {
+        if (type == NetMessageType::Inv || type == NetMessageType::GetData) {
+            return !payload.empty() && payload[0] == static_cast<uint8_t>(InventoryKind::Block);
+        }
+        return type != NetMessageType::Tx;
+    }
+};
+
+struct NetworkConfig {
+    size_t nodes;
+    size_t outboundPeers;    // connexions ouvertes par chaque nœud (liens bidirectionnels)
+    double minLatencyMs;
+    double maxLatencyMs;
+    double uplinkMbps;
+    bool compactBlocks;
+    size_t transactions;     // injectées à des nœuds au hasard, étalées sur la durée
+    size_t blocks;
+    double blockIntervalMs;
+    uint64_t seed;
+
+    NetworkConfig()
+        : nodes(100), outboundPeers(8), minLatencyMs(10.0), maxLatencyMs(80.0), uplinkMbps(10.0), compactBlocks(true),
+          transactions(300), blocks(6), blockIntervalMs(2000.0), seed(22) {}
+};
+
+struct NetworkReport {
+    size_t nodes;
+    size_t blocks;
+    double propagation50Ms;    // moyennes sur les blocs : délai jusqu'à 50 %, 90 %, 100 % des nœuds
+    double propagation90Ms;
+    double propagationMaxMs;
+    double coverage;           // part des couples (bloc, nœud) où le bloc a été accepté
+    double blockBytesPerBlock; // octets de relais de blocs (INV, GETDATA, blocs, compléments), tout le réseau
+    double txBytes;            // octets de relais de transactions, tout le réseau
+    double arrivalToAcceptMs;  // du message de bloc reçu à l'acceptation (allers-retours compris)
+    double arrivalToAcceptP90Ms;
+    size_t compactReceived;
+    size_t roundTrips;         // blocs compacts incomplets (GETBLOCKTXN)
+    double consensus;          // part des nœuds sur le sommet majoritaire
+    double wallSeconds;
+
+    NetworkReport()
+        : nodes(0), blocks(0), propagation50Ms(0), propagation90Ms(0), propagationMaxMs(0), coverage(0),
+          blockBytesPerBlock(0), txBytes(0), arrivalToAcceptMs(0), arrivalToAcceptP90Ms(0), compactReceived(0),
+          roundTrips(0), consensus(0), wallSeconds(0) {}
+};
+
+class NetworkSimulator {
+public:
+    // 48 bits d'un mélange (splitmix64) de l'id et d'un sel tiré du hash du bloc :
+    // les collisions changent d'un bloc à l'autre
+    static uint64_t shortTxId(uint64_t txId, const Hash256& blockHash) {
+        uint64_t z = txId ^ blockHash.word(1) ^ 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return (z ^ (z >> 31)) & 0xFFFFFFFFFFFFULL;
+    }
+
+private:
+    static constexpr size_t SHORT_ID_SIZE = 6;
+
+    struct Link {
+        uint32_t peer;
+        double latencyMs;
+    };
+
+    // Bloc accepté, prêt à être servi : enregistrement complet et forme compacte
+    struct RelayBlock {
+        std::vector<uint8_t> record;
+        std::vector<uint8_t> compact;
+    };
+
+    // Bloc compact en attente des transactions absentes de la mempool
+    struct PartialBlock {
+        std::unique_ptr<Block> header;
+        std::vector<Transaction> transactions;
+        std::vector<uint32_t> missing;
+        double arrivalMs;
+        uint32_t from;
+    };
+
+    struct Orphan {
+        std::unique_ptr<Block> block;
+        double arrivalMs;
+        uint32_t from;
+    };
+
+    struct Node {
+        std::unique_ptr<Blockchain> chain;
+        std::vector<Link> links;
+        double busyUntilMs;
+        double uplinkFreeMs;
+        std::unordered_set<Hash256, Hash256Hasher> known;    // inventaire déjà vu ou demandé
+        std::unordered_set<Hash256, Hash256Hasher> accepted; // blocs validés (branche active ou non)
+        std::unordered_map<Hash256, Transaction, Hash256Hasher> relayTxs;
+        std::unordered_map<Hash256, RelayBlock, Hash256Hasher> relayBlocks;
+        std::unordered_map<Hash256, PartialBlock, Hash256Hasher> partial;
+        std::unordered_map<Hash256, std::vector<Orphan>, Hash256Hasher> orphans; // par previousHash
+
+        Node() : busyUntilMs(0), uplinkFreeMs(0) {}
+    };
+
+    enum class EventKind { Deliver, Produce, Inject };
+
+    struct Event {
+        double timeMs;
+        uint64_t sequence;
+        uint32_t node;
+        EventKind kind;
+        std::shared_ptr<const NetMessage> message;
+        size_t txIndex;
+
+        // File de priorité : le plus ancien en tête, ordre d'émission à égalité
+        bool operator<(const Event& o) const {
+            if (timeMs != o.timeMs) return timeMs > o.timeMs;
+            return sequence > o.sequence;
+        }
+    };
+
+    // Effets d'un traitement, datés une fois le temps de calcul mesuré
+    struct Outcome {
+        std::vector<std::pair<uint32_t, NetMessage> > sends;
+        std::vector<std::pair<Hash256, double> > accepted; // hash, heure d'arrivée du message de bloc
+        std::vector<Hash256> produced;
+    };
+
+    struct BlockTrace {
+        double createdMs;
+        std::vector<double> acceptMs;
+    };
+
+    NetworkConfig config;
+    std::vector<Node> nodes;
+    std::vector<Transaction> pool;
+    std::priority_queue<Event> events;
+    uint64_t nextSequence;
+    std::mt19937_64 gen;
+
+    std::unordered_map<Hash256, BlockTrace, Hash256Hasher> traces;
+    std::vector<double> arrivalToAccept;
+    size_t blockRelayBytes;
+    size_t txRelayBytes;
+    size_t compactReceived;
+    size_t roundTrips;
+
+    void schedule(double timeMs, uint32_t node, EventKind kind, std::shared_ptr<const NetMessage> message = nullptr,
+        size_t txIndex = 0) {
+        events.push(Event{ timeMs, nextSequence++, node, kind, std::move(message), txIndex });
+    }
+
+    // Départ après les envois déjà en file sur le lien montant, arrivée après la latence
+    void transmit(uint32_t from, uint32_t to, NetMessage message, double departMs) {
+        Node& sender = nodes[from];
+        const Link* link = nullptr;
+        for (const auto& l : sender.links) {
+            if (l.peer == to) link = &l;
+        }
+        if (!link) return;
+        size_t bytes = message.wireSize();
+        (message.isBlockRelay() ? blockRelayBytes : txRelayBytes) += bytes;
+        double start = std::max(departMs, sender.uplinkFreeMs);
+        sender.uplinkFreeMs = start + static_cast<double>(bytes) * 8.0 / (config.uplinkMbps * 1000.0);
+        message.from = from;
+        schedule(sender.uplinkFreeMs + link->latencyMs, to, EventKind::Deliver,
+            std::make_shared<const NetMessage>(std::move(message)));
+    }
+
+    static NetMessage inventoryMessage(NetMessageType type, InventoryKind kind, const Hash256& hash) {
+        NetMessage m;
+        m.type = type;
+        m.from = 0;
+        ByteWriter w(m.payload);
+        w.u8(static_cast<uint8_t>(kind));
+        w.hash(hash);
+        return m;
+    }
+
+    void announce(uint32_t node, InventoryKind kind, const Hash256& hash, uint32_t except, Outcome& out) {
+        for (const auto& link : nodes[node].links) {
+            if (link.peer != except) out.sends.emplace_back(link.peer, inventoryMessage(NetMessageType::Inv, kind, hash));
+        }
+    }
+
+    static RelayBlock prepareRelay(const Block& block) {
+        RelayBlock relay;
+        BlockStore::encode(block, relay.record);
+        uint32_t headerSize = 0;
+        for (int i = 0; i < 4; ++i) headerSize |= static_cast<uint32_t>(relay.record[8 + i]) << (8 * i);
+        ByteWriter w(relay.compact);
+        w.u32(headerSize);
+        w.bytes(relay.record.data(), headerSize);
+        w.u32(static_cast<uint32_t>(block.transactions.size()));
+        for (const auto& tx : block.transactions) {
+            uint8_t id[8];
+            storeLE64(id, shortTxId(tx.id, block.hash));
+            w.bytes(id, SHORT_ID_SIZE);
+        }
+        return relay;
+    }
+
+    // Ancêtre inconnu : le bloc attend son parent. Sinon validation, relais, et
+    // reprise des orphelins qui attendaient ce bloc.
+    void acceptBlock(uint32_t n, std::unique_ptr<Block> block, double arrivalMs, uint32_t from, Outcome& out) {
+        Node& node = nodes[n];
+        if (!node.accepted.count(block->previousHash)) {
+            node.orphans[block->previousHash].push_back(Orphan{ std::move(block), arrivalMs, from });
+            return;
+        }
+        Hash256 hash = block->hash;
+        RelayBlock relay = prepareRelay(*block);
+        AcceptResult result = node.chain->acceptBlock(std::move(block));
+        if (result == AcceptResult::Invalid || result == AcceptResult::Orphan) return;
+        node.accepted.insert(hash);
+        if (result == AcceptResult::Duplicate) return;
+        node.relayBlocks[hash] = std::move(relay);
+        out.accepted.emplace_back(hash, arrivalMs);
+        announce(n, InventoryKind::Block, hash, from, out);
+
+        auto waiting = node.orphans.find(hash);
+        if (waiting == node.orphans.end()) return;
+        std::vector<Orphan> children = std::move(waiting->second);
+        node.orphans.erase(waiting);
+        for (auto& child : children) acceptBlock(n, std::move(child.block), child.arrivalMs, child.from, out);
+    }
+
+    void completePartial(uint32_t n, const Hash256& hash, Outcome& out) {
+        Node& node = nodes[n];
+        auto it = node.partial.find(hash);
+        PartialBlock pending = std::move(it->second);
+        node.partial.erase(it);
+        pending.header->transactions = std::move(pending.transactions);
+        pending.header->hasBody = true;
+        acceptBlock(n, std::move(pending.header), pending.arrivalMs, pending.from, out);
+    }
+
+    void handle(uint32_t n, const NetMessage& m, double arrivalMs, Outcome& out) {
+        Node& node = nodes[n];
+        ByteReader r(m.payload.data(), m.payload.size());
+        switch (m.type) {
+        case NetMessageType::Inv: {
+            InventoryKind kind = static_cast<InventoryKind>(r.u8());
+            Hash256 hash = r.hash();
+            if (!node.known.insert(hash).second) break;
+            out.sends.emplace_back(m.from, inventoryMessage(NetMessageType::GetData, kind, hash));
+            break;
+        }
+        case NetMessageType::GetData: {
+            InventoryKind kind = static_cast<InventoryKind>(r.u8());
+            Hash256 hash = r.hash();
+            NetMessage reply;
+            reply.from = n;
+            if (kind == InventoryKind::Tx) {
+                auto tx = node.relayTxs.find(hash);
+                if (tx == node.relayTxs.end()) break;
+                reply.type = NetMessageType::Tx;
+                ByteWriter w(reply.payload);
+                tx->second.encodeSigned(w);
+            }
+            else {
+                auto block = node.relayBlocks.find(hash);
+                if (block == node.relayBlocks.end()) break;
+                reply.type = config.compactBlocks ? NetMessageType::CompactBlock : NetMessageType::Block;
+                reply.payload = config.compactBlocks ? block->second.compact : block->second.record;
+            }
+            out.sends.emplace_back(m.from, std::move(reply));
+            break;
+        }
+        case NetMessageType::Tx: {
+            Transaction tx = Transaction::decodeReceived(r);
+            Hash256 hash = tx.hash();
+            node.known.insert(hash);
+            if (!node.relayTxs.emplace(hash, tx).second) break;
+            if (node.chain->submitTransaction(tx)) announce(n, InventoryKind::Tx, hash, m.from, out);
+            break;
+        }
+        case NetMessageType::Block: {
+            std::unique_ptr<Block> block = BlockStore::decodeHeader(m.payload.data(), m.payload.size());
+            block->transactions = BlockStore::decodeTransactions(m.payload.data(), m.payload.size(), true);
+            block->hasBody = true;
+            acceptBlock(n, std::move(block), arrivalMs, m.from, out);
+            break;
+        }
+        case NetMessageType::CompactBlock: {
+            ++compactReceived;
+            uint32_t headerSize = r.u32();
+            PartialBlock pending;
+            pending.header = BlockStore::decodeHeader(r.bytes(headerSize), headerSize);
+            pending.arrivalMs = arrivalMs;
+            pending.from = m.from;
+            const Hash256 hash = pending.header->hash;
+            uint32_t count = r.u32();
+            if (count > r.remaining() / SHORT_ID_SIZE) throw std::runtime_error("Réseau : bloc compact tronqué");
+
+            // Identifiants courts de la mempool ; une collision rend l'identifiant ambigu
+            std::unordered_map<uint64_t, Transaction> byShortId;
+            std::unordered_set<uint64_t> ambiguous;
+            for (const auto& tx : node.chain->getMempool().pendingTransactions()) {
+                uint64_t id = shortTxId(tx.id, hash);
+                if (!byShortId.emplace(id, tx).second) ambiguous.insert(id);
+            }
+            pending.transactions.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                uint8_t bytes[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+                std::memcpy(bytes, r.bytes(SHORT_ID_SIZE), SHORT_ID_SIZE);
+                uint64_t id = loadLE64(bytes);
+                auto found = byShortId.find(id);
+                if (found == byShortId.end() || ambiguous.count(id)) pending.missing.push_back(i);
+                else pending.transactions[i] = found->second;
+            }
+            if (pending.missing.empty()) {
+                node.partial[hash] = std::move(pending);
+                completePartial(n, hash, out);
+                break;
+            }
+            ++roundTrips;
+            NetMessage request;
+            request.type = NetMessageType::GetBlockTxn;
+            request.from = n;
+            ByteWriter w(request.payload);
+            w.hash(hash);
+            w.u32(static_cast<uint32_t>(pending.missing.size()));
+            for (uint32_t i : pending.missing) w.u32(i);
+            node.partial[hash] = std::move(pending);
+            out.sends.emplace_back(m.from, std::move(request));
+            break;
+        }
+        case NetMessageType::GetBlockTxn: {
+            Hash256 hash = r.hash();
+            auto block = node.relayBlocks.find(hash);
+            if (block == node.relayBlocks.end()) break;
+            std::vector<Transaction> txs = BlockStore::decodeTransactions(block->second.record.data(),
+                block->second.record.size());
+            uint32_t count = r.u32();
+            NetMessage reply;
+            reply.type = NetMessageType::BlockTxn;
+            reply.from = n;
+            ByteWriter w(reply.payload);
+            w.hash(hash);
+            w.u32(count);
+            for (uint32_t i = 0; i < count; ++i) txs.at(r.u32()).encodeSigned(w);
+            out.sends.emplace_back(m.from, std::move(reply));
+            break;
+        }
+        case NetMessageType::BlockTxn: {
+            Hash256 hash = r.hash();
+            auto it = node.partial.find(hash);
+            if (it == node.partial.end()) break;
+            uint32_t count = r.u32();
+            if (count != it->second.missing.size()) break;
+            for (uint32_t i = 0; i < count; ++i) it->second.transactions[it->second.missing[i]] = Transaction::decodeReceived(r);
+            completePartial(n, hash, out);
+            break;
+        }
+        }
+    }
+
+    void produce(uint32_t n, Outcome& out) {
+        Node& node = nodes[n];
+        node.chain->addBlockPoW();
+        const Block& block = node.chain->getBlock(node.chain->size() - 1);
+        node.known.insert(block.hash);
+        node.accepted.insert(block.hash);
+        node.relayBlocks[block.hash] = prepareRelay(block);
+        out.produced.push_back(block.hash);
+        announce(n, InventoryKind::Block, block.hash, UINT32_MAX, out);
+    }
+
+    void inject(uint32_t n, size_t txIndex, Outcome& out) {
+        Node& node = nodes[n];
+        const Transaction& tx = pool[txIndex];
+        Hash256 hash = tx.hash();
+        node.known.insert(hash);
+        node.relayTxs.emplace(hash, tx);
+        if (node.chain->submitTransaction(tx)) announce(n, InventoryKind::Tx, hash, UINT32_MAX, out);
+    }
+
+    // Un nœud traite ses événements l'un après l'autre : début au plus tôt à
+    // l'arrivée, au plus tard quand le traitement précédent est fini
+    void dispatch(const Event& e) {
+        Node& node = nodes[e.node];
+        double start = std::max(e.timeMs, node.busyUntilMs);
+        Outcome out;
+        auto t0 = std::chrono::steady_clock::now();
+        switch (e.kind) {
+        case EventKind::Deliver:
+            // Message malformé ou émetteur inconnu : ignoré
+            try { handle(e.node, *e.message, e.timeMs, out); }
+            catch (const std::exception&) {}
+            break;
+        case EventKind::Produce: produce(e.node, out); break;
+        case EventKind::Inject: inject(e.node, e.txIndex, out); break;
+        }
+        double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        node.busyUntilMs = start + cpuMs;
+
+        for (const auto& hash : out.produced) traces[hash].createdMs = node.busyUntilMs;
+        for (const auto& accepted : out.accepted) {
+            auto trace = traces.find(accepted.first);
+            if (trace == traces.end()) continue;
+            trace->second.acceptMs.push_back(node.busyUntilMs - trace->second.createdMs);
+            arrivalToAccept.push_back(node.busyUntilMs - accepted.second);
+        }
+        for (auto& send : out.sends) transmit(e.node, send.first, std::move(send.second), node.busyUntilMs);
+    }
+
+    static double percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(values.size())));
+        return values[rank > 0 ? rank - 1 : 0];
+    }
+
+public:
+    explicit NetworkSimulator(const NetworkConfig& cfg)
+        : config(cfg), nextSequence(0), gen(cfg.seed), blockRelayBytes(0), txRelayBytes(0), compactReceived(0),
+          roundTrips(0) {
+        if (config.nodes < 2) throw std::invalid_argument("NetworkSimulator : au moins deux nœuds");
+        std::vector<std::string> accounts;
+        for (int a = 0; a < 64; ++a) accounts.push_back("Pair_" + std::to_string(a));
+        for (size_t t = 0; t < config.transactions; ++t) {
+            size_t from = gen() % accounts.size();
+            size_t to = (from + 1 + gen() % (accounts.size() - 1)) % accounts.size();
+            pool.emplace_back(accounts[from], accounts[to], 0.000001 * static_cast<double>(1 + gen() % 1000000),
+                0.000001 * static_cast<double>(gen() % 10000));
+        }
+        std::unordered_map<AccountId, uint64_t> nonces;
+        assignNonces(pool, nonces);
+        signWithDemoKeys(pool);
+
+        // Nœuds d'un seul thread (minage et validation) : des centaines tiennent sur une machine
+        QuietOutput quiet;
+        Block genesis(0, Hash256(), std::vector<Transaction>());
+        nodes.resize(config.nodes);
+        for (auto& node : nodes) {
+            node.chain.reset(new Blockchain(1, 1, 1));
+            node.chain->setGenesis(genesis);
+            for (const auto& a : accounts) node.chain->credit(a, toAmount(1e6));
+            node.accepted.insert(genesis.hash);
+            node.known.insert(genesis.hash);
+        }
+        std::uniform_real_distribution<double> latency(config.minLatencyMs, config.maxLatencyMs);
+        for (uint32_t a = 0; a < nodes.size(); ++a) {
+            size_t wanted = std::min(config.outboundPeers, nodes.size() - 1);
+            for (size_t attempts = 0; wanted > 0 && attempts < 64 * config.outboundPeers; ++attempts) {
+                uint32_t b = static_cast<uint32_t>(gen() % nodes.size());
+                bool linked = b == a;
+                for (const auto& l : nodes[a].links) linked = linked || l.peer == b;
+                if (linked) continue;
+                double ms = latency(gen);
+                nodes[a].links.push_back(Link{ b, ms });
+                nodes[b].links.push_back(Link{ a, ms });
+                --wanted;
+            }
+        }
+    }
+
+    NetworkReport run() {
+        auto wallStart = std::chrono::steady_clock::now();
+        double spanMs = config.blockIntervalMs * static_cast<double>(config.blocks);
+        std::uniform_real_distribution<double> when(0.0, spanMs);
+        for (size_t t = 0; t < pool.size(); ++t) {
+            schedule(when(gen), static_cast<uint32_t>(gen() % nodes.size()), EventKind::Inject, nullptr, t);
+        }
+        for (size_t b = 1; b <= config.blocks; ++b) {
+            schedule(config.blockIntervalMs * static_cast<double>(b), static_cast<uint32_t>(gen() % nodes.size()),
+                EventKind::Produce);
+        }
+        {
+            QuietOutput quiet;
+            while (!events.empty()) {
+                Event e = events.top();
+                events.pop();
+                dispatch(e);
+            }
+        }
+
+        NetworkReport report;
+        report.nodes = nodes.size();
+        report.blocks = traces.size();
+        size_t accepted = 0;
+        for (const auto& trace : traces) {
+            const std::vector<double>& ms = trace.second.acceptMs;
+            accepted += ms.size() + 1; // + le producteur
+            report.propagation50Ms += percentile(ms, 0.5);
+            report.propagation90Ms += percentile(ms, 0.9);
+            report.propagationMaxMs += percentile(ms, 1.0);
+        }
+        if (!traces.empty()) {
+            double blocks = static_cast<double>(traces.size());
+            report.propagation50Ms /= blocks;
+            report.propagation90Ms /= blocks;
+            report.propagationMaxMs /= blocks;
+            report.coverage = static_cast<double>(accepted) / (blocks * static_cast<double>(nodes.size()));
+            report.blockBytesPerBlock = static_cast<double>(blockRelayBytes) / blocks;
+        }
+        report.txBytes = static_cast<double>(txRelayBytes);
+        report.arrivalToAcceptMs = arrivalToAccept.empty() ? 0.0
+            : std::accumulate(arrivalToAccept.begin(), arrivalToAccept.end(), 0.0) / static_cast<double>(arrivalToAccept.size());
+        report.arrivalToAcceptP90Ms = percentile(arrivalToAccept, 0.9);
+        report.compactReceived = compactReceived;
+        report.roundTrips = roundTrips;
+
+        std::unordered_map<Hash256, size_t, Hash256Hasher> tips;
+        size_t majority = 0;
+        for (const auto& node : nodes) {
+            const ChainIndex& index = node.chain->getIndex();
+            majority = std::max(majority, ++tips[index.hash(index.size() - 1)]);
+        }
+        report.consensus = static_cast<double>(majority) / static_cast<double>(nodes.size());
+        report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        return report;
+    }
+};
+
+void printNetworkReport(const NetworkReport& r, bool compact) {
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "   " << std::setw(4) << r.nodes << " nœuds, " << (compact ? "compacts" : "complets") << " : propagation 50% "
+        << r.propagation50Ms << " ms, 90% " << r.propagation90Ms << " ms, 100% " << r.propagationMaxMs << " ms (couverture "
+        << r.coverage * 100.0 << " %)\n";
+    std::cout << "        relais " << r.blockBytesPerBlock / 1024.0 << " Ko/bloc ("
+        << r.blockBytesPerBlock / static_cast<double>(r.nodes) << " o/bloc/nœud), transactions "
+        << r.txBytes / (1024.0 * 1024.0) << " Mo | arrivée -> acceptation " << std::setprecision(2) << r.arrivalToAcceptMs
+        << " ms (p90 " << r.arrivalToAcceptP90Ms << " ms)";
+    if (compact) std::cout << " | allers-retours " << r.roundTrips << "/" << r.compactReceived;
+    std::cout << " | consensus " << std::setprecision(0) << r.consensus * 100.0 << " % | " << std::setprecision(2)
+        << r.wallSeconds << " s\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Même réseau (même graine) avec relais de blocs compacts puis complets
+void runNetworkSimulation(size_t nodeCount) {
+    for (int compact = 1; compact >= 0; --compact) {
+        NetworkConfig config;
+        config.nodes = nodeCount;
+        config.compactBlocks = compact != 0;
+        NetworkSimulator simulator(config);
+        printNetworkReport(simulator.run(), config.compactBlocks);
+    }
+}
+
+// ==================================================
+// SERVEUR RPC (EPOLL)
+// ==================================================
+// Protocole binaire : trames préfixées par leur longueur (u32, sans compter ces
+// 4 octets). Requête : méthode (u8), id (u32), paramètres ; réponse : statut
+// (u8), id (u32), contenu. Une connexion dont le premier octet est '{' parle
+// JSON : un objet par ligne, une ligne de réponse par requête.
+//
+// Méthode           paramètres                contenu de la réponse
+// SubmitTransaction transaction signée        hash de la transaction
+// BlockByHeight     hauteur (u64)             enregistrement du BlockStore
+// BlockByHash       hash                      enregistrement du BlockStore
+// Proof             hauteur (u64), index (u32) racine, feuille, index (u64), frères (u32 + hashes)
+// Tip               -                         hauteur (u64), hash, travail (bits du double), mempool (u64)
+#ifndef _WIN32
+enum class RpcMethod : uint8_t { SubmitTransaction = 1, BlockByHeight, BlockByHash, Proof, Tip };
+enum class RpcStatus : uint8_t { Ok, NotFound, Rejected, BadRequest };
+
+inline const char* rpcStatusName(RpcStatus s) {
+    switch (s) {
+    case RpcStatus::Ok: return "ok";
+    case RpcStatus::NotFound: return "not_found";
+    case RpcStatus::Rejected: return "rejected";
+    default: return "bad_request";
+    }
+}
+
+// Décode une chaîne hexadécimale de longueur paire ; false sinon
+bool hexToBytes(std::string_view hex, std::vector<uint8_t>& out) {
+    if (hex.size() % 2 != 0) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    out.resize(hex.size() / 2);
+    for (size_t i = 0; i < out.size(); ++i) {
+        int hi = nibble(hex[2 * i]), lo = nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = uint8_t((hi << 4) | lo);
+    }
+    return true;
+}
+
+// Valeur brute d'un champ de premier niveau d'un objet JSON plat : chaîne sans
+// guillemets ni échappements, ou nombre. Suffit aux requêtes du serveur.
+bool jsonField(std::string_view json, std::string_view key, std::string_view& value) {
+    std::string quoted = "\"" + std::string(key) + "\"";
+    size_t pos = json.find(quoted);
+    if (pos == std::string_view::npos) return false;
+    pos += quoted.size();
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == ':' || json[pos] == '\t')) ++pos;
+    if (pos >= json.size()) return false;
+    if (json[pos] == '"') {
+        size_t end = json.find('"', pos + 1);
+        if (end == std::string_view::npos) return false;
+        value = json.substr(pos + 1, end - pos - 1);
+        return true;
+    }
+    size_t end = json.find_first_of(",} \t\r\n", pos);
+    value = json.substr(pos, (end == std::string_view::npos ? json.size() : end) - pos);
+    return !value.empty();
+}
+
+struct RpcRequest {
+    RpcMethod method;
+    uint32_t id;
+    uint64_t height;
+    Hash256 hash;
+    uint32_t txIndex;
+    Transaction transaction;
+
+    RpcRequest() : method(RpcMethod::Tip), id(0), height(0), txIndex(0) {}
+
+    // Trame complète, préfixe de longueur compris
+    void encode(std::vector<uint8_t>& out) const {
+        size_t start = out.size();
+        ByteWriter w(out);
+        w.u32(0);
+        w.u8(static_cast<uint8_t>(method));
+        w.u32(id);
+        switch (method) {
+        case RpcMethod::SubmitTransaction: transaction.encodeSigned(w); break;
+        case RpcMethod::BlockByHeight: w.u64(height); break;
+        case RpcMethod::BlockByHash: w.hash(hash); break;
+        case RpcMethod::Proof: w.u64(height); w.u32(txIndex); break;
+        case RpcMethod::Tip: break;
+        }
+        uint32_t length = static_cast<uint32_t>(out.size() - start - 4);
+        for (int i = 0; i < 4; ++i) out[start + i] = uint8_t(length >> (8 * i));
+    }
+
+    // Corps d'une trame (après le préfixe de longueur) ; lève une exception si malformé
+    static RpcRequest decode(const uint8_t* data, size_t size) {
+        ByteReader r(data, size);
+        RpcRequest request;
+        uint8_t method = r.u8();
+        if (method < static_cast<uint8_t>(RpcMethod::SubmitTransaction) || method > static_cast<uint8_t>(RpcMethod::Tip)) {
+            throw std::runtime_error("RpcRequest : méthode inconnue");
+        }
+        request.method = static_cast<RpcMethod>(method);
+        request.id = r.u32();
+        switch (request.method) {
+        case RpcMethod::SubmitTransaction: request.transaction = Transaction::decodeReceived(r); break;
+        case RpcMethod::BlockByHeight: request.height = r.u64(); break;
+        case RpcMethod::BlockByHash: request.hash = r.hash(); break;
+        case RpcMethod::Proof: request.height = r.u64(); request.txIndex = r.u32(); break;
+        case RpcMethod::Tip: break;
+        }
+        return request;
+    }
+
+    // {"id": 7, "method": "tip" | "block" | "proof" | "submit", "height": .., "hash": "..", "index": .., "tx": "hex"}
+    static RpcRequest fromJson(std::string_view line) {
+        RpcRequest request;
+        std::string_view method, value;
+        if (!jsonField(line, "method", method)) throw std::runtime_error("RpcRequest : méthode absente");
+        if (jsonField(line, "id", value)) request.id = static_cast<uint32_t>(std::stoul(std::string(value)));
+        if (method == "tip") {
+            request.method = RpcMethod::Tip;
+        }
+        else if (method == "block" && jsonField(line, "hash", value)) {
+            request.method = RpcMethod::BlockByHash;
+            if (!Hash256::fromHex(std::string(value), request.hash)) throw std::runtime_error("RpcRequest : hash invalide");
+        }
+        else if ((method == "block" || method == "proof") && jsonField(line, "height", value)) {
+            request.method = method == "block" ? RpcMethod::BlockByHeight : RpcMethod::Proof;
+            request.height = std::stoull(std::string(value));
+            if (request.method == RpcMethod::Proof) {
+                if (!jsonField(line, "index", value)) throw std::runtime_error("RpcRequest : index absent");
+                request.txIndex = static_cast<uint32_t>(std::stoul(std::string(value)));
+            }
+        }
+        else if (method == "submit" && jsonField(line, "tx", value)) {
+            request.method = RpcMethod::SubmitTransaction;
+            std::vector<uint8_t> bytes;
+            if (!hexToBytes(value, bytes)) throw std::runtime_error("RpcRequest : transaction invalide");
+            ByteReader r(bytes.data(), bytes.size());
+            request.transaction = Transaction::decodeReceived(r);
+        }
+        else {
+            throw std::runtime_error("RpcRequest : requête inconnue");
+        }
+        return request;
+    }
+};
+
+struct RpcResult {
+    RpcStatus status;
+    ChainTip tip;
+    std::shared_ptr<const std::vector<uint8_t> > record; // partagé avec le cache, jamais recopié
+    Hash256 merkleRoot;
+    Hash256 leaf;
+    MerkleProof proof;
+    Hash256 txHash;
+
+    RpcResult() : status(RpcStatus::Ok), tip() {}
+};
+
+class RpcServer {
+public:
+    static constexpr uint32_t MAX_FRAME = 1u << 20;      // requête la plus longue acceptée
+    static constexpr size_t OUTPUT_HIGH_WATER = 8u << 20; // au-delà, la connexion n'est plus lue
+
+private:
+    // Morceau de sortie : petites réponses regroupées dans 'bytes', ou corps de
+    // bloc partagé avec le cache (envoyé tel quel par sendmsg)
+    struct OutChunk {
+        std::vector<uint8_t> bytes;
+        std::shared_ptr<const std::vector<uint8_t> > body;
+
+        const uint8_t* data() const { return body ? body->data() : bytes.data(); }
+        size_t size() const { return body ? body->size() : bytes.size(); }
+    };
+
+    enum class Protocol { Unknown, Binary, Json };
+
+    struct Connection {
+        int fd;
+        Protocol protocol;
+        std::vector<uint8_t> in;
+        std::deque<OutChunk> out;
+        size_t sentInFront;
+        size_t pendingBytes;
+        uint32_t events;
+
+        explicit Connection(int f) : fd(f), protocol(Protocol::Unknown), sentInFront(0), pendingBytes(0), events(0) {}
+    };
+
+    struct Loop {
+        int epoll;
+        int wake;
+        std::thread thread;
+        std::unordered_map<Connection*, std::unique_ptr<Connection> > connections;
+
+        Loop() : epoll(-1), wake(-1) {}
+    };
+
+    Blockchain& chain;
+    int listenFd;
+    uint16_t boundPort;
+    std::vector<std::unique_ptr<Loop> > loops;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> served;
+
+    // Blocs encodés par hash : un bloc n'est encodé (ou lu) qu'une fois, puis
+    // partagé par toutes les réponses qui le citent ; son arbre de Merkle est
+    // construit à la première preuve demandée
+    struct CachedBlock {
+        std::shared_ptr<const std::vector<uint8_t> > record;
+        std::shared_ptr<const MerkleTree> tree;
+    };
+    std::mutex cacheMutex;
+    std::unordered_map<Hash256, CachedBlock, Hash256Hasher> blocks;
+    size_t cacheCapacity;
+
+    static void check(bool ok, const char* what) {
+        if (!ok) throw std::runtime_error(std::string("RpcServer : ") + what + " (" + std::strerror(errno) + ")");
+    }
+
+    // Le cache est indexé par hash et survit aux réorganisations : un bloc n'y
+    // est servi que s'il est encore sur la branche active
+    CachedBlock cachedBlock(const Hash256& hash) {
+        bool active = chain.findHeight(hash) != ChainIndex::npos;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            auto it = blocks.find(hash);
+            if (it != blocks.end()) {
+                if (active) return it->second;
+                blocks.erase(it);
+                return CachedBlock();
+            }
+        }
+        if (!active) return CachedBlock();
+        auto record = std::make_shared<std::vector<uint8_t> >();
+        if (!chain.readBlockRecord(hash, *record)) return CachedBlock();
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (blocks.size() >= cacheCapacity) blocks.clear();
+        CachedBlock& entry = blocks[hash];
+        if (!entry.record) entry.record = std::move(record);
+        return entry;
+    }
+
+    std::shared_ptr<const MerkleTree> merkleTree(const Hash256& hash, const CachedBlock& block) {
+        if (block.tree) return block.tree;
+        auto tree = std::make_shared<const MerkleTree>(
+            BlockStore::decodeTransactions(block.record->data(), block.record->size()));
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = blocks.find(hash);
+        if (it != blocks.end() && !it->second.tree) it->second.tree = tree;
+        return tree;
+    }
+
+    RpcResult execute(const RpcRequest& request) {
+        RpcResult result;
+        Hash256 hash = request.hash;
+        switch (request.method) {
+        case RpcMethod::SubmitTransaction:
+            result.txHash = request.transaction.hash();
+            result.status = chain.submitTransaction(request.transaction) ? RpcStatus::Ok : RpcStatus::Rejected;
+            break;
+        case RpcMethod::Tip:
+            result.tip = chain.getTip();
+            break;
+        case RpcMethod::BlockByHeight:
+        case RpcMethod::Proof:
+            if (!chain.blockHashAt(request.height, hash)) {
+                result.status = RpcStatus::NotFound;
+                break;
+            }
+            // fallthrough
+        case RpcMethod::BlockByHash: {
+            CachedBlock block = cachedBlock(hash);
+            if (!block.record) {
+                result.status = RpcStatus::NotFound;
+                break;
+            }
+            if (request.method != RpcMethod::Proof) {
+                result.record = block.record;
+                break;
+            }
+            std::shared_ptr<const MerkleTree> tree = merkleTree(hash, block);
+            if (request.txIndex >= tree->leafCount()) {
+                result.status = RpcStatus::NotFound;
+                break;
+            }
+            result.merkleRoot = tree->getRootHash();
+            result.leaf = tree->leaf(request.txIndex);
+            result.proof = tree->getProof(request.txIndex);
+            break;
+        }
+        }
+        return result;
+    }
+
+    static OutChunk& smallChunk(Connection& c) {
+        if (c.out.empty() || c.out.back().body) c.out.emplace_back();
+        return c.out.back();
+    }
+
+    void queueBinary(Connection& c, uint32_t id, const RpcRequest* request, const RpcResult& result) {
+        OutChunk& chunk = smallChunk(c);
+        size_t start = chunk.bytes.size();
+        ByteWriter w(chunk.bytes);
+        w.u32(0);
+        w.u8(static_cast<uint8_t>(result.status));
+        w.u32(id);
+        size_t bodySize = 0;
+        if (result.status == RpcStatus::Ok || result.status == RpcStatus::Rejected) {
+            switch (request->method) {
+            case RpcMethod::SubmitTransaction:
+                w.hash(result.txHash);
+                break;
+            case RpcMethod::Tip: {
+                uint64_t work;
+                std::memcpy(&work, &result.tip.work, sizeof(work));
+                w.u64(result.tip.height);
+                w.hash(result.tip.hash);
+                w.u64(work);
+                w.u64(result.tip.mempoolSize);
+                break;
+            }
+            case RpcMethod::Proof:
+                w.hash(result.merkleRoot);
+                w.hash(result.leaf);
+                w.u64(result.proof.index);
+                w.u32(static_cast<uint32_t>(result.proof.siblings.size()));
+                for (const auto& sibling : result.proof.siblings) w.hash(sibling);
+                break;
+            default:
+                bodySize = result.record->size();
+            }
+        }
+        uint32_t length = static_cast<uint32_t>(chunk.bytes.size() - start - 4 + bodySize);
+        for (int i = 0; i < 4; ++i) chunk.bytes[start + i] = uint8_t(length >> (8 * i));
+        c.pendingBytes += chunk.bytes.size() - start;
+        if (bodySize > 0) {
+            c.out.emplace_back();
+            c.out.back().body = result.record;
+            c.pendingBytes += bodySize;
+        }
+    }
+
+    void queueJson(Connection& c, uint32_t id, const RpcRequest* request, const RpcResult& result) {
+        std::ostringstream oss;
+        oss << "{\"id\": " << id << ", \"status\": \"" << rpcStatusName(result.status) << "\"";
+        if (result.status == RpcStatus::Ok || result.status == RpcStatus::Rejected) {
+            switch (request->method) {
+            case RpcMethod::SubmitTransaction:
+                oss << ", \"hash\": \"" << result.txHash << "\"";
+                break;
+            case RpcMethod::Tip:
+                oss << ", \"height\": " << result.tip.height << ", \"hash\": \"" << result.tip.hash << "\", \"work\": "
+                    << result.tip.work << ", \"mempool\": " << result.tip.mempoolSize;
+                break;
+            case RpcMethod::Proof:
+                oss << ", \"merkle_root\": \"" << result.merkleRoot << "\", \"leaf\": \"" << result.leaf
+                    << "\", \"index\": " << result.proof.index << ", \"siblings\": [";
+                for (size_t i = 0; i < result.proof.siblings.size(); ++i) {
+                    oss << (i == 0 ? "\"" : ", \"") << result.proof.siblings[i] << "\"";
+                }
+                oss << "]";
+                break;
+            default: {
+                const std::vector<uint8_t>& record = *result.record;
+                std::unique_ptr<Block> header = BlockStore::decodeHeader(record.data(), record.size());
+                oss << ", \"height\": " << header->index << ", \"hash\": \"" << header->hash << "\", \"previous\": \""
+                    << header->previousHash << "\", \"merkle_root\": \"" << header->merkleRoot << "\", \"timestamp\": \""
+                    << header->timestamp << "\", \"consensus\": \"" << header->getConsensusInfo()
+                    << "\", \"transactions\": " << BlockStore::decodeTransactions(record.data(), record.size()).size()
+                    << ", \"bytes\": " << record.size();
+            }
+            }
+        }
+        oss << "}\n";
+        std::string text = oss.str();
+        OutChunk& chunk = smallChunk(c);
+        chunk.bytes.insert(chunk.bytes.end(), text.begin(), text.end());
+        c.pendingBytes += text.size();
+    }
+
+    // Requêtes complètes du tampon d'entrée ; false si la connexion doit être fermée
+    bool processInput(Connection& c) {
+        size_t consumed = 0;
+        if (c.protocol == Protocol::Unknown && !c.in.empty()) c.protocol = c.in[0] == '{' ? Protocol::Json : Protocol::Binary;
+        while (c.pendingBytes < OUTPUT_HIGH_WATER) {
+            const uint8_t* data = c.in.data() + consumed;
+            size_t available = c.in.size() - consumed;
+            if (c.protocol == Protocol::Binary) {
+                if (available < 4) break;
+                uint32_t length = static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                    static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+                if (length < 5 || length > MAX_FRAME) return false;
+                if (available < 4 + static_cast<size_t>(length)) break;
+                consumed += 4 + length;
+                RpcRequest request;
+                try {
+                    request = RpcRequest::decode(data + 4, length);
+                }
+                catch (const std::exception&) {
+                    RpcResult bad;
+                    bad.status = RpcStatus::BadRequest;
+                    queueBinary(c, loadLE32(data + 5), nullptr, bad);
+                    continue;
+                }
+                queueBinary(c, request.id, &request, execute(request));
+            }
+            else {
+                const uint8_t* newline = static_cast<const uint8_t*>(std::memchr(data, '\n', available));
+                if (!newline) {
+                    if (available > MAX_FRAME) return false;
+                    break;
+                }
+                std::string_view line(reinterpret_cast<const char*>(data), static_cast<size_t>(newline - data));
+                consumed += line.size() + 1;
+                if (line.find_first_not_of(" \t\r") == std::string_view::npos) continue;
+                RpcRequest request;
+                try {
+                    request = RpcRequest::fromJson(line);
+                }
+                catch (const std::exception&) {
+                    RpcResult bad;
+                    bad.status = RpcStatus::BadRequest;
+                    queueJson(c, 0, nullptr, bad);
+                    continue;
+                }
+                queueJson(c, request.id, &request, execute(request));
+            }
+            served.fetch_add(1, std::memory_order_relaxed);
+        }
+        c.in.erase(c.in.begin(), c.in.begin() + static_cast<std::ptrdiff_t>(consumed));
+        return true;
+    }
+
+    static uint32_t loadLE32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+            static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    // Envoie ce qui peut l'être sans bloquer, jusqu'à 64 morceaux par appel système
+    bool flush(Connection& c) {
+        while (!c.out.empty()) {
+            iovec iov[64];
+            size_t n = 0;
+            for (auto it = c.out.begin(); it != c.out.end() && n < 64; ++it, ++n) {
+                size_t skip = n == 0 ? c.sentInFront : 0;
+                iov[n].iov_base = const_cast<uint8_t*>(it->data() + skip);
+                iov[n].iov_len = it->size() - skip;
+            }
+            msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = n;
+            ssize_t sent = ::sendmsg(c.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            size_t left = static_cast<size_t>(sent);
+            c.pendingBytes -= left;
+            while (left > 0) {
+                size_t rest = c.out.front().size() - c.sentInFront;
+                if (left < rest) {
+                    c.sentInFront += left;
+                    break;
+                }
+                left -= rest;
+                c.sentInFront = 0;
+                c.out.pop_front();
+            }
+        }
+        return true;
+    }
+
+    // Lecture suspendue tant que le client ne lit pas ses réponses ; écriture
+    // surveillée seulement s'il reste des octets à envoyer
+    void updateInterest(Loop& loop, Connection& c) {
+        uint32_t wanted = (c.pendingBytes < OUTPUT_HIGH_WATER ? EPOLLIN : 0u) | (c.out.empty() ? 0u : EPOLLOUT);
+        if (wanted == c.events) return;
+        epoll_event ev;
+        ev.events = wanted;
+        ev.data.ptr = &c;
+        ::epoll_ctl(loop.epoll, EPOLL_CTL_MOD, c.fd, &ev);
+        c.events = wanted;
+    }
+
+    void close(Loop& loop, Connection& c) {
+        ::epoll_ctl(loop.epoll, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        loop.connections.erase(&c);
+    }
+
+    void acceptAll(Loop& loop) {
+        for (;;) {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN : un autre thread a pris la connexion, ou plus rien
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::unique_ptr<Connection> c(new Connection(fd));
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = c.get();
+            c->events = EPOLLIN;
+            if (::epoll_ctl(loop.epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                ::close(fd);
+                continue;
+            }
+            Connection* key = c.get();
+            loop.connections.emplace(key, std::move(c));
+        }
+    }
+
+    void serve(Loop& loop) {
+        epoll_event events[128];
+        uint8_t buffer[64 * 1024];
+        while (!stopping.load(std::memory_order_acquire)) {
+            int n = ::epoll_wait(loop.epoll, events, 128, -1);
+            for (int i = 0; i < n; ++i) {
+                void* tag = events[i].data.ptr;
+                if (tag == nullptr) {
+                    acceptAll(loop);
+                    continue;
+                }
+                if (tag == &loop) continue; // réveil pour l'arrêt
+                Connection& c = *static_cast<Connection*>(tag);
+                bool closed = false;
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    ssize_t got = ::recv(c.fd, buffer, sizeof(buffer), 0);
+                    if (got > 0) c.in.insert(c.in.end(), buffer, buffer + got);
+                    else closed = got == 0 || (errno != EAGAIN && errno != EINTR);
+                }
+                // Les requêtes arrivées avant la fermeture reçoivent encore leur réponse
+                bool alive = processInput(c) && flush(c) && !closed;
+                if (!alive) {
+                    close(loop, c);
+                    continue;
+                }
+                updateInterest(loop, c);
+            }
+        }
+    }
+
+public:
+    // threads : boucles d'événements (0 = une par cœur) ; port 0 = port libre choisi par le système
+    RpcServer(Blockchain& blockchain, uint16_t port, unsigned threads = 0, size_t cachedBlocks = 4096)
+        : chain(blockchain), listenFd(-1), boundPort(0), stopping(false), served(0), cacheCapacity(cachedBlocks) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        check(listenFd >= 0, "socket");
+        int one = 1;
+        ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listenFd, 1024) != 0) {
+            int saved = errno;
+            ::close(listenFd);
+            errno = saved;
+            check(false, "bind/listen");
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len);
+        boundPort = ntohs(addr.sin_port);
+
+        // Chaque boucle surveille le socket d'écoute ; EPOLLEXCLUSIVE n'en réveille qu'une
+        for (unsigned t = 0; t < threads; ++t) {
+            std::unique_ptr<Loop> loop(new Loop());
+            loop->epoll = ::epoll_create1(EPOLL_CLOEXEC);
+            loop->wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            epoll_event ev;
+            ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+            ev.data.ptr = nullptr;
+            ::epoll_ctl(loop->epoll, EPOLL_CTL_ADD, listenFd, &ev);
+            ev.events = EPOLLIN;
+            ev.data.ptr = loop.get();
+            ::epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->wake, &ev);
+            loops.push_back(std::move(loop));
+        }
+        for (auto& loop : loops) {
+            Loop* l = loop.get();
+            loop->thread = std::thread([this, l] { serve(*l); });
+        }
+    }
+
+    ~RpcServer() {
+        stop();
+    }
+
+    RpcServer(const RpcServer&) = delete;
+    RpcServer& operator=(const RpcServer&) = delete;
+
+    uint16_t port() const { return boundPort; }
+    uint64_t requestsServed() const { return served.load(std::memory_order_relaxed); }
+
+    void stop() {
+        if (stopping.exchange(true)) return;
+        for (auto& loop : loops) {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(loop->wake, &one, sizeof(one));
+            (void)ignored;
+        }
+        for (auto& loop : loops) {
+            loop->thread.join();
+            for (auto& c : loop->connections) ::close(c.second->fd);
+            loop->connections.clear();
+            ::close(loop->wake);
+            ::close(loop->epoll);
+        }
+        ::close(listenFd);
+    }
+};
+
+// Client bloquant du protocole binaire (générateur de charge, auto-test)
+class RpcClient {
+private:
+    int fd;
+    std::vector<uint8_t> in;
+    size_t consumed;
+
+public:
+    struct Response {
+        RpcStatus status;
+        uint32_t id;
+        std::vector<uint8_t> payload;
+    };
+
+    explicit RpcClient(uint16_t port) : fd(-1), consumed(0) {
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) throw std::runtime_error("RpcClient : socket");
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("RpcClient : connexion impossible au port " + std::to_string(port));
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    ~RpcClient() { ::close(fd); }
+
+    RpcClient(const RpcClient&) = delete;
+    RpcClient& operator=(const RpcClient&) = delete;
+
+    // Octets bruts (trames déjà encodées, ou lignes JSON)
+    void sendRaw(const uint8_t* data, size_t size) {
+        while (size > 0) {
+            ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (sent <= 0) throw std::runtime_error("RpcClient : envoi interrompu");
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+    }
+
+    void send(const RpcRequest& request) {
+        std::vector<uint8_t> frame;
+        request.encode(frame);
+        sendRaw(frame.data(), frame.size());
+    }
+
+    // false si le serveur a fermé la connexion
+    bool fill() {
+        if (consumed > 0 && consumed == in.size()) {
+            in.clear();
+            consumed = 0;
+        }
+        uint8_t buffer[64 * 1024];
+        ssize_t got = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (got <= 0) return false;
+        in.insert(in.end(), buffer, buffer + got);
+        return true;
+    }
+
+    bool receive(Response& response) {
+        for (;;) {
+            size_t available = in.size() - consumed;
+            if (available >= 4) {
+                const uint8_t* p = in.data() + consumed;
+                uint32_t length = static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                    static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+                if (available >= 4 + static_cast<size_t>(length)) {
+                    ByteReader r(p + 4, length);
+                    response.status = static_cast<RpcStatus>(r.u8());
+                    response.id = r.u32();
+                    response.payload.assign(r.position(), r.position() + r.remaining());
+                    consumed += 4 + length;
+                    return true;
+                }
+            }
+            if (!fill()) return false;
+        }
+    }
+
+    bool receiveLine(std::string& line) {
+        for (;;) {
+            auto begin = in.begin() + static_cast<std::ptrdiff_t>(consumed);
+            auto newline = std::find(begin, in.end(), static_cast<uint8_t>('\n'));
+            if (newline != in.end()) {
+                line.assign(begin, newline);
+                consumed += line.size() + 1;
+                return true;
+            }
+            if (!fill()) return false;
+        }
+    }
+};
+
+// Générateur de charge : 'connections' clients en boucle fermée, chacun avec
+// 'depth' requêtes en vol ; mélange de lectures (sommet, blocs, preuves) et de
+// soumissions de transactions signées
+struct RpcLoadConfig {
+    size_t connections;
+    size_t depth;
+    size_t requestsPerConnection;
+    double submitShare; // part des requêtes qui soumettent une transaction
+
+    RpcLoadConfig() : connections(4), depth(8), requestsPerConnection(5000), submitShare(0.1) {}
+};
+
+struct RpcLoadReport {
+    size_t requests;
+    size_t errors;
+    double seconds;
+    double p50Us;
+    double p99Us;
+    double p999Us;
+    double maxUs;
+    uint64_t bytesReceived;
+
+    RpcLoadReport() : requests(0), errors(0), seconds(0), p50Us(0), p99Us(0), p999Us(0), maxUs(0), bytesReceived(0) {}
+};
+
+RpcLoadReport runRpcLoad(uint16_t port, const RpcLoadConfig& config) {
+    RpcLoadReport report;
+    size_t height = 0;
+    {
+        RpcClient probe(port);
+        RpcRequest tip;
+        probe.send(tip);
+        RpcClient::Response response;
+        if (!probe.receive(response) || response.status != RpcStatus::Ok) throw std::runtime_error("runRpcLoad : serveur muet");
+        ByteReader r(response.payload.data(), response.payload.size());
+        height = r.u64();
+    }
+
+    // Transactions signées d'avance : la signature ne compte pas dans la mesure
+    size_t submits = static_cast<size_t>(config.submitShare * static_cast<double>(config.requestsPerConnection)) + 1;
+    // Montants tous distincts (donc ids distincts), à partir d'une base tirée au
+    // hasard pour qu'une nouvelle mesure contre le même serveur ne rejoue rien
+    std::vector<std::vector<Transaction> > pools(config.connections);
+    const uint64_t range = 100000000000ULL;
+    uint64_t base = std::mt19937_64(std::random_device{}())() % range;
+    for (size_t t = 0; t < pools.size(); ++t) {
+        for (size_t i = 0; i < submits; ++i) {
+            uint64_t k = base + t * submits + i;
+            pools[t].emplace_back("Charge_" + std::to_string(k % 64), "Charge_" + std::to_string((k + 1) % 64),
+                0.000001 * static_cast<double>(1 + k % range), 0.0001);
+        }
+        signWithDemoKeys(pools[t]);
+    }
+
+    std::vector<std::vector<double> > latencies(config.connections);
+    std::vector<size_t> errors(config.connections, 0);
+    std::vector<uint64_t> bytes(config.connections, 0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < config.connections; ++t) {
+        threads.emplace_back([&, t] {
+            RpcClient client(port);
+            std::mt19937_64 gen(100 + t);
+            std::vector<std::chrono::steady_clock::time_point> sentAt(config.requestsPerConnection);
+            std::vector<double>& lat = latencies[t];
+            lat.reserve(config.requestsPerConnection);
+            size_t nextSubmit = 0, sent = 0, received = 0;
+            auto issue = [&] {
+                RpcRequest request;
+                request.id = static_cast<uint32_t>(sent);
+                double pick = static_cast<double>(gen() % 10000) / 10000.0;
+                if (pick < config.submitShare && nextSubmit < pools[t].size()) {
+                    request.method = RpcMethod::SubmitTransaction;
+                    request.transaction = pools[t][nextSubmit++];
+                }
+                else {
+                    switch (gen() % 4) {
+                    case 0: request.method = RpcMethod::Tip; break;
+                    case 1: request.method = RpcMethod::BlockByHeight; break;
+                    case 2: request.method = RpcMethod::BlockByHeight; break;
+                    default: request.method = RpcMethod::Proof; break;
+                    }
+                    request.height = 1 + gen() % std::max<size_t>(height, 1);
+                    request.txIndex = 0;
+                }
+                sentAt[sent++] = std::chrono::steady_clock::now();
+                client.send(request);
+            };
+            while (sent < std::min(config.depth, config.requestsPerConnection)) issue();
+            RpcClient::Response response;
+            while (received < config.requestsPerConnection && client.receive(response)) {
+                auto now = std::chrono::steady_clock::now();
+                lat.push_back(std::chrono::duration<double, std::micro>(now - sentAt[response.id]).count());
+                if (response.status != RpcStatus::Ok) ++errors[t];
+                bytes[t] += 9 + response.payload.size();
+                ++received;
+                if (sent < config.requestsPerConnection) issue();
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (size_t t = 0; t < config.connections; ++t) {
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+        report.errors += errors[t];
+        report.bytesReceived += bytes[t];
+    }
+    report.requests = all.size();
+    if (!all.empty()) {
+        std::sort(all.begin(), all.end());
+        auto at = [&](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * static_cast<double>(all.size())))]; };
+        report.p50Us = at(0.5);
+        report.p99Us = at(0.99);
+        report.p999Us = at(0.999);
+        report.maxUs = all.back();
+    }
+    return report;
+}
+
+void printRpcLoadReport(const RpcLoadConfig& config, const RpcLoadReport& r) {
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "   " << config.connections << " connexions x " << config.depth << " en vol : "
+        << static_cast<long long>(static_cast<double>(r.requests) / r.seconds) << " requêtes/s, latence p50 " << r.p50Us
+        << " us, p99 " << r.p99Us << " us, p99.9 " << r.p999Us << " us, max " << r.maxUs << " us, "
+        << static_cast<double>(r.bytesReceived) / (1024.0 * 1024.0) / r.seconds << " Mo/s"
+        << (r.errors == 0 ? "" : " [" + std::to_string(r.errors) + " REFUS]") << "\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Chaîne de démonstration servie par --rpc et par le benchmark : blocs PoW de
+// transactions signées entre comptes crédités à la génèse
+void buildRpcDemoChain(Blockchain& chain, size_t blocks, size_t transactionsPerBlock) {
+    QuietOutput quiet;
+    std::vector<std::string> accounts;
+    for (int a = 0; a < 64; ++a) accounts.push_back("Charge_" + std::to_string(a));
+    for (const auto& a : accounts) chain.credit(a, toAmount(1e6));
+    std::mt19937_64 gen(230);
+    std::unordered_map<AccountId, uint64_t> nonces;
+    for (size_t b = 0; b < blocks; ++b) {
+        std::vector<Transaction> txs;
+        for (size_t i = 0; i < transactionsPerBlock; ++i) {
+            size_t from = gen() % accounts.size();
+            txs.emplace_back(accounts[from], accounts[(from + 1) % accounts.size()],
+                0.000001 * static_cast<double>(1 + gen() % 1000000), 0.0001);
+        }
+        assignNonces(txs, nonces);
+        signWithDemoKeys(txs);
+        chain.addBlockPoW(std::move(txs));
+    }
+}
+#endif
+
+// ==================================================
+// TESTS (vecteurs connus)
+// ==================================================
+// Vecteurs NIST (FIPS 180-4, exemples SHA-256) vérifiés avec la version scalaire,
+// le double SHA-256 et chacun des noyaux multi-buffer disponibles sur la machine.
+bool runSha256SelfTest() {
+    struct Vector { std::string message; const char* digest; const char* doubleDigest; };
+    const Vector vectors[] = {
+        { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+          "5df6e0e2761359d30a8275058e299fcc0381534545f55cf43e41983f5d4c9456" },
+        { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+          "4f8b42c22dd3729b519ba6f68d2da7cc5b2d606d05daed5ad5128cc03e6c6358" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+          "0cffe17f68954dac3a84fb1458bd5ec99209449749b2b308b7cb55812f9563af" },
+        { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+          "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+          "accd7bd1cb0fcbd85cf0ba5ba96945127776373a7d47891eb43ed6b1e2ee60fe" },
+        { std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", nullptr }
+    };
+
+    std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+    if (Sha256MultiBuffer::level() != SimdLevel::Scalar) levels.push_back(SimdLevel::SSE41);
+    if (Sha256MultiBuffer::level() == SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+
+    int failures = 0;
+    auto check = [&failures](const std::string& what, const std::string& got, const char* expected) {
+        if (got != expected) {
+            std::cout << "   ECHEC " << what << " : " << got << " != " << expected << "\n";
+            ++failures;
+        }
+    };
+
+    for (const auto& v : vectors) {
+        std::string label = "SHA-256(" + std::to_string(v.message.size()) + " octets)";
+        check(label, sha256_sim(v.message), v.digest);
+        if (v.doubleDigest) {
+            uint8_t d[32];
+            sha256d(v.message.data(), v.message.size(), d);
+            check("double " + label, toHex(d, sizeof(d)), v.doubleDigest);
+        }
+        // 5 voies : lot partiel, les voies restantes du noyau sont ignorées
+        const size_t lanes = 5;
+        std::vector<const uint8_t*> messages(lanes, reinterpret_cast<const uint8_t*>(v.message.data()));
+        uint8_t digests[lanes][32];
+        for (SimdLevel lvl : levels) {
+            sha256Batch(messages.data(), v.message.size(), digests, lanes, lvl);
+            for (size_t l = 0; l < lanes; ++l) {
+                check(std::string(simdLevelName(lvl)) + " " + label, toHex(digests[l], 32), v.digest);
+            }
+        }
+    }
+
+    // Lots de nonces : chaque voie doit égaler le hachage scalaire du même nonce
+    BlockHeader header(7, sha256Hash("a"), sha256Hash("b"), "20240101T000000.000Z", 0);
+    HeaderHasher hasher(header);
+    Hash256 batch[Sha256MultiBuffer::MAX_LANES];
+    hasher.hashBatch(1000, Sha256MultiBuffer::MAX_LANES, batch);
+    for (size_t l = 0; l < Sha256MultiBuffer::MAX_LANES; ++l) {
+        Hash256 single;
+        hasher.hash(1000 + static_cast<long long>(l), single);
+        check("lot de nonces, voie " + std::to_string(l), batch[l].toHex(), single.toHex().c_str());
+    }
+
+    // Difficulté par mots de 64 bits : 'd' chiffres hexadécimaux nuls = 4d bits nuls
+    Hash256 h;
+    h.bytes[9] = 0x0F;
+    if (h.leadingZeroBits() != 76 || !startsWithZeros(h, 19) || startsWithZeros(h, 20)) {
+        std::cout << "   ECHEC bits de tête : " << h.leadingZeroBits() << "\n";
+        ++failures;
+    }
+
+    std::cout << " Auto-test SHA-256 (" << simdLevelName(Sha256MultiBuffer::level()) << ") : "
+        << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Preuves d'inclusion : toutes les feuilles de petits arbres (tailles paires et
+// impaires) doivent se vérifier, une feuille ou une position modifiée non.
+bool runMerkleSelfTest() {
+    int failures = 0;
+    for (size_t n = 1; n <= 33; ++n) {
+        std::vector<Hash256> leaves(n);
+        for (size_t i = 0; i < n; ++i) leaves[i] = sha256Hash("tx" + std::to_string(i));
+        MerkleTree tree(leaves);
+        for (size_t i = 0; i < n; ++i) {
+            MerkleProof proof = tree.getProof(i);
+            if (!MerkleTree::verifyProof(leaves[i], proof, tree.getRootHash())) ++failures;
+            if (MerkleTree::verifyProof(sha256Hash("faux"), proof, tree.getRootHash())) ++failures;
+            proof.index ^= 1;
+            if (n > 1 && proof.siblings[0] != leaves[i] &&
+                MerkleTree::verifyProof(leaves[i], proof, tree.getRootHash())) ++failures;
+        }
+    }
+    std::cout << " Auto-test preuves de Merkle : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// L'accumulateur incrémental doit donner exactement computeMerkleRoot après chaque ajout
+bool runMerkleAccumulatorSelfTest() {
+    int failures = 0;
+    std::vector<Transaction> txs = createSampleTransactions(70);
+    std::vector<Transaction> prefix;
+    MerkleAccumulator acc;
+    if (acc.root() != computeMerkleRoot(prefix)) ++failures;
+    for (const auto& tx : txs) {
+        acc.append(tx);
+        prefix.push_back(tx);
+        if (acc.root() != computeMerkleRoot(prefix)) ++failures;
+    }
+    std::cout << " Auto-test accumulateur de Merkle : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// État des comptes : application parallèle identique à l'application série
+// (transactions acceptées et soldes au bit près), puis annulation complète.
+bool runLedgerSelfTest() {
+    int failures = 0;
+    std::mt19937_64 gen(42);
+    std::vector<std::string> accounts;
+    for (int a = 0; a < 300; ++a) accounts.push_back("acct" + std::to_string(a));
+    std::uniform_int_distribution<size_t> accountDist(0, accounts.size() - 1);
+    std::uniform_real_distribution<double> amountDist(0.0, 40.0);
+
+    AccountLedger serial, parallel;
+    for (size_t a = 0; a < accounts.size(); a += 3) {
+        serial.credit(accounts[a], toAmount(100.0));
+        parallel.credit(accounts[a], toAmount(100.0));
+    }
+    ThreadPool pool(4);
+    std::unordered_map<AccountId, uint64_t> nonces;
+    for (int b = 0; b < 5; ++b) {
+        std::vector<Transaction> txs;
+        for (int i = 0; i < 5000; ++i) {
+            size_t from = accountDist(gen);
+            // Quelques comptes très sollicités pour créer des conflits
+            size_t to = (i % 7 == 0) ? b : accountDist(gen);
+            txs.push_back(Transaction(accounts[from], accounts[to], amountDist(gen), 0.01));
+        }
+        assignNonces(txs, nonces);
+        AccountLedger::BlockResult rs = serial.applyBlock(txs);
+        AccountLedger::BlockResult rp = parallel.applyBlock(txs, &pool);
+        if (rs.accepted != rp.accepted || rs.fees != rp.fees) ++failures;
+        serial.payFees("producer", rs.fees);
+        parallel.payFees("producer", rp.fees);
+    }
+    for (const auto& a : accounts) {
+        if (serial.balance(a) != parallel.balance(a)) ++failures;
+    }
+    while (parallel.rollbackBlock()) {}
+    for (size_t a = 0; a < accounts.size(); ++a) {
+        if (parallel.balance(accounts[a]) != (a % 3 == 0 ? toAmount(100.0) : 0)) ++failures;
+    }
+    if (parallel.balance("producer") != 0) ++failures;
+
+    // Montants hors limites ou débordant un solde : refusés sans effet
+    AccountLedger bounded;
+    bounded.credit("rich", INT64_MAX - toAmount(1.0));
+    bounded.credit("poor", toAmount(1.0));
+    bounded.credit("whale", MAX_MONEY + toAmount(10.0));
+    std::vector<Transaction> overflow = {
+        Transaction(AccountNames::instance().intern("poor"), AccountNames::instance().intern("rich"), INT64_MAX, 2),
+        Transaction(AccountNames::instance().intern("whale"), AccountNames::instance().intern("poor"), MAX_MONEY + 1),
+        Transaction(AccountNames::instance().intern("whale"), AccountNames::instance().intern("rich"), toAmount(2.0)),
+        Transaction(AccountNames::instance().intern("whale"), AccountNames::instance().intern("poor"), MAX_MONEY)
+    };
+    AccountLedger::BlockResult rb = bounded.applyBlock(overflow);
+    if (rb.accepted != std::vector<uint8_t>({ 0, 0, 0, 1 })) ++failures;
+    if (bounded.balance("rich") != INT64_MAX - toAmount(1.0) || bounded.balance("poor") != toAmount(1.0) + MAX_MONEY) ++failures;
+    if (bounded.payFees("rich", toAmount(2.0)) || bounded.balance("rich") != INT64_MAX - toAmount(1.0)) ++failures;
+    if (!bounded.payFees("poor", toAmount(2.0)) || bounded.balance("poor") != toAmount(3.0) + MAX_MONEY) ++failures;
+    std::vector<uint8_t> encoded;
+    ByteWriter ew(encoded);
+    overflow[1].encode(ew);
+    bool outOfRange = false;
+    try {
+        ByteReader er(encoded.data(), encoded.size());
+        Transaction::decode(er);
+    }
+    catch (const std::runtime_error&) {
+        outOfRange = true;
+    }
+    if (!outOfRange) ++failures;
+
+    // Rejeu : une transaction signée n'est acceptée qu'une fois, dans le même
+    // bloc comme dans un bloc suivant ; l'annulation rend son nonce
+    AccountLedger replayed;
+    replayed.credit("payer", toAmount(10.0));
+    Transaction once(AccountNames::instance().intern("payer"), AccountNames::instance().intern("payee"), toAmount(1.0));
+    if (replayed.applyBlock({ once, once }).accepted != std::vector<uint8_t>({ 1, 0 })) ++failures;
+    if (replayed.applyBlock({ once }).acceptedCount != 0 || replayed.nextNonce("payer") != 1) ++failures;
+    replayed.rollbackBlock();
+    replayed.rollbackBlock();
+    if (replayed.nextNonce("payer") != 0 || replayed.balance("payer") != toAmount(10.0)) ++failures;
+    {
+        QuietOutput quiet;
+        Blockchain chain(1, 1, 1);
+        chain.credit("payer", toAmount(10.0));
+        std::vector<Transaction> transfer = { once };
+        signWithDemoKeys(transfer);
+        chain.addBlockPoW(transfer);
+        chain.addBlockPoW(transfer);
+        if (chain.getBalance("payer") != toAmount(9.0) || chain.getBlock(2).transactions.size() != 0) ++failures;
+        if (!chain.validate().valid) ++failures;
+    }
+
+    // Depuis la mempool : une transaction refusée (solde) retient les suivantes
+    // du même émetteur, qui retournent en attente au lieu d'être perdues ; une
+    // transaction au nonce déjà consommé est abandonnée
+    {
+        QuietOutput quiet;
+        Blockchain chain(1, 1, 1);
+        chain.credit("spender", toAmount(1.0));
+        chain.credit("donor", toAmount(5.0));
+        AccountId spender = AccountNames::instance().intern("spender");
+        AccountId donor = AccountNames::instance().intern("donor");
+        AccountId shop = AccountNames::instance().intern("shop");
+        std::vector<Transaction> queued = {
+            Transaction(spender, shop, toAmount(0.5), toAmount(0.03), 0),
+            Transaction(spender, shop, toAmount(0.8), toAmount(0.02), 1),
+            Transaction(spender, shop, toAmount(0.1), toAmount(0.01), 2)
+        };
+        signWithDemoKeys(queued);
+        for (const auto& tx : queued) chain.submitTransaction(tx);
+        chain.addBlockPoW();
+        if (chain.getBlock(1).transactions.size() != 1 || chain.getMempool().size() != 2) ++failures;
+        std::vector<Transaction> gift = { Transaction(donor, spender, toAmount(1.0), toAmount(0.05), 0) };
+        signWithDemoKeys(gift);
+        chain.submitTransaction(gift[0]);
+        chain.addBlockPoW();
+        if (chain.getBlock(2).transactions.size() != 3 || chain.getMempool().size() != 0) ++failures;
+        if (chain.getBalance("shop") != toAmount(1.4) || chain.getNextNonce("spender") != 3) ++failures;
+        chain.submitTransaction(queued[0]);
+        chain.addBlockPoW();
+        if (chain.getBlock(3).transactions.size() != 0 || chain.getMempool().size() != 0) ++failures;
+        if (!chain.validate().valid) ++failures;
+    }
+    std::cout << " Auto-test état des comptes : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Encodage canonique : vecteur connu (octets attendus écrits à la main d'après
+// la spécification), aller-retour encode/décode, en-tête de bloc et tampon tronqué.
+bool runSerializationSelfTest() {
+    int failures = 0;
+    Transaction tx("Alice", "Bob", 1.5, 0.01);
+    uint8_t buffer[Transaction::MAX_ENCODED_SIZE];
+    size_t size = tx.encode(buffer);
+    const char* expected = "02" "0000000000000000" "60e3160000000000" "1027000000000000" "05416c696365" "03426f62";
+    if (toHex(buffer, size) != expected) ++failures;
+    uint8_t digest[32];
+    sha256d(buffer, size, digest);
+    if (tx.id != loadBE64(digest) || tx.hash() != Hash256::fromDigest(digest)) ++failures;
+
+    // Une micro-unité d'écart suffit à changer l'id, y compris sur de grands montants
+    if (Transaction(tx.sender, tx.receiver, 1).id == Transaction(tx.sender, tx.receiver, 2).id) ++failures;
+    if (Transaction(tx.sender, tx.receiver, 1, 0, 0).id == Transaction(tx.sender, tx.receiver, 1, 0, 1).id) ++failures;
+    const Amount large = Amount(1) << 60;
+    if (Transaction(tx.sender, tx.receiver, large).id == Transaction(tx.sender, tx.receiver, large + 1).id) ++failures;
+
+    std::vector<Transaction> txs = createSampleTransactions(500);
+    std::vector<uint8_t> bytes;
+    ByteWriter w(bytes);
+    for (const auto& t : txs) t.encode(w);
+    ByteReader r(bytes.data(), bytes.size());
+    for (const auto& t : txs) {
+        Transaction d = Transaction::decode(r);
+        if (d.id != t.id || d.sender != t.sender || d.receiver != t.receiver || d.amount != t.amount || d.fee != t.fee) ++failures;
+    }
+    if (r.remaining() != 0) ++failures;
+
+    bool truncated = false;
+    try {
+        ByteReader shortReader(buffer, size - 1);
+        Transaction::decode(shortReader);
+    }
+    catch (const std::runtime_error&) {
+        truncated = true;
+    }
+    if (!truncated) ++failures;
+
+    Block block(7, sha256Hash("prev"), txs);
+    uint8_t header[BlockHeader::SIZE];
+    BlockHeader(block.index, block.previousHash, block.merkleRoot, block.timestamp, 0).serialize(header);
+    ByteReader hr(header, sizeof(header));
+    BlockHeader decoded = BlockHeader::decode(hr);
+    if (decoded.index != 7 || decoded.previousHash != block.previousHash || decoded.merkleRoot != block.merkleRoot ||
+        decoded.timestampString() != block.timestamp || decoded.hash() != block.hash) ++failures;
+
+    // Enregistrement de bloc : corps relu à l'identique ; préfixe tronqué ou
+    // taille d'en-tête inférieure au préfixe fixe refusés sans lecture hors limites
+    std::vector<uint8_t> record;
+    BlockStore::encode(block, record);
+    std::vector<Transaction> body = BlockStore::decodeTransactions(record.data(), record.size());
+    if (body.size() != txs.size() || body.back().id != txs.back().id) ++failures;
+    std::vector<uint8_t> badHeaderSize = record;
+    badHeaderSize[8] = 4;
+    badHeaderSize[9] = badHeaderSize[10] = badHeaderSize[11] = 0;
+    for (const std::vector<uint8_t>* bad : { &badHeaderSize, &record }) {
+        bool refused = false;
+        try {
+            BlockStore::decodeTransactions(bad->data(), bad == &record ? 3 : bad->size());
+        }
+        catch (const std::runtime_error&) {
+            refused = true;
+        }
+        if (!refused) ++failures;
+    }
+
+    // Horodatage des en-têtes : exactement 20 caractères, aller-retour exact
+    if (formatBlockTime(1729103664123ULL) != "20241016T183424.123Z" || formatBlockTime(0) != "19700101T000000.000Z") ++failures;
+    for (uint64_t ms : { 0ULL, 951782400999ULL, 1729103664123ULL, 4102444799999ULL }) {
+        if (parseBlockTime(formatBlockTime(ms)) != ms) ++failures;
+    }
+    if (block.timestamp.size() != 20 || block.timeMillis() == 0 || parseBlockTime("2024-01-01 00:00:00") != 0) ++failures;
+
+    std::cout << " Auto-test encodage canonique : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Index des en-têtes : recherche par hash de chaque bloc, en-tête canonique
+// reconstruit identique, chaînage rompu détecté à la bonne hauteur
+bool runChainIndexSelfTest() {
+    int failures = 0;
+    ChainIndex index;
+    std::vector<std::unique_ptr<Block> > blocks;
+    blocks.emplace_back(new Block(0, Hash256(), std::vector<Transaction>()));
+    for (size_t i = 1; i < 1000; ++i) {
+        if (i % 3 == 0) {
+            std::unique_ptr<PoWBlock> pow(new PoWBlock(i, blocks.back()->hash, std::vector<Transaction>(), 1));
+            pow->finalize();
+            blocks.push_back(std::move(pow));
+        }
+        else {
+            std::unique_ptr<PoSBlock> pos(new PoSBlock(i, blocks.back()->hash, createSampleTransactions(2)));
+            pos->validatorId = "Node_" + std::to_string(i % 7);
+            blocks.push_back(std::move(pos));
+        }
+    }
+    for (const auto& b : blocks) index.append(*b);
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (index.find(blocks[i]->hash) != i) ++failures;
+        if (index.header(i).hash() != blocks[i]->calculateHash()) ++failures;
+        if (index.consensusInfo(i) != blocks[i]->getConsensusInfo()) ++failures;
+        if (index.timestamp(i) != blocks[i]->timestamp) ++failures;
+    }
+    if (index.find(sha256Hash("absent")) != ChainIndex::npos) ++failures;
+    if (index.firstInvalidHeader() != ChainIndex::npos) ++failures;
+
+    bool rejected = false;
+    try {
+        index.append(*blocks[5]);
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    if (!rejected) ++failures;
+
+    ChainIndex broken;
+    blocks[600]->previousHash = sha256Hash("autre");
+    for (const auto& b : blocks) broken.append(*b);
+    if (broken.firstInvalidHeader() != 600) ++failures;
+
+    std::cout << " Auto-test index des en-têtes : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Cible 256 bits : équivalence avec les zéros hexadécimaux, arithmétique
+// saturée et réajustement borné
+bool runTargetSelfTest() {
+    int failures = 0;
+    for (int d = 0; d <= 8; ++d) {
+        Hash256 t = targetFromZeroDigits(d);
+        if (!startsWithZeros(t, d) || (d < 64 && startsWithZeros(t, d + 1))) ++failures;
+    }
+    Hash256 h = sha256Hash("cible");
+    for (int d = 0; d <= 4; ++d) {
+        if (meetsTarget(h, targetFromZeroDigits(d)) != startsWithZeros(h, d)) ++failures;
+    }
+
+    // (2^244 - 1) / 16 = 2^240 - 1 (division entière)
+    Hash256 t3 = targetFromZeroDigits(3);
+    if (scaleTarget(t3, 1, 16) != targetFromZeroDigits(4)) ++failures;
+    if (scaleTarget(h, 3, 3) != h) ++failures;
+    if (scaleTarget(maxTarget(), 2, 1) != maxTarget()) ++failures;
+    if (scaleTarget(targetFromZeroDigits(64), 1, 2).isZero()) ++failures;
+    double diff = targetDifficulty(t3);
+    if (diff < 4095.9 || diff > 4096.1) ++failures;
+
+    // Blocs deux fois trop lents : la cible double (difficulté divisée par deux)
+    DifficultyRetargeter r(t3, 0.010, 4);
+    for (int i = 0; i < 4; ++i) r.record(0.020, t3);
+    if (r.target() != scaleTarget(t3, 2, 1)) ++failures;
+    // Blocs beaucoup trop rapides : pas de plus de MAX_STEP par fenêtre
+    DifficultyRetargeter fast(t3, 1.0, 4);
+    fast.record(0.0, t3);
+    if (fast.target() != scaleTarget(t3, 1, DifficultyRetargeter::MAX_STEP)) ++failures;
+    // Temps visé nul : cible fixe
+    DifficultyRetargeter fixed(t3);
+    fixed.record(5.0, t3);
+    if (fixed.target() != t3) ++failures;
+
+    PoWBlock block(1, sha256Hash("prev"), createSampleTransactions(4), t3);
+    block.nonce = 12345;
+    uint8_t header[BlockHeader::SIZE];
+    BlockHeader(block.index, block.previousHash, block.merkleRoot, block.timestamp, block.nonce, block.target).serialize(header);
+    ByteReader hr(header, sizeof(header));
+    if (BlockHeader::decode(hr).target != t3) ++failures;
+
+    std::cout << " Auto-test cible 256 bits : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Bifurcations : la branche au plus grand poids cumulé l'emporte (aller puis
+// retour), soldes identiques à une reconstruction complète, stockage tronqué
+// puis rechargé sur la bonne branche, branche à double dépense refusée
+bool runForkSelfTest() {
+    int failures = 0;
+    std::string dir = (std::filesystem::temp_directory_path() / "fork_selftest").string();
+    std::filesystem::remove_all(dir);
+    auto mined = [](const Hash256& parent, size_t index, std::vector<Transaction> txs, bool sign = true) {
+        if (sign) signWithDemoKeys(txs);
+        std::unique_ptr<PoWBlock> block(new PoWBlock(index, parent, std::move(txs), 1));
+        block->finalize();
+        return block;
+    };
+    auto sameBalances = [](Blockchain& chain) {
+        std::vector<Amount> before;
+        for (const char* user : { "Alice", "Bob", "Carol", "Dave" }) before.push_back(chain.getBalance(user));
+        chain.rebuildLedger();
+        size_t i = 0;
+        for (const char* user : { "Alice", "Bob", "Carol", "Dave" }) {
+            if (chain.getBalance(user) != before[i++]) return false;
+        }
+        return true;
+    };
+    {
+        BlockStore store(dir, 512); // petits segments : la troncature en supprime
+        Blockchain chain(1, 1);
+        chain.attachStore(store);
+        chain.credit("Alice", toAmount(100.0));
+        chain.credit("Bob", toAmount(100.0));
+        const Hash256 genesis = chain.getIndex().hash(0);
+
+        std::unique_ptr<PoWBlock> a1 = mined(genesis, 1, { Transaction("Alice", "Bob", 10.0) });
+        std::unique_ptr<PoWBlock> a1Copy(new PoWBlock(*a1));
+        std::unique_ptr<PoWBlock> a2 = mined(a1->hash, 2, { Transaction("Alice", "Bob", 11.0, 0.0, 1) });
+        Hash256 a2Hash = a2->hash;
+        if (chain.acceptBlock(std::move(a1)) != AcceptResult::Connected) ++failures;
+        if (chain.acceptBlock(std::move(a2)) != AcceptResult::Connected) ++failures;
+
+        std::unique_ptr<PoWBlock> b1 = mined(genesis, 1, { Transaction("Alice", "Carol", 20.0) });
+        std::unique_ptr<PoWBlock> b2 = mined(b1->hash, 2, { Transaction("Bob", "Carol", 5.0) });
+        std::unique_ptr<PoWBlock> b3 = mined(b2->hash, 3, { Transaction("Alice", "Carol", 1.0, 0.0, 1) });
+        Hash256 b3Hash = b3->hash;
+        if (chain.acceptBlock(std::move(b1)) != AcceptResult::SideBranch) ++failures;
+        if (chain.acceptBlock(std::move(b2)) != AcceptResult::SideBranch) ++failures;
+        if (chain.acceptBlock(std::move(b3)) != AcceptResult::Reorganized) ++failures;
+        if (chain.size() != 4 || chain.getIndex().hash(3) != b3Hash) ++failures;
+        if (chain.getBalance("Alice") != toAmount(79.0) || chain.getBalance("Carol") != toAmount(26.0)) ++failures;
+        if (!sameBalances(chain)) ++failures;
+
+        // L'ancienne branche devient la plus lourde : retour en arrière
+        std::unique_ptr<PoWBlock> a3 = mined(a2Hash, 3, { Transaction("Bob", "Alice", 2.0) });
+        std::unique_ptr<PoWBlock> a4 = mined(a3->hash, 4, { Transaction("Bob", "Dave", 3.0, 0.0, 1) });
+        Hash256 a4Hash = a4->hash;
+        Transaction lastTransfer = a4->transactions[0];
+        if (chain.acceptBlock(std::move(a3)) != AcceptResult::SideBranch) ++failures;
+        if (chain.acceptBlock(std::move(a4)) != AcceptResult::Reorganized) ++failures;
+        if (chain.size() != 5 || chain.getIndex().hash(4) != a4Hash) ++failures;
+        if (chain.getBalance("Alice") != toAmount(81.0) || chain.getBalance("Carol") != 0) ++failures;
+        if (!sameBalances(chain)) ++failures;
+        if (chain.acceptBlock(std::move(a1Copy)) != AcceptResult::Duplicate) ++failures;
+        if (chain.acceptBlock(mined(sha256Hash("inconnu"), 7, {})) != AcceptResult::Orphan) ++failures;
+
+        // Dépense de Bob signée avec la clé d'Alice
+        std::vector<Transaction> forged = { Transaction("Bob", "Alice", 50.0, 0.0, 2) };
+        forged[0].sign(AccountKeys::instance().demoKeyPair(forged[0].receiver));
+        if (chain.acceptBlock(mined(a4Hash, 5, forged, false)) != AcceptResult::Invalid) ++failures;
+
+        // Transfert déjà inclus rejoué tel quel (signature valide, nonce consommé)
+        if (chain.acceptBlock(mined(a4Hash, 5, { lastTransfer }, false)) != AcceptResult::Invalid) ++failures;
+
+        // Cible plus facile que celle exigée, sur la branche active comme sur une
+        // branche en attente : tout hash la satisfait, le bloc est refusé
+        for (const Hash256& parent : { a4Hash, b3Hash }) {
+            std::unique_ptr<PoWBlock> easy(new PoWBlock(parent == a4Hash ? 5 : 4, parent, std::vector<Transaction>(), maxTarget()));
+            if (chain.acceptBlock(std::move(easy)) != AcceptResult::Invalid) ++failures;
+        }
+
+        // Branche plus lourde mais dont un bloc dépense deux fois le solde d'Alice
+        Amount alice = chain.getBalance("Alice");
+        std::unique_ptr<PoWBlock> c3 = mined(a2Hash, 3,
+            { Transaction("Alice", "Dave", 70.0, 0.0, 2), Transaction("Alice", "Carol", 70.0, 0.0, 3) });
+        std::unique_ptr<PoWBlock> c4 = mined(c3->hash, 4, { Transaction("Bob", "Dave", 1.0) });
+        std::unique_ptr<PoWBlock> c5 = mined(c4->hash, 5, { Transaction("Bob", "Dave", 2.0, 0.0, 1) });
+        std::unique_ptr<PoWBlock> c6 = mined(c5->hash, 6, {});
+        if (chain.acceptBlock(std::move(c3)) != AcceptResult::SideBranch) ++failures;
+        if (chain.acceptBlock(std::move(c4)) != AcceptResult::SideBranch) ++failures;
+        if (chain.acceptBlock(std::move(c5)) != AcceptResult::Invalid) ++failures;
+        if (chain.acceptBlock(std::move(c6)) != AcceptResult::Invalid) ++failures;
+        if (chain.size() != 5 || chain.getIndex().hash(4) != a4Hash || chain.getBalance("Alice") != alice) ++failures;
+        if (!chain.isValid() || !sameBalances(chain)) ++failures;
+    }
+    {
+        BlockStore store(dir, 512);
+        Blockchain reloaded(1, 1);
+        reloaded.attachStore(store);
+        if (reloaded.size() != 5 || !reloaded.isValid()) ++failures;
+        std::vector<Transaction> last = store.loadTransactions(4);
+        if (last.size() != 1 || last[0].amount != toAmount(3.0) || !last[0].verifySignature()) ++failures;
+        if (!reloaded.validate().valid) ++failures;
+    }
+    std::filesystem::remove_all(dir);
+
+    // Bifurcation plus profonde que les journaux conservés : état reconstruit
+    // jusqu'au point de bifurcation, puis nouvelle branche connectée
+    {
+        Blockchain deep(1, 1);
+        deep.credit("Alice", toAmount(100.0));
+        const size_t depth = AccountLedger::MAX_JOURNAL_DEPTH + 8;
+        const Hash256 genesis = deep.getIndex().hash(0);
+        for (const char* payee : { "Bob", "Carol" }) {
+            Hash256 parent = genesis;
+            size_t length = payee[0] == 'B' ? depth : depth + 1;
+            for (size_t h = 1; h <= length; ++h) {
+                std::vector<Transaction> txs;
+                if (h == 1) txs.push_back(Transaction("Alice", payee, payee[0] == 'B' ? 10.0 : 30.0));
+                std::unique_ptr<PoWBlock> block = mined(parent, h, txs);
+                parent = block->hash;
+                deep.acceptBlock(std::move(block));
+            }
+            if (deep.getIndex().hash(deep.size() - 1) != parent) ++failures;
+        }
+        if (deep.size() != depth + 2 || deep.getBalance("Alice") != toAmount(70.0) || deep.getBalance("Bob") != 0 ||
+            deep.getBalance("Carol") != toAmount(30.0)) ++failures;
+        if (!sameBalances(deep)) ++failures;
+    }
+
+    std::cout << " Auto-test bifurcations : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Pipeline : un bloc qui échoue au minage, puis un bloc qui échoue à l'écriture,
+// annulent leurs comptes et ceux du bloc assemblé derrière eux et rendent leurs
+// transactions à la mempool ; le bloc soumis ensuite est écrit normalement
+bool runPipelineSelfTest() {
+    int failures = 0;
+    std::unique_ptr<Blockchain> chain;
+    {
+        QuietOutput quiet;
+        chain.reset(new Blockchain(1, 1, 1));
+    }
+    std::vector<std::string> accounts = { "Pipe_A", "Pipe_B", "Pipe_C" };
+    for (const auto& a : accounts) chain->credit(a, toAmount(100.0));
+    std::vector<Transaction> txs;
+    for (size_t i = 0; i < 30; ++i) {
+        txs.emplace_back(accounts[i % 3], accounts[(i + 1) % 3], 1.0, 0.01 * static_cast<double>(1 + i % 7));
+    }
+    std::unordered_map<AccountId, uint64_t> nonces;
+    assignNonces(txs, nonces);
+    signWithDemoKeys(txs);
+    for (const auto& tx : txs) chain->submitTransaction(tx);
+    chain->setMaxBlockTransactions(10);
+
+    // Soldes, nonces, ids en attente et hauteur
+    auto snapshot = [&]() {
+        std::vector<uint64_t> state;
+        for (const auto& a : accounts) {
+            state.push_back(static_cast<uint64_t>(chain->getBalance(a)));
+            state.push_back(chain->getNextNonce(a));
+        }
+        std::vector<uint64_t> pending;
+        for (const auto& tx : chain->getMempool().pendingTransactions()) pending.push_back(tx.id);
+        std::sort(pending.begin(), pending.end());
+        state.insert(state.end(), pending.begin(), pending.end());
+        state.push_back(chain->size());
+        return state;
+    };
+    const std::vector<uint64_t> before = snapshot();
+
+    for (PipelineStage stage : { PipelineStage::Mine, PipelineStage::Commit }) {
+        const size_t failing = chain->size();
+        // Le premier bloc échoue une fois le second assemblé (20 transactions retirées)
+        chain->setPipelineFaultHook([&chain, stage, failing](size_t height, PipelineStage at) {
+            if (height != failing || at != stage) return;
+            for (int i = 0; i < 5000 && chain->getMempool().size() > 10; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            throw std::runtime_error("échec provoqué");
+        });
+        {
+            QuietOutput quiet;
+            chain->startPipeline();
+            std::future<BlockReceipt> first = chain->submitBlock();
+            std::future<BlockReceipt> second = chain->submitBlock();
+            for (std::future<BlockReceipt>* f : { &first, &second }) {
+                try {
+                    f->get();
+                    ++failures;
+                }
+                catch (const std::exception&) {
+                }
+            }
+            chain->stopPipeline();
+        }
+        chain->setPipelineFaultHook(nullptr);
+        if (snapshot() != before) ++failures;
+    }
+
+    {
+        QuietOutput quiet;
+        chain->startPipeline();
+        std::future<BlockReceipt> next = chain->submitBlock();
+        try {
+            BlockReceipt r = next.get();
+            if (r.index != 1 || r.transactions != 10) ++failures;
+        }
+        catch (const std::exception&) {
+            ++failures;
+        }
+        chain->stopPipeline();
+        if (chain->size() != 2 || chain->getMempool().size() != 20 || !chain->validate().valid) ++failures;
+    }
+
+    std::cout << " Auto-test pipeline de production : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Ed25519 : vecteurs de la RFC 8032 (section 7.1), signatures altérées ou non
+// canoniques refusées, lots (Straus puis Pippenger) d'accord avec la
+// vérification isolée
+bool runSignatureSelfTest() {
+    int failures = 0;
+    struct Vector {
+        const char* seed;
+        const char* publicKey;
+        std::string message;
+        const char* signature;
+    };
+    const Vector vectors[] = {
+        { "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+            "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a", "",
+            "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+            "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b" },
+        { "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+            "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "\x72",
+            "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+            "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00" },
+        { "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+            "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025", "\xaf\x82",
+            "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+            "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a" }
+    };
+    for (const auto& v : vectors) {
+        Hash256 seed;
+        if (!Hash256::fromHex(v.seed, seed)) ++failures;
+        KeyPair key(seed.data());
+        const uint8_t* message = reinterpret_cast<const uint8_t*>(v.message.data());
+        Signature sig = key.sign(message, v.message.size());
+        VerifyingKey verifier(key.publicKey());
+        if (key.publicKey().toHex() != v.publicKey || toHex(sig.bytes.data(), 64) != v.signature) ++failures;
+        if (!verifier.verify(message, v.message.size(), sig)) ++failures;
+
+        Signature altered = sig;
+        altered.bytes[40] ^= 0x01;
+        if (verifier.verify(message, v.message.size(), altered)) ++failures;
+        std::string otherMessage = v.message + "!";
+        if (verifier.verify(reinterpret_cast<const uint8_t*>(otherMessage.data()), otherMessage.size(), sig)) ++failures;
+
+        // S + l : même point, scalaire non canonique
+        EdScalar s = EdScalar::fromBytes(sig.bytes.data() + 32);
+        uint64_t carry = 0;
+        for (int i = 0; i < 4; ++i) {
+            WideUInt t = WideUInt(s.v[i]) + WideUInt(EdScalar::L[i]) + WideUInt(carry);
+            s.v[i] = static_cast<uint64_t>(t);
+            carry = static_cast<uint64_t>(t >> 64);
+        }
+        Signature malleated = sig;
+        s.toBytes(malleated.bytes.data() + 32);
+        if (verifier.verify(message, v.message.size(), malleated)) ++failures;
+    }
+
+    // Lots de transactions : 10 signatures (Straus), puis 300 (Pippenger)
+    std::vector<std::string> accounts;
+    for (int a = 0; a < 20; ++a) accounts.push_back("Signataire_" + std::to_string(a));
+    for (size_t count : { 10, 300 }) {
+        std::vector<Transaction> txs;
+        for (size_t i = 0; i < count; ++i) {
+            txs.emplace_back(accounts[i % accounts.size()], accounts[(i + 1) % accounts.size()], 1.0 + static_cast<double>(i));
+        }
+        signWithDemoKeys(txs);
+        if (!verifySignatures(txs)) ++failures;
+        for (const auto& tx : txs) {
+            if (!tx.verifySignature()) ++failures;
+        }
+
+        std::vector<Transaction> forged = txs;
+        forged[count / 2].amount += toAmount(1.0);
+        forged[count / 2].id = forged[count / 2].hash().word(0);
+        if (verifySignatures(forged)) ++failures;
+        for (size_t i = 0; i < count; ++i) {
+            if (forged[i].verifySignature() != (i != count / 2)) ++failures;
+        }
+
+        std::vector<Transaction> wrongKey = txs;
+        wrongKey[1].sign(AccountKeys::instance().demoKeyPair(wrongKey[1].receiver));
+        if (verifySignatures(wrongKey) || wrongKey[1].verifySignature()) ++failures;
+    }
+    Transaction unknown("Sans_cle", "Signataire_0", 1.0);
+    if (unknown.verifySignature()) ++failures;
+
+    std::cout << " Auto-test signatures Ed25519 : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Réseau simulé : chaque bloc atteint chaque nœud, tous finissent sur le même
+// sommet, et le relais compact coûte moins d'octets que le relais complet
+bool runNetworkSelfTest() {
+    int failures = 0;
+    NetworkConfig config;
+    config.nodes = 12;
+    config.outboundPeers = 3;
+    config.transactions = 60;
+    config.blocks = 3;
+    NetworkReport compact = NetworkSimulator(config).run();
+    config.compactBlocks = false;
+    NetworkReport full = NetworkSimulator(config).run();
+    for (const NetworkReport* r : { &compact, &full }) {
+        if (r->blocks != config.blocks) ++failures;
+        if (r->coverage != 1.0 || r->consensus != 1.0) ++failures;
+    }
+    if (compact.compactReceived == 0 || full.compactReceived != 0) ++failures;
+    if (compact.blockBytesPerBlock >= full.blockBytesPerBlock) ++failures;
+
+    std::cout << " Auto-test réseau simulé : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Synchronisation en-têtes d'abord depuis un pair : même sommet, mêmes soldes,
+// chaîne valide ; un en-tête mal chaîné, un corps qui ne correspond pas à sa
+// racine de Merkle ou une signature falsifiée arrêtent la synchronisation
+// juste avant le bloc fautif
+bool runSyncSelfTest() {
+    int failures = 0;
+    std::vector<std::string> accounts = { "Sync_A", "Sync_B", "Sync_C" };
+    auto fresh = [&accounts]() {
+        QuietOutput quiet;
+        std::unique_ptr<Blockchain> chain(new Blockchain(1, 1, 1));
+        for (const auto& a : accounts) chain->credit(a, toAmount(1000));
+        return chain;
+    };
+    std::unique_ptr<Blockchain> peer = fresh();
+    {
+        QuietOutput quiet;
+        std::unordered_map<AccountId, uint64_t> nonces;
+        for (size_t b = 1; b <= 300; ++b) {
+            std::vector<Transaction> txs;
+            for (size_t i = 0; i < b % 4; ++i) {
+                txs.emplace_back(accounts[(b + i) % 3], accounts[(b + i + 1) % 3], 0.01 * static_cast<double>(1 + i), 0.001);
+            }
+            assignNonces(txs, nonces);
+            signWithDemoKeys(txs);
+            peer->addBlockPoW(std::move(txs));
+        }
+    }
+
+    PeerBlockSource source(*peer);
+    std::unique_ptr<Blockchain> synced = fresh();
+    SyncReport report = synced->syncFrom(source, 128);
+    if (!report.failure.empty() || report.blocks != peer->size() || synced->getTip().hash != peer->getTip().hash) ++failures;
+    for (const auto& a : accounts) {
+        if (synced->getBalance(a) != peer->getBalance(a)) ++failures;
+    }
+    {
+        QuietOutput quiet;
+        if (!synced->validate().valid) ++failures;
+    }
+
+    struct TamperedSource : BlockSource {
+        BlockSource& inner;
+        size_t badHeader, badBody, badSignature;
+        TamperedSource(BlockSource& s, size_t h, size_t b, size_t sig) : inner(s), badHeader(h), badBody(b), badSignature(sig) {}
+        size_t size() override { return inner.size(); }
+        std::unique_ptr<Block> header(size_t height) override {
+            std::unique_ptr<Block> block = inner.header(height);
+            if (height == badHeader) block->previousHash = sha256Hash("ailleurs");
+            return block;
+        }
+        std::vector<Transaction> body(size_t height) override {
+            std::vector<Transaction> txs = inner.body(height);
+            if (height == badBody) txs.pop_back();
+            if (height == badSignature) txs.back().signature.bytes[5] ^= 1;
+            return txs;
+        }
+    };
+    const size_t cases[][3] = { { 250, SIZE_MAX, SIZE_MAX }, { SIZE_MAX, 77, SIZE_MAX }, { SIZE_MAX, SIZE_MAX, 133 } };
+    for (const auto& c : cases) {
+        TamperedSource tampered(source, c[0], c[1], c[2]);
+        std::unique_ptr<Blockchain> partial = fresh();
+        SyncReport r = partial->syncFrom(tampered, 128);
+        size_t bad = std::min({ c[0], c[1], c[2] });
+        if (r.failedHeight != bad || partial->size() != bad || partial->getTip().hash != peer->getIndex().hash(bad - 1)) ++failures;
+        if ((c[0] == bad) != (r.validHeaders == bad)) ++failures;
+    }
+
+    // En-tête PoS hostile : validateur inconnu sous un hash faux, ou identifiant
+    // trop long dans l'enregistrement. En-tête refusé, sans exception et sans
+    // rien ajouter à la table des noms
+    struct HostileSource : BlockSource {
+        BlockSource& inner;
+        size_t bad;
+        bool oversized;
+        HostileSource(BlockSource& s, size_t h, bool o) : inner(s), bad(h), oversized(o) {}
+        size_t size() override { return inner.size(); }
+        std::unique_ptr<Block> header(size_t height) override {
+            std::unique_ptr<Block> block = inner.header(height);
+            if (height != bad) return block;
+            PoSBlock forged(height, block->previousHash, block->merkleRoot, block->timestamp, block->hash,
+                oversized ? std::string(300, 'x') : std::string("Intrus_sync"));
+            std::vector<uint8_t> record;
+            BlockStore::encode(forged, record);
+            return BlockStore::decodeHeader(record.data(), record.size());
+        }
+        std::vector<Transaction> body(size_t height) override { return inner.body(height); }
+    };
+    size_t names = AccountNames::instance().size();
+    for (bool oversized : { false, true }) {
+        HostileSource hostile(source, 40, oversized);
+        std::unique_ptr<Blockchain> partial = fresh();
+        SyncReport r = partial->syncFrom(hostile, 128);
+        if (r.failedHeight != 40 || r.validHeaders != 40 || partial->size() != 40) ++failures;
+    }
+    AccountId unused;
+    if (AccountNames::instance().size() != names || AccountNames::instance().find("Intrus_sync", unused)) ++failures;
+
+    // Cible réajustée (blocs bien plus rapides que les 10 s visées) : un nœud aux
+    // mêmes règles la retrouve à partir des horodatages des en-têtes, un nœud à
+    // cible fixe refuse l'en-tête du premier bloc réajusté
+    auto retargeting = [](bool enabled) {
+        QuietOutput quiet;
+        std::unique_ptr<Blockchain> chain(new Blockchain(1, 1, 1));
+        if (enabled) chain->setTargetBlockTime(10.0, 4);
+        return chain;
+    };
+    std::unique_ptr<Blockchain> fast = retargeting(true);
+    {
+        QuietOutput quiet;
+        for (int b = 0; b < 8; ++b) fast->addBlockPoW(std::vector<Transaction>());
+    }
+    if (!(fast->getPowTarget() < targetFromZeroDigits(1))) ++failures;
+    PeerBlockSource fastSource(*fast);
+    std::unique_ptr<Blockchain> sameRules = retargeting(true);
+    SyncReport same = sameRules->syncFrom(fastSource, 4);
+    if (!same.failure.empty() || sameRules->getTip().hash != fast->getTip().hash) ++failures;
+    {
+        QuietOutput quiet;
+        if (!sameRules->validate().valid || !sameRules->isValid()) ++failures;
+    }
+    std::unique_ptr<Blockchain> fixed = retargeting(false);
+    SyncReport refused = fixed->syncFrom(fastSource, 4);
+    if (refused.validHeaders != 2 || fixed->size() != 2) ++failures;
+
+    std::cout << " Auto-test synchronisation initiale : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// Ensemble UTXO avec un budget minuscule (évictions et écritures en continu),
+// comparé à un modèle de référence : double dépense, signature falsifiée et
+// création monétaire excessive refusées sans effet, annulation des blocs,
+// puis réouverture du magasin disque
+bool runUtxoSelfTest() {
+    int failures = 0;
+    std::string dir = (std::filesystem::temp_directory_path() / "selftest_utxo").string();
+    std::filesystem::remove_all(dir);
+
+    std::vector<AccountId> owners;
+    for (int a = 0; a < 4; ++a) owners.push_back(AccountNames::instance().intern("Utxo_" + std::to_string(a)));
+    std::unordered_map<OutPoint, Coin, OutPointHasher> reference;
+    std::mt19937_64 gen(25);
+
+    std::vector<std::vector<UtxoTransaction> > blocks;
+    std::vector<UtxoUndo> undos;
+    std::vector<std::unordered_map<OutPoint, Coin, OutPointHasher> > history;
+    auto blockHash = [](size_t height) { return sha256Hash("utxo:" + std::to_string(height)); };
+
+    // Bloc aléatoire valide : récompense puis dépenses de sorties d'un même propriétaire
+    auto makeBlock = [&](uint32_t height) {
+        std::vector<UtxoTransaction> txs(1);
+        txs[0].lockHeight = height;
+        for (int k = 0; k < 20; ++k) txs[0].outputs.push_back(TxOutput{ owners[gen() % owners.size()], toAmount(2) });
+        std::unordered_map<OutPoint, Coin, OutPointHasher> live = reference;
+        std::vector<OutPoint> keys;
+        for (const auto& c : live) keys.push_back(c.first);
+        std::sort(keys.begin(), keys.end(), [](const OutPoint& a, const OutPoint& b) {
+            return a.txid != b.txid ? a.txid < b.txid : a.index < b.index;
+        });
+        std::shuffle(keys.begin(), keys.end(), gen);
+        for (const OutPoint& first : keys) {
+            if (txs.size() > 12) break;
+            if (!live.count(first)) continue;
+            UtxoTransaction tx;
+            AccountId owner = live[first].owner;
+            Amount in = 0;
+            for (const OutPoint& k : keys) {
+                auto it = live.find(k);
+                if (it == live.end() || it->second.owner != owner || tx.inputs.size() == 3) continue;
+                tx.inputs.push_back(k);
+                in += it->second.value;
+                live.erase(it);
+            }
+            Amount fee = gen() % 2 ? toAmount(0.01) : 0;
+            tx.outputs.push_back(TxOutput{ owners[gen() % owners.size()], (in - fee) / 2 });
+            tx.outputs.push_back(TxOutput{ owner, in - fee - (in - fee) / 2 });
+            tx.sign(AccountKeys::instance().demoKeyPair(owner));
+            Hash256 id = tx.txid();
+            for (uint32_t j = 0; j < tx.outputs.size(); ++j) {
+                live[OutPoint(id, j)] = Coin(tx.outputs[j].owner, tx.outputs[j].value, height);
+            }
+            txs.push_back(tx);
+        }
+        Hash256 id = txs[0].txid();
+        for (uint32_t j = 0; j < txs[0].outputs.size(); ++j) live[OutPoint(id, j)] = Coin(txs[0].outputs[j].owner, toAmount(2), height);
+        return std::make_pair(txs, live);
+    };
+
+    auto matchesReference = [&](UtxoSet& set, const std::unordered_map<OutPoint, Coin, OutPointHasher>& expected) {
+        if (set.size() != expected.size()) return false;
+        for (const auto& c : expected) {
+            Coin coin;
+            if (!set.getCoin(c.first, coin) || coin != c.second) return false;
+        }
+        return true;
+    };
+
+    {
+        UtxoStore store(dir);
+        UtxoSet set(&store, 16 * 1024); // 1024 cases : le minimum
+        for (uint32_t h = 0; h < 120; ++h) {
+            auto next = makeBlock(h);
+            UtxoUndo undo;
+            if (set.connectBlock(next.first, blockHash(h), undo) != UtxoError::None) ++failures;
+            blocks.push_back(next.first);
+            undos.push_back(undo);
+            history.push_back(reference);
+            reference = next.second;
+        }
+        if (!matchesReference(set, reference) || set.memoryBytes() != 1024 * 64) ++failures;
+
+        // Blocs refusés : l'ensemble ne doit pas bouger
+        auto bad = makeBlock(120);
+        std::vector<UtxoTransaction> doubleSpend = bad.first;
+        doubleSpend.back().inputs.push_back(doubleSpend[1].inputs[0]);
+        doubleSpend.back().sign(AccountKeys::instance().demoKeyPair(owners[0]));
+        std::vector<UtxoTransaction> forged = bad.first;
+        forged.back().signature.bytes[3] ^= 1;
+        std::vector<UtxoTransaction> greedy = bad.first;
+        greedy[0].outputs.push_back(TxOutput{ owners[0], UtxoSet::BLOCK_REWARD });
+        std::vector<UtxoTransaction> spentTwice = bad.first;
+        spentTwice.push_back(spentTwice[1]);
+        for (auto* txs : { &doubleSpend, &forged, &greedy, &spentTwice }) {
+            UtxoUndo undo;
+            UtxoError e = set.connectBlock(*txs, blockHash(120), undo);
+            if (e == UtxoError::None || set.blocks() != 120 || set.tip() != blockHash(119)) ++failures;
+        }
+        if (!matchesReference(set, reference)) ++failures;
+
+        // Annulation des 40 derniers blocs
+        for (size_t h = 120; h-- > 80;) {
+            if (!set.disconnectBlock(blocks[h], undos[h], blockHash(h - 1))) ++failures;
+            reference = history[h];
+        }
+        blocks.resize(80);
+        if (!matchesReference(set, reference) || set.blocks() != 80) ++failures;
+        if (set.stats().evictions == 0 || set.stats().flushes == 0) ++failures;
+    }
+
+    // Réouverture : le destructeur a tout écrit
+    {
+        UtxoStore store(dir);
+        UtxoSet set(&store, 16 * 1024);
+        if (set.blocks() != 80 || set.tip() != blockHash(79) || !matchesReference(set, reference)) ++failures;
+        if (store.size() != reference.size()) ++failures;
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << " Auto-test ensemble UTXO : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+#ifndef _WIN32
+// Serveur RPC sur la boucle locale : sommet, blocs par hauteur et par hash
+// (octets identiques), preuve de Merkle vérifiable, soumission acceptée puis
+// refusée en double ou mal signée, émetteur inconnu refusé sans être interné,
+// requêtes en rafale, JSON, trame invalide
+bool runRpcSelfTest() {
+    int failures = 0;
+    std::unique_ptr<Blockchain> chain;
+    {
+        QuietOutput quiet;
+        chain.reset(new Blockchain(1, 1, 1));
+    }
+    buildRpcDemoChain(*chain, 4, 20);
+    RpcServer server(*chain, 0, 2);
+    RpcClient client(server.port());
+    RpcClient::Response response;
+
+    RpcRequest tip;
+    tip.id = 1;
+    client.send(tip);
+    if (!client.receive(response) || response.status != RpcStatus::Ok || response.id != 1) ++failures;
+    else {
+        ByteReader r(response.payload.data(), response.payload.size());
+        if (r.u64() != chain->size() - 1 || r.hash() != chain->getIndex().hash(chain->size() - 1)) ++failures;
+    }
+
+    RpcRequest byHeight;
+    byHeight.method = RpcMethod::BlockByHeight;
+    byHeight.height = 2;
+    client.send(byHeight);
+    std::vector<uint8_t> record;
+    if (!client.receive(response) || response.status != RpcStatus::Ok) ++failures;
+    else record = response.payload;
+    if (record.empty() || BlockStore::decodeHeader(record.data(), record.size())->hash != chain->getBlock(2).hash) ++failures;
+
+    RpcRequest byHash;
+    byHash.method = RpcMethod::BlockByHash;
+    byHash.hash = chain->getBlock(2).hash;
+    client.send(byHash);
+    if (!client.receive(response) || response.payload != record) ++failures;
+    byHash.hash = sha256Hash("absent");
+    client.send(byHash);
+    if (!client.receive(response) || response.status != RpcStatus::NotFound) ++failures;
+
+    RpcRequest proof;
+    proof.method = RpcMethod::Proof;
+    proof.height = 3;
+    proof.txIndex = 7;
+    client.send(proof);
+    if (!client.receive(response) || response.status != RpcStatus::Ok) ++failures;
+    else {
+        ByteReader r(response.payload.data(), response.payload.size());
+        Hash256 root = r.hash();
+        Hash256 leaf = r.hash();
+        MerkleProof p;
+        p.index = static_cast<size_t>(r.u64());
+        for (uint32_t n = r.u32(); n > 0; --n) p.siblings.push_back(r.hash());
+        const Block& block = chain->getBlock(3);
+        if (root != block.merkleRoot || leaf != MerkleTree::leafHash(block.transactions[7]) ||
+            !MerkleTree::verifyProof(leaf, p, root)) ++failures;
+    }
+
+    std::vector<Transaction> txs = { Transaction("Charge_1", "Charge_2", 1.0, 0.01) };
+    signWithDemoKeys(txs);
+    RpcRequest submit;
+    submit.method = RpcMethod::SubmitTransaction;
+    submit.transaction = txs[0];
+    client.send(submit);
+    if (!client.receive(response) || response.status != RpcStatus::Ok) ++failures;
+    client.send(submit);
+    if (!client.receive(response) || response.status != RpcStatus::Rejected) ++failures;
+    submit.transaction = Transaction("Charge_1", "Charge_2", 2.0, 0.01);
+    submit.transaction.signature = txs[0].signature;
+    client.send(submit);
+    if (!client.receive(response) || response.status != RpcStatus::Rejected) ++failures;
+    if (chain->getMempool().size() != 1) ++failures;
+
+    // Émetteur inconnu, ou destinataire nouveau sans signature valide : refusé
+    // avant que le moindre nom soit ajouté à la table globale
+    auto submitRaw = [&](std::string_view from, std::string_view to, const KeyPair* key) {
+        std::vector<uint8_t> body;
+        ByteWriter b(body);
+        b.u8(Transaction::ENCODING_VERSION);
+        b.u64(1);
+        b.i64(toAmount(1.0));
+        b.i64(0);
+        b.str8(from);
+        b.str8(to);
+        Signature signature = Signature();
+        if (key) {
+            Hash256 h;
+            sha256d(body.data(), body.size(), h.data());
+            signature = key->sign(h.data(), 32);
+        }
+        std::vector<uint8_t> frame;
+        ByteWriter w(frame);
+        w.u32(static_cast<uint32_t>(5 + body.size() + signature.bytes.size()));
+        w.u8(static_cast<uint8_t>(RpcMethod::SubmitTransaction));
+        w.u32(42);
+        w.bytes(body.data(), body.size());
+        w.bytes(signature.bytes.data(), signature.bytes.size());
+        client.sendRaw(frame.data(), frame.size());
+        return client.receive(response) ? response.status : RpcStatus::Ok;
+    };
+    size_t names = AccountNames::instance().size();
+    AccountId unused;
+    if (submitRaw("Intrus_rpc", "Charge_2", nullptr) != RpcStatus::BadRequest) ++failures;
+    if (submitRaw("Charge_1", "Nouveau_rpc", nullptr) != RpcStatus::BadRequest) ++failures;
+    if (AccountNames::instance().size() != names || AccountNames::instance().find("Intrus_rpc", unused) ||
+        AccountNames::instance().find("Nouveau_rpc", unused)) ++failures;
+    const KeyPair& payer = AccountKeys::instance().demoKeyPair(AccountNames::instance().intern("Charge_1"));
+    if (submitRaw("Charge_1", "Nouveau_rpc", &payer) == RpcStatus::BadRequest) ++failures;
+    if (!AccountNames::instance().find("Nouveau_rpc", unused)) ++failures;
+
+    // Cent requêtes dans un seul envoi : cent réponses, dans l'ordre
+    std::vector<uint8_t> burst;
+    for (uint32_t i = 0; i < 100; ++i) {
+        RpcRequest request;
+        request.method = i % 2 ? RpcMethod::BlockByHeight : RpcMethod::Tip;
+        request.height = i % 5;
+        request.id = 1000 + i;
+        request.encode(burst);
+    }
+    client.sendRaw(burst.data(), burst.size());
+    for (uint32_t i = 0; i < 100; ++i) {
+        if (!client.receive(response) || response.id != 1000 + i || response.status != RpcStatus::Ok) ++failures;
+    }
+
+    RpcClient json(server.port());
+    std::string line = "{\"id\": 5, \"method\": \"block\", \"height\": 2}\n{\"method\": \"tip\"}\n{\"method\": \"nope\"}\n";
+    json.sendRaw(reinterpret_cast<const uint8_t*>(line.data()), line.size());
+    std::string reply;
+    if (!json.receiveLine(reply) || reply.find("\"id\": 5, \"status\": \"ok\"") == std::string::npos ||
+        reply.find(chain->getBlock(2).hash.toHex()) == std::string::npos) ++failures;
+    if (!json.receiveLine(reply) || reply.find("\"height\": " + std::to_string(chain->size() - 1)) == std::string::npos) ++failures;
+    if (!json.receiveLine(reply) || reply.find("bad_request") == std::string::npos) ++failures;
+
+    // Lectures pendant la production de blocs : le sommet servi suit la chaîne
+    std::atomic<bool> producing(true);
+    std::atomic<int> readFailures(0);
+    std::thread reader([&] {
+        RpcClient concurrent(server.port());
+        RpcClient::Response r;
+        for (uint64_t i = 0; producing.load(); ++i) {
+            RpcRequest request;
+            request.method = i % 2 ? RpcMethod::BlockByHeight : RpcMethod::Tip;
+            request.height = i % 4;
+            concurrent.send(request);
+            if (!concurrent.receive(r) || r.status != RpcStatus::Ok) ++readFailures;
+        }
+    });
+    buildRpcDemoChain(*chain, 3, 10);
+    producing = false;
+    reader.join();
+    if (readFailures != 0) ++failures;
+    client.send(tip);
+    if (!client.receive(response) || ByteReader(response.payload.data(), response.payload.size()).u64() != 7) ++failures;
+
+    // Réorganisation : un bloc sorti de la branche active n'est plus servi par
+    // son hash, même s'il est déjà en cache
+    byHash.hash = chain->getTip().hash;
+    client.send(byHash);
+    if (!client.receive(response) || response.status != RpcStatus::Ok) ++failures;
+    {
+        QuietOutput quiet;
+        // Horodatage distinct du sommet (vide, miné dans la même milliseconde sinon)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        size_t fork = chain->size() - 2;
+        Hash256 parent = chain->getIndex().hash(fork);
+        for (size_t h = fork + 1; h <= fork + 2; ++h) {
+            std::unique_ptr<PoWBlock> block(new PoWBlock(h, parent, std::vector<Transaction>(), 1));
+            block->finalize();
+            parent = block->hash;
+            chain->acceptBlock(std::move(block));
+        }
+        if (chain->getTip().hash != parent) ++failures;
+    }
+    client.send(byHash);
+    if (!client.receive(response) || response.status != RpcStatus::NotFound) ++failures;
+
+    // Trame annoncée trop longue : connexion fermée sans réponse
+    RpcClient hostile(server.port());
+    const uint8_t oversized[9] = { 0xFF, 0xFF, 0xFF, 0x7F, 1, 0, 0, 0, 0 };
+    hostile.sendRaw(oversized, sizeof(oversized));
+    if (hostile.receive(response)) ++failures;
+
+    std::cout << " Auto-test serveur RPC : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+#endif
+
+// Table d'alias : en énumérant toutes les paires (colonne, tirage), chaque
+// validateur doit être élu exactement stake * n fois ; l'ordre d'entrée est sans effet.
+bool runValidatorSelfTest() {
+    int failures = 0;
+    std::vector<Validator> vs = { Validator("D", 10), Validator("A", 40), Validator("C", 20),
+        Validator("B", 30), Validator("E", 7), Validator("F", 0) };
+    ValidatorRegistry registry(vs);
+    std::map<std::string, uint64_t> counts;
+    for (uint64_t c = 0; c < registry.size(); ++c) {
+        for (uint64_t u = 0; u < registry.getTotalStake(); ++u) counts[registry.pick(c, u).id]++;
+    }
+    for (const auto& v : vs) {
+        if (counts[v.id] != v.stake * registry.size()) ++failures;
+    }
+
+    std::vector<Validator> reversed(vs.rbegin(), vs.rend());
+    ValidatorRegistry other(reversed);
+    for (int i = 0; i < 100; ++i) {
+        Hash256 seed = sha256Hash(std::to_string(i));
+        if (registry.select(seed)->id != other.select(seed)->id) ++failures;
+    }
+    std::cout << " Auto-test sélection des validateurs : " << (failures == 0 ? "OK" : "ECHEC") << "\n";
+    return failures == 0;
+}
+
+// ==================================================
+// BENCHMARKS
+// ==================================================
+// Débit de hachage de l'en-tête : chaîne reconstruite à chaque nonce (ancien
+// format, gardé ici comme référence), en-tête binaire avec midstate, puis
+// midstate haché par lots SIMD.
+void runHeaderHashBenchmark(long long attempts) {
+    std::cout << "=== Benchmark : hachage d'en-tête (" << attempts << " nonces) ===\n";
+    std::vector<Transaction> txs = createSampleTransactions(8);
+    Hash256 prevHash;
+    const char* names[3] = { "Reference (chaîne)", "Midstate (binaire)", "Midstate + lots SIMD" };
+    double rates[3] = { 0.0, 0.0, 0.0 };
+
+    for (int m = 0; m < 3; ++m) {
+        // Difficulté inatteignable : on mesure uniquement le coût d'un essai
+        PoWBlock block(1, prevHash, txs, 64);
+        HeaderHasher hasher = block.headerHasher();
+        long long valid = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        if (m == 0) {
+            for (long long n = 0; n < attempts; ++n) {
+                std::string data = std::to_string(block.index) + block.previousHash.toHex() + block.merkleRoot.toHex() +
+                    block.timestamp + block.target.toHex() + std::to_string(n);
+                if (meetsTarget(sha256Hash(data), block.target)) ++valid;
+            }
+        }
+        else if (m == 1) {
+            for (long long n = 0; n < attempts; ++n) {
+                if (block.tryNonce(hasher, n)) ++valid;
+            }
+        }
+        else {
+            const long long batch = static_cast<long long>(Sha256MultiBuffer::MAX_LANES);
+            for (long long n = 0; n < attempts; n += batch) {
+                if (block.findValidNonce(hasher, n, Sha256MultiBuffer::MAX_LANES) >= 0) ++valid;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        rates[m] = seconds > 0 ? attempts / seconds : 0.0;
+        std::cout << "   " << names[m] << " : " << static_cast<long long>(rates[m]) << " H/s"
+            << (valid ? " (!)" : "") << "\n";
+    }
+    std::cout << "   Noyau SIMD : " << simdLevelName(Sha256MultiBuffer::level()) << "\n";
+    if (rates[0] > 0) {
+        std::cout << "   Gain midstate : x" << std::fixed << std::setprecision(2) << rates[1] / rates[0]
+            << ", midstate + SIMD : x" << rates[2] / rates[0] << "\n\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+// Arbre à pointeurs de l'Exercice 1 (un unique_ptr par nœud, niveaux construits
+// récursivement), gardé comme point de comparaison pour l'arbre à plat.
+struct PointerMerkleNode {
+    Hash256 hashValue;
+    std::unique_ptr<PointerMerkleNode> left;
+    std::unique_ptr<PointerMerkleNode> right;
+
+    explicit PointerMerkleNode(const Hash256& h) : hashValue(h) {}
+
+    PointerMerkleNode(std::unique_ptr<PointerMerkleNode> l, std::unique_ptr<PointerMerkleNode> r)
+        : left(std::move(l)), right(std::move(r)) {
+        hashValue = right ? hashMerklePair(left->hashValue, right->hashValue)
+                          : hashMerklePair(left->hashValue, left->hashValue);
+    }
+};
+
+std::unique_ptr<PointerMerkleNode> buildPointerTree(std::vector<std::unique_ptr<PointerMerkleNode> >& level) {
+    if (level.empty()) return nullptr;
+    if (level.size() == 1) return std::move(level[0]);
+    std::vector<std::unique_ptr<PointerMerkleNode> > nextLevel;
+    for (size_t i = 0; i < level.size(); i += 2) {
+        std::unique_ptr<PointerMerkleNode> right;
+        if (i + 1 < level.size()) right = std::move(level[i + 1]);
+        nextLevel.push_back(std::unique_ptr<PointerMerkleNode>(new PointerMerkleNode(std::move(level[i]), std::move(right))));
+    }
+    return buildPointerTree(nextLevel);
+}
+
+// Construction de l'arbre (feuilles déjà hachées) : version à pointeurs contre
+// version à plat, plus le coût d'une vérification de preuve.
+void runMerkleBenchmark() {
+    std::cout << "=== Benchmark : arbre de Merkle (pointeurs vs plat) ===\n";
+    for (size_t n = 1000; n <= 1000000; n *= 10) {
+        std::vector<Hash256> leaves(n);
+        for (size_t i = 0; i < n; ++i) leaves[i] = sha256Hash(std::to_string(i));
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        std::vector<std::unique_ptr<PointerMerkleNode> > level;
+        for (const auto& leaf : leaves) level.push_back(std::unique_ptr<PointerMerkleNode>(new PointerMerkleNode(leaf)));
+        std::unique_ptr<PointerMerkleNode> root = buildPointerTree(level);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        MerkleTree tree(leaves);
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        MerkleProof proof = tree.getProof(n / 3);
+        bool ok = MerkleTree::verifyProof(leaves[n / 3], proof, tree.getRootHash());
+        auto t3 = std::chrono::high_resolution_clock::now();
+
+        double pointerMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double flatMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        double proofUs = std::chrono::duration<double, std::micro>(t3 - t2).count();
+        std::cout << "   " << std::setw(8) << n << " feuilles : pointeurs " << std::fixed << std::setprecision(2)
+            << pointerMs << " ms, plat " << flatMs << " ms (x" << (flatMs > 0 ? pointerMs / flatMs : 0.0)
+            << "), preuve " << proof.siblings.size() << " hashes en " << proofUs << " µs"
+            << (ok && root->hashValue == tree.getRootHash() ? "" : " [RACINES DIFFERENTES]") << "\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+    std::cout << "\n";
+}
+
+// Racine de Merkle parallèle : passage à l'échelle selon le nombre de threads
+// et la taille du bloc, racine comparée à la version série.
+void runParallelMerkleBenchmark() {
+    std::cout << "=== Benchmark : racine de Merkle parallèle ===\n";
+    std::vector<unsigned> threadCounts = { 1, 2, 4 };
+    unsigned hw = std::thread::hardware_concurrency();
+    if (hw > 4) threadCounts.push_back(hw);
+
+    for (size_t n = 10000; n <= 1000000; n *= 10) {
+        std::vector<Transaction> txs = createSampleTransactions(static_cast<int>(n));
+        auto t0 = std::chrono::high_resolution_clock::now();
+        Hash256 serialRoot = computeMerkleRoot(txs);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double serialMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        std::cout << "   " << std::setw(8) << n << " tx : série " << std::fixed << std::setprecision(2)
+            << serialMs << " ms";
+
+        for (unsigned threads : threadCounts) {
+            ThreadPool pool(threads);
+            auto p0 = std::chrono::high_resolution_clock::now();
+            Hash256 root = computeMerkleRoot(txs, &pool);
+            auto p1 = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(p1 - p0).count();
+            std::cout << " | " << threads << " thr " << ms << " ms (x" << (ms > 0 ? serialMs / ms : 0.0) << ")"
+                << (root == serialRoot ? "" : " [RACINE DIFFERENTE]");
+        }
+        std::cout << "\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+    std::cout << "\n";
+}
+
+// Racine après chaque ajout : accumulateur O(log n) contre recalcul complet O(n)
+void runIncrementalMerkleBenchmark() {
+    std::cout << "=== Benchmark : racine de Merkle d'un bloc ouvert (racine après chaque ajout) ===\n";
+    for (int n : { 1000, 3000 }) {
+        std::vector<Transaction> txs = createSampleTransactions(n);
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        MerkleAccumulator acc;
+        Hash256 incremental;
+        for (const auto& tx : txs) {
+            acc.append(tx);
+            incremental = acc.root();
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::vector<Transaction> open;
+        Hash256 full;
+        for (const auto& tx : txs) {
+            open.push_back(tx);
+            full = computeMerkleRoot(open);
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        double accMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double fullMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        std::cout << "   " << std::setw(6) << n << " tx : incrémental " << std::fixed << std::setprecision(2)
+            << accMs << " ms, recalcul " << fullMs << " ms (x" << (accMs > 0 ? fullMs / accMs : 0.0) << ")"
+            << (incremental == full ? "" : " [RACINES DIFFERENTES]") << "\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+    std::cout << "\n";
+}
+
+// Sélection PoS : somme + parcours linéaire (ancienne version) contre table d'alias
+void runValidatorSelectionBenchmark() {
+    std::cout << "=== Benchmark : sélection du validateur PoS ===\n";
+    const int selections = 10000;
+    for (size_t n = 1000; n <= 100000; n *= 10) {
+        std::vector<Validator> vs;
+        std::mt19937_64 gen(42);
+        for (size_t i = 0; i < n; ++i) vs.push_back(Validator("V" + std::to_string(i), 1 + gen() % 1000000));
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        size_t linearSum = 0;
+        for (int s = 0; s < selections; ++s) {
+            double total = 0.0;
+            for (const auto& v : vs) total += static_cast<double>(v.stake);
+            double target = (static_cast<double>(s % 10000) / 10000.0) * total;
+            double cumulative = 0.0;
+            for (size_t i = 0; i < vs.size(); ++i) {
+                cumulative += static_cast<double>(vs[i].stake);
+                if (cumulative >= target) { linearSum += i; break; }
+            }
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        ValidatorRegistry registry(vs);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        size_t aliasSum = 0;
+        for (int s = 0; s < selections; ++s) {
+            Hash256 seed;
+            seed.bytes[0] = uint8_t(s);
+            seed.bytes[1] = uint8_t(s >> 8);
+            aliasSum += registry.select(seed)->id.size();
+        }
+        auto t3 = std::chrono::high_resolution_clock::now();
+
+        volatile size_t sink = linearSum + aliasSum; // empêche l'élimination des boucles
+        (void)sink;
+        double linearUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / selections;
+        double buildMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        double aliasUs = std::chrono::duration<double, std::micro>(t3 - t2).count() / selections;
+        std::cout << "   " << std::setw(6) << n << " validateurs : linéaire " << std::fixed << std::setprecision(3)
+            << linearUs << " µs/sélection, alias " << aliasUs << " µs/sélection (table construite en "
+            << buildMs << " ms)\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+    std::cout << "\n";
+}
 
-    Transaction(const std::string& _sender, const std::string& _receiver, double _amount)
-        : sender(_sender), receiver(_receiver), amount(_amount) {
-        id = sha256_sim(sender + receiver + std::to_string(amount)).substr(0, 16);
+// Mémoire résidente du processus en Mo (0 si indisponible)
+double residentMemoryMB() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    long long pages = 0, resident = 0;
+    if (statm >> pages >> resident) return resident * (sysconf(_SC_PAGESIZE) / 1024.0) / 1024.0;
+#endif
+    return 0.0;
+}
+
+// Stockage persistant : écriture de 'blocks' blocs PoS, puis redémarrage
+// (ouverture + en-têtes seuls) comparé à un rechargement complet des corps.
+void runStorageBenchmark(size_t blocks) {
+    std::cout << "=== Benchmark : stockage persistant (" << blocks << " blocs) ===\n";
+    std::string dir = (std::filesystem::temp_directory_path() / "blockstore_bench").string();
+    std::filesystem::remove_all(dir);
+
+    std::vector<Transaction> txPool = createSampleTransactions(64);
+    {
+        BlockStore store(dir);
+        Hash256 prev;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < blocks; ++i) {
+            size_t first = (i * 4) % txPool.size();
+            std::vector<Transaction> txs(txPool.begin() + first, txPool.begin() + first + 4);
+            PoSBlock block(i, prev, std::move(txs));
+            block.validatorId = "Node_" + std::to_string(i % 16);
+            block.finalize();
+            store.append(block);
+            prev = block.hash;
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        std::cout << "   Écriture : " << std::fixed << std::setprecision(2) << s << " s ("
+            << static_cast<long long>(blocks / (s > 0 ? s : 1)) << " blocs/s), "
+            << store.diskSize() / (1024.0 * 1024.0) << " Mo sur disque\n";
+        std::cout.unsetf(std::ios::fixed);
     }
 
-    std::string toString() const {
-        return sender + "->" + receiver + ":" + std::to_string(amount);
+    double rssBefore = residentMemoryMB();
+    {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        BlockStore store(dir);
+        std::vector<std::unique_ptr<Block> > headers;
+        headers.reserve(store.size());
+        for (size_t i = 0; i < store.size(); ++i) headers.push_back(store.loadHeader(i));
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::cout << "   Démarrage en-têtes seuls : " << std::fixed << std::setprecision(2)
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, RSS +"
+            << residentMemoryMB() - rssBefore << " Mo\n";
+        std::cout.unsetf(std::ios::fixed);
     }
-};
 
-// ==================================================
-// MERKLE ROOT
-// ==================================================
-std::string computeMerkleRoot(const std::vector<Transaction>& transactions) {
-    if (transactions.empty()) {
-        return sha256_sim("empty");
+    rssBefore = residentMemoryMB();
+    {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        BlockStore store(dir);
+        std::vector<std::unique_ptr<Block> > full;
+        full.reserve(store.size());
+        for (size_t i = 0; i < store.size(); ++i) {
+            full.push_back(store.loadHeader(i));
+            full.back()->transactions = store.loadTransactions(i);
+            full.back()->hasBody = true;
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::cout << "   Démarrage complet (corps décodés) : " << std::fixed << std::setprecision(2)
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, RSS +"
+            << residentMemoryMB() - rssBefore << " Mo\n";
+        std::cout.unsetf(std::ios::fixed);
     }
 
-    std::vector<std::string> hashes;
-    for (const auto& tx : transactions) {
-        hashes.push_back(sha256_sim(tx.toString()));
+    std::filesystem::remove_all(dir);
+    std::cout << "\n";
+}
+
+// Validation complète d'une chaîne rechargée depuis le disque (corps lus à la
+// demande), puis détection d'un bloc dont le corps a été falsifié.
+void runValidationBenchmark(size_t blocks) {
+    std::cout << "=== Benchmark : validation complète (" << blocks << " blocs) ===\n";
+    std::string dir = (std::filesystem::temp_directory_path() / "validation_bench").string();
+    std::vector<Validator> validators = {
+        Validator("Node_A", 40), Validator("Node_B", 30), Validator("Node_C", 20), Validator("Node_D", 10)
+    };
+    ValidatorRegistry registry(validators);
+    std::vector<Transaction> txPool = createSampleTransactions(64);
+    signWithDemoKeys(txPool);
+    size_t tampered = blocks * 2 / 3;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        std::filesystem::remove_all(dir);
+        {
+            BlockStore store(dir);
+            Block genesis(0, Hash256(), std::vector<Transaction>());
+            store.append(genesis);
+            Hash256 prev = genesis.hash;
+            for (size_t i = 1; i < blocks; ++i) {
+                size_t first = (i * 8) % txPool.size();
+                std::vector<Transaction> txs(txPool.begin() + first, txPool.begin() + first + 8);
+                std::unique_ptr<Block> block;
+                if (i % 10 == 0) {
+                    PoWBlock* pow = new PoWBlock(i, prev, std::move(txs), 1);
+                    block.reset(pow);
+                    pow->finalize();
+                }
+                else {
+                    PoSBlock* pos = new PoSBlock(i, prev, std::move(txs));
+                    block.reset(pos);
+                    pos->selectValidator(registry);
+                }
+                if (pass == 1 && i == tampered) block->transactions[0].amount += toAmount(1000.0);
+                store.append(*block);
+                prev = block->hash;
+            }
+        }
+
+        BlockStore store(dir);
+        Blockchain chain(1);
+        chain.setValidators(validators);
+        chain.attachStore(store);
+        double linkMs;
+        {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            bool linked = chain.isValid();
+            linkMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+            std::cout << "   Chaînage seul : " << (linked ? "valide" : "invalide") << " en "
+                << std::fixed << std::setprecision(2) << linkMs << " ms\n";
+        }
+        ValidationReport report = chain.validate();
+        std::cout << "   Validation complète : ";
+        if (report.valid) std::cout << "valide";
+        else std::cout << "invalide au bloc " << report.firstInvalid << " (" << blockErrorName(report.error) << ")";
+        std::cout << " en " << report.seconds * 1000.0 << " ms, "
+            << static_cast<long long>(report.blocksPerSecond()) << " blocs/s"
+            << (pass == 1 && (report.valid || report.firstInvalid != tampered) ? " [FALSIFICATION NON DETECTEE]" : "")
+            << "\n";
+        std::cout.unsetf(std::ios::fixed);
     }
+    std::filesystem::remove_all(dir);
+    std::cout << "\n";
+}
+
+// Mempool : débit de soumission concurrente jusqu'à 1M transactions en attente,
+// puis latence d'assemblage d'un bloc (meilleures transactions) et éviction.
+void runMempoolBenchmark(size_t pendingCount) {
+    std::cout << "=== Benchmark : mempool (" << pendingCount << " transactions) ===\n";
+    std::vector<Transaction> txs = createSampleTransactions(static_cast<int>(pendingCount));
+    std::vector<unsigned> producerCounts = { 1, 4 };
+    unsigned hw = std::thread::hardware_concurrency();
+    if (hw > 4) producerCounts.push_back(hw);
 
-    while (hashes.size() > 1) {
-        std::vector<std::string> newLevel;
-        for (size_t i = 0; i < hashes.size(); i += 2) {
-            std::string left = hashes[i];
-            std::string right = (i + 1 < hashes.size()) ? hashes[i + 1] : left;
-            newLevel.push_back(sha256_sim(left + right));
+    for (unsigned producers : producerCounts) {
+        Mempool pool;
+        std::atomic<size_t> accepted(0);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p]() {
+                size_t ok = 0;
+                for (size_t i = p; i < txs.size(); i += producers) ok += pool.submit(txs[i]) ? 1 : 0;
+                accepted += ok;
+            });
         }
-        hashes = newLevel;
+        for (auto& t : threads) t.join();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        pool.drain();
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::vector<Transaction> block = pool.takeBest(2000);
+        auto t3 = std::chrono::high_resolution_clock::now();
+
+        double submitS = std::chrono::duration<double>(t1 - t0).count();
+        // Chaque émetteur par nonce croissant
+        std::unordered_map<AccountId, uint64_t> nextNonce;
+        bool ordered = true;
+        for (const auto& tx : block) {
+            auto seen = nextNonce.emplace(tx.sender, tx.nonce);
+            if (!seen.second && tx.nonce < seen.first->second) ordered = false;
+            seen.first->second = tx.nonce + 1;
+        }
+        std::cout << "   " << producers << " producteur(s) : " << accepted.load() << " acceptées ("
+            << txs.size() - accepted.load() << " doublons), "
+            << static_cast<long long>(accepted.load() / (submitS > 0 ? submitS : 1)) << " tx/s | indexation "
+            << std::fixed << std::setprecision(2) << std::chrono::duration<double, std::milli>(t2 - t1).count()
+            << " ms | bloc de 2000 en " << std::chrono::duration<double, std::micro>(t3 - t2).count() << " µs"
+            << (ordered ? "" : " [ORDRE INCORRECT]") << " | " << pool.memoryUsage() / (1024.0 * 1024.0) << " Mo\n";
+        std::cout.unsetf(std::ios::fixed);
     }
-    return hashes[0];
+
+    Mempool capped(64u << 20);
+    for (const auto& tx : txs) capped.submit(tx);
+    capped.drain();
+    std::cout << "   Plafond 64 Mo : " << capped.size() << " en attente, " << capped.evictedCount()
+        << " évincées (frais les plus bas)\n\n";
 }
 
-// ==================================================
-// VALIDATEUR
-// ==================================================
-struct Validator {
-    std::string id;
-    double stake;
-    Validator(const std::string& _id, double _stake) : id(_id), stake(_stake) {}
-};
+// État des comptes : application série contre vagues parallèles sans conflit
+void runLedgerBenchmark(size_t txCount, size_t accountCount) {
+    std::cout << "=== Benchmark : état des comptes (" << txCount << " tx, " << accountCount << " comptes) ===\n";
+    std::mt19937_64 gen(7);
+    std::vector<std::string> accounts;
+    for (size_t a = 0; a < accountCount; ++a) accounts.push_back("account_" + std::to_string(a));
+    std::uniform_int_distribution<size_t> accountDist(0, accountCount - 1);
+    std::uniform_real_distribution<double> amountDist(0.1, 5.0);
+    std::vector<Transaction> txs;
+    txs.reserve(txCount);
+    for (size_t i = 0; i < txCount; ++i) {
+        txs.push_back(Transaction(accounts[accountDist(gen)], accounts[accountDist(gen)], amountDist(gen), 0.001));
+    }
+    std::unordered_map<AccountId, uint64_t> nonces;
+    assignNonces(txs, nonces);
 
-// ==================================================
-// BLOC DE BASE
-// ==================================================
-class Block {
-public:
-    size_t index;
-    std::string previousHash;
-    std::string merkleRoot;
-    std::string timestamp;
-    std::vector<Transaction> transactions;
-    std::string hash;
+    std::vector<unsigned> threadCounts = { 1, 2, 4 };
+    unsigned hw = std::thread::hardware_concurrency();
+    if (hw > 4) threadCounts.push_back(hw);
 
-    Block(size_t idx, const std::string& prevHash, const std::vector<Transaction>& txs)
-        : index(idx), previousHash(prevHash), transactions(txs) {
-        auto now = std::time(nullptr);
-        auto tm = *std::localtime(&now);
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-        timestamp = oss.str();
-        merkleRoot = computeMerkleRoot(transactions);
-        hash = calculateHash();
+    AccountLedger reference;
+    for (const auto& a : accounts) reference.credit(a, toAmount(20.0));
+    auto t0 = std::chrono::high_resolution_clock::now();
+    AccountLedger::BlockResult expected = reference.applyBlock(txs);
+    double serialMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    std::cout << "   Série : " << std::fixed << std::setprecision(2) << serialMs << " ms ("
+        << expected.acceptedCount << " acceptées, " << expected.waves << " vagues)";
+
+    for (unsigned threads : threadCounts) {
+        ThreadPool pool(threads);
+        AccountLedger ledger;
+        for (const auto& a : accounts) ledger.credit(a, toAmount(20.0));
+        auto p0 = std::chrono::high_resolution_clock::now();
+        AccountLedger::BlockResult result = ledger.applyBlock(txs, &pool);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - p0).count();
+        bool same = result.accepted == expected.accepted;
+        for (size_t a = 0; same && a < accounts.size(); a += 97) same = ledger.balance(accounts[a]) == reference.balance(accounts[a]);
+        std::cout << " | " << threads << " thr " << ms << " ms (x" << (ms > 0 ? serialMs / ms : 0.0) << ")"
+            << (same ? "" : " [RESULTAT DIFFERENT]");
     }
+    std::cout << "\n\n";
+    std::cout.unsetf(std::ios::fixed);
+}
 
-    virtual ~Block() {}
+// Empreinte mémoire des transactions : ancienne représentation (trois
+// std::string + double) contre la structure compacte à comptes internés, et
+// allocations nécessaires pour copier, déplacer et construire un bloc.
+void runTransactionMemoryBenchmark(size_t blockSize) {
+    std::cout << "=== Benchmark : mémoire des transactions (blocs de " << blockSize << " tx) ===\n";
+    struct StringTransaction {
+        std::string id;
+        std::string sender;
+        std::string receiver;
+        double amount;
+        double fee;
+    };
+    std::vector<Transaction> txs = createSampleTransactions(static_cast<int>(blockSize));
+    const double n = static_cast<double>(blockSize);
 
-    
-    virtual std::string calculateHash() const {
-        std::string data = std::to_string(index) + previousHash + merkleRoot + timestamp;
-        return sha256_sim(data);
+    uint64_t count0 = AllocationStats::count();
+    uint64_t bytes0 = AllocationStats::bytes();
+    std::vector<StringTransaction> legacy;
+    legacy.reserve(blockSize);
+    for (const auto& tx : txs) {
+        legacy.push_back(StringTransaction{ tx.idHex(), std::string(tx.senderName()), std::string(tx.receiverName()),
+            static_cast<double>(tx.amount) / AMOUNT_SCALE, static_cast<double>(tx.fee) / AMOUNT_SCALE });
     }
+    uint64_t legacyAllocs = AllocationStats::count() - count0;
+    uint64_t legacyBytes = AllocationStats::bytes() - bytes0;
 
-    virtual void finalize() {}
-    virtual std::string getConsensusInfo() const { return "Base"; }
-};
+    count0 = AllocationStats::count();
+    std::vector<StringTransaction> legacyCopy(legacy);
+    uint64_t legacyCopyAllocs = AllocationStats::count() - count0;
 
-// ==================================================
-// BLOC PoW
-// ==================================================
-class PoWBlock : public Block {
-public:
-    long long nonce;
-    int difficulty;
+    count0 = AllocationStats::count();
+    std::vector<Transaction> copy(txs);
+    uint64_t copyAllocs = AllocationStats::count() - count0;
 
-    PoWBlock(size_t idx, const std::string& prevHash, const std::vector<Transaction>& txs, int diff)
-        : Block(idx, prevHash, txs), nonce(0), difficulty(diff) {
-        hash = calculateHash();
+    count0 = AllocationStats::count();
+    std::vector<Transaction> moved(std::move(copy));
+    uint64_t moveAllocs = AllocationStats::count() - count0;
+
+    count0 = AllocationStats::count();
+    auto t0 = std::chrono::high_resolution_clock::now();
+    PoSBlock block(1, Hash256(), std::move(moved));
+    auto t1 = std::chrono::high_resolution_clock::now();
+    uint64_t blockAllocs = AllocationStats::count() - count0;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "   Représentation : chaînes " << legacyBytes / n
+        << " octets/tx, " << legacyAllocs / n << " alloc/tx | compacte " << sizeof(Transaction) << " octets/tx, 0 alloc/tx\n";
+    std::cout << "   Copie du tableau d'un bloc : chaînes " << legacyCopyAllocs << " allocations, compacte "
+        << copyAllocs << " ; déplacement " << moveAllocs << "\n";
+    std::cout << "   Construction d'un PoSBlock (transactions déplacées) : " << blockAllocs << " allocations, "
+        << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms ("
+        << block.transactions.size() << " tx)\n";
+    std::cout << "   Noms internés : " << AccountNames::instance().size() << " comptes\n\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Identifiant et feuille de Merkle : ancien chemin texte (concaténation avec
+// std::to_string(double), une chaîne allouée par transaction) contre l'encodage
+// canonique binaire, puis débit d'encodage et de décodage sans copie.
+void runSerializationBenchmark(size_t count) {
+    std::cout << "=== Benchmark : encodage canonique des transactions (" << count << " tx) ===\n";
+    std::vector<Transaction> txs = createSampleTransactions(static_cast<int>(count));
+    uint64_t sink = 0;
+
+    uint64_t allocs0 = AllocationStats::count();
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (const auto& tx : txs) {
+        std::string data = std::string(tx.senderName()) + std::string(tx.receiverName()) +
+            std::to_string(static_cast<double>(tx.amount) / AMOUNT_SCALE) +
+            std::to_string(static_cast<double>(tx.fee) / AMOUNT_SCALE);
+        uint8_t digest[32];
+        sha256d(data.data(), data.size(), digest);
+        sink += digest[0];
     }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    uint64_t textAllocs = AllocationStats::count() - allocs0;
+    for (const auto& tx : txs) sink += tx.hash().bytes[0];
+    auto t2 = std::chrono::high_resolution_clock::now();
+    uint64_t binaryAllocs = AllocationStats::count() - allocs0 - textAllocs;
+
+    std::vector<uint8_t> bytes;
+    bytes.reserve(count * 32);
+    ByteWriter w(bytes);
+    auto t3 = std::chrono::high_resolution_clock::now();
+    for (const auto& tx : txs) tx.encode(w);
+    auto t4 = std::chrono::high_resolution_clock::now();
+    ByteReader r(bytes.data(), bytes.size());
+    size_t mismatches = 0;
+    for (const auto& tx : txs) mismatches += Transaction::decode(r).id != tx.id ? 1 : 0;
+    auto t5 = std::chrono::high_resolution_clock::now();
 
+    volatile uint64_t keep = sink; // empêche l'élimination des boucles
+    (void)keep;
+    auto rate = [count](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        double sec = std::chrono::duration<double>(b - a).count();
+        return static_cast<long long>(count / (sec > 0 ? sec : 1));
+    };
+    std::cout << "   Id texte (to_string) : " << rate(t0, t1) << " tx/s, " << textAllocs / count << " alloc/tx\n";
+    std::cout << "   Id binaire canonique : " << rate(t1, t2) << " tx/s, " << binaryAllocs / count << " alloc/tx\n";
+    std::cout << "   Encodage : " << rate(t3, t4) << " tx/s (" << std::fixed << std::setprecision(1)
+        << static_cast<double>(bytes.size()) / count << " octets/tx) | décodage + id : " << rate(t4, t5) << " tx/s"
+        << (mismatches == 0 ? "" : " [IDS DIFFERENTS]") << "\n\n";
+    std::cout.unsetf(std::ios::fixed);
+}
 
-    virtual std::string calculateHash() const {
-        std::string data = std::to_string(index) + previousHash + merkleRoot + timestamp + std::to_string(nonce);
-        return sha256_sim(data);
+// Production PoW : blocs attendus un par un (aucun recouvrement) contre blocs
+// soumis d'un coup (assemblage, minage et écriture se recouvrent)
+void runPipelineBenchmark(size_t blocks, int txPerBlock, int difficulty) {
+    std::cout << "=== Benchmark : pipeline de production (" << blocks << " blocs PoW de " << txPerBlock
+        << " tx, difficulté " << difficulty << ") ===\n";
+    // Corps signés une seule fois, réutilisés par les deux passes
+    std::vector<std::vector<Transaction> > signedBodies;
+    std::unordered_map<AccountId, uint64_t> nonces;
+    for (size_t b = 0; b < blocks; ++b) {
+        signedBodies.push_back(createSampleTransactions(txPerBlock, &nonces));
+        signWithDemoKeys(signedBodies.back());
     }
+    for (int pipelined = 0; pipelined < 2; ++pipelined) {
+        Blockchain chain(difficulty);
+        for (const char* user : { "Alice", "Bob", "Charlie", "Dave", "Eve" }) chain.credit(user, toAmount(1e9));
+        std::vector<std::vector<Transaction> > bodies = signedBodies;
 
-    void finalize() {
-        while (!startsWithZeros(hash, difficulty)) {
-            nonce++;
-            hash = calculateHash();
+        chain.startPipeline();
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::future<BlockReceipt> > pending;
+        for (auto& body : bodies) {
+            pending.push_back(chain.submitBlock(std::move(body)));
+            if (!pipelined) pending.back().wait();
         }
+        for (auto& f : pending) f.get();
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        chain.stopPipeline();
+
+        PipelineStats stats = chain.getPipelineStats();
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "   " << (pipelined ? "Pipeline    " : "Séquentiel  ") << " : " << blocks / seconds << " blocs/s ("
+            << stats.blocksPerSecond() << " en régime établi) | assemblage " << stats.average(stats.assemblySeconds) * 1000.0
+            << " ms, minage " << stats.average(stats.miningSeconds) * 1000.0
+            << " ms, écriture " << stats.average(stats.commitSeconds) * 1000.0
+            << " ms, latence " << stats.average(stats.latencySeconds) * 1000.0 << " ms"
+            << (chain.validate().valid ? "" : " [CHAINE INVALIDE]") << "\n";
+        std::cout.unsetf(std::ios::fixed);
     }
+    std::cout << "\n";
+}
 
-    std::string getConsensusInfo() const {
-        return "PoW (nonce=" + std::to_string(nonce) + ", diff=" + std::to_string(difficulty) + ")";
+// Parcours des en-têtes : blocs complets (un objet par bloc, alloué à part)
+// contre colonnes contiguës de l'index, puis recherche par hash
+void runChainIndexBenchmark(size_t blocks) {
+    std::cout << "=== Benchmark : index des en-têtes (" << blocks << " blocs) ===\n";
+    std::vector<std::unique_ptr<Block> > chain;
+    chain.reserve(blocks);
+    Hash256 prev;
+    for (size_t i = 0; i < blocks; ++i) {
+        Hash256 h = sha256Hash("bloc" + std::to_string(i));
+        chain.emplace_back(new PoSBlock(i, prev, sha256Hash("merkle" + std::to_string(i)), "20240101T000000.000Z", h,
+            "Node_A"));
+        prev = h;
     }
-};
+    ChainIndex index;
+    index.reserve(blocks);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (const auto& b : chain) index.append(*b);
+    auto t1 = std::chrono::high_resolution_clock::now();
 
-// ==================================================
-// BLOC PoS
-// ==================================================
-class PoSBlock : public Block {
-public:
-    std::string validatorId;
+    const int passes = 20;
+    size_t brokenBlocks = 0;
+    for (int p = 0; p < passes; ++p) {
+        for (size_t i = 1; i < chain.size(); ++i) brokenBlocks += chain[i]->previousHash != chain[i - 1]->hash ? 1 : 0;
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    size_t brokenHeaders = 0;
+    for (int p = 0; p < passes; ++p) brokenHeaders += index.firstInvalidHeader() == ChainIndex::npos ? 0 : 1;
+    auto t3 = std::chrono::high_resolution_clock::now();
 
-    PoSBlock(size_t idx, const std::string& prevHash, const std::vector<Transaction>& txs)
-        : Block(idx, prevHash, txs), validatorId("none") {}
+    std::mt19937_64 gen(7);
+    const size_t lookups = 1000000;
+    std::vector<Hash256> queries;
+    queries.reserve(lookups);
+    for (size_t i = 0; i < lookups; ++i) queries.push_back(chain[gen() % blocks]->hash);
+    auto t4 = std::chrono::high_resolution_clock::now();
+    size_t found = 0;
+    for (const auto& q : queries) found += index.find(q) != ChainIndex::npos ? 1 : 0;
+    auto t5 = std::chrono::high_resolution_clock::now();
 
-    void selectValidator(const std::vector<Validator>& validators) {
-        double totalStake = 0.0;
-        for (const auto& v : validators) totalStake += v.stake;
-        if (totalStake == 0) {
-            validatorId = "default";
-            return;
+    auto ms = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "   Construction de l'index : " << ms(t0, t1) << " ms\n";
+    std::cout << "   Vérification du chaînage : blocs complets " << ms(t1, t2) / passes << " ms, en-têtes "
+        << ms(t2, t3) / passes << " ms" << (brokenBlocks + brokenHeaders == 0 ? "" : " [CHAINE ROMPUE]") << "\n";
+    std::cout << "   Recherche par hash : " << static_cast<long long>(lookups / (ms(t4, t5) / 1000.0)) << " recherches/s"
+        << (found == lookups ? "" : " [HASH INTROUVABLE]") << "\n\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Coût d'un incrément de compteur sur le chemin critique
+void runMetricsBenchmark(size_t increments) {
+    std::cout << "=== Benchmark : métriques (" << increments << " incréments) ===\n";
+#ifndef NO_METRICS
+    uint64_t before = Metrics::instance().snapshot().counters[static_cast<size_t>(Counter::HashCalls)];
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < increments; ++i) METRIC_ADD(HashCalls, 1);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    uint64_t after = Metrics::instance().snapshot().counters[static_cast<size_t>(Counter::HashCalls)];
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / increments;
+    std::cout << "   METRIC_ADD : " << std::fixed << std::setprecision(2) << ns << " ns/incrément"
+        << (after - before == increments ? "" : " [COMPTE FAUX]") << "\n\n";
+    std::cout.unsetf(std::ios::fixed);
+#else
+    std::cout << "   Métriques désactivées à la compilation (NO_METRICS)\n\n";
+#endif
+}
+
+// Minage de blocs vides avec réajustement : la difficulté doit converger
+// vers le temps de bloc visé quel que soit le point de départ
+void runRetargetBenchmark(size_t blocks, double targetSeconds) {
+    std::cout << "=== Benchmark : réajustement de difficulté (" << blocks << " blocs, "
+        << targetSeconds * 1000.0 << " ms visés) ===\n";
+    ParallelMiner miner;
+    DifficultyRetargeter retargeter(targetFromZeroDigits(3), targetSeconds, 10);
+    Hash256 prevHash;
+    double windowSeconds = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    for (size_t i = 1; i <= blocks; ++i) {
+        PoWBlock block(i, prevHash, std::vector<Transaction>(), retargeter.target());
+        MiningResult result = miner.mine(block);
+        block.nonce = result.nonce;
+        block.hash = result.hash;
+        retargeter.record(result.seconds, block.target);
+        prevHash = block.hash;
+        windowSeconds += result.seconds;
+        if (i % 10 == 0) {
+            std::cout << "   Blocs " << i - 9 << "-" << i << " : " << windowSeconds * 100.0
+                << " ms en moyenne, diff suivante " << targetDifficulty(retargeter.target()) << "\n";
+            windowSeconds = 0;
+        }
+    }
+    std::cout << "\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Réorganisation sur une chaîne de plusieurs milliers de blocs : coût de la
+// bascule selon la profondeur de la bifurcation, comparé à une reconstruction
+// complète de l'état des comptes
+void runReorgBenchmark(size_t blocks, size_t txPerBlock) {
+    std::cout << "=== Benchmark : réorganisation (" << blocks << " blocs, " << txPerBlock << " tx/bloc) ===\n";
+    std::vector<std::string> accounts;
+    for (int a = 0; a < 64; ++a) accounts.push_back("Compte_" + std::to_string(a));
+    std::mt19937_64 gen(20);
+    // Transactions signées une seule fois : le bloc de hauteur h prend les
+    // txPerBlock de rang (h - 1) * txPerBlock, émetteurs en tourniquet. Le nonce
+    // d'une transaction ne dépend que de sa hauteur, elle vaut sur toutes les branches.
+    std::vector<Transaction> pool;
+    auto makeBlock = [&](const Hash256& parent, size_t index) {
+        for (size_t t = pool.size(); t < index * txPerBlock; ++t) {
+            size_t from = t % accounts.size();
+            size_t to = (from + 1 + gen() % (accounts.size() - 1)) % accounts.size();
+            pool.emplace_back(accounts[from], accounts[to], 0.000001 * static_cast<double>(1 + gen() % 1000000), 0.0,
+                t / accounts.size());
+            pool.back().sign(AccountKeys::instance().demoKeyPair(pool.back().sender));
         }
+        std::vector<Transaction> txs(pool.begin() + (index - 1) * txPerBlock, pool.begin() + index * txPerBlock);
+        std::unique_ptr<PoWBlock> block(new PoWBlock(index, parent, std::move(txs), 1));
+        block->finalize();
+        return block;
+    };
 
-        size_t seed = std::hash<std::string>{}(hash);
-        std::mt19937 gen(static_cast<unsigned int>(seed));
-        std::uniform_real_distribution<double> dis(0.0, totalStake);
-        double randVal = dis(gen);
+    Blockchain chain(1, 1);
+    for (const auto& a : accounts) chain.credit(a, toAmount(1e9));
+    for (size_t i = 1; i < blocks; ++i) chain.acceptBlock(makeBlock(chain.getIndex().hash(i - 1), i));
 
-        double cumulative = 0.0;
-        for (const auto& v : validators) {
-            cumulative += v.stake;
-            if (cumulative >= randVal) {
-                validatorId = v.id;
-                break;
-            }
+    auto ms = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t depth : { 1, 10, 100, 1000 }) {
+        // Branche concurrente partant de (sommet - depth), plus longue d'un bloc
+        size_t fork = chain.size() - 1 - depth;
+        Hash256 parent = chain.getIndex().hash(fork);
+        std::vector<std::unique_ptr<PoWBlock> > branch;
+        for (size_t h = fork + 1; h <= fork + depth + 1; ++h) {
+            branch.push_back(makeBlock(parent, h));
+            parent = branch.back()->hash;
         }
+        for (size_t i = 0; i + 1 < branch.size(); ++i) chain.acceptBlock(std::move(branch[i]));
+        auto t0 = std::chrono::high_resolution_clock::now();
+        AcceptResult result = chain.acceptBlock(std::move(branch.back()));
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::cout << "   Profondeur " << std::setw(4) << depth << " : " << std::setw(9) << ms(t0, t1) << " ms"
+            << (result == AcceptResult::Reorganized && chain.getIndex().hash(chain.size() - 1) == parent ? "" : " [ECHEC]")
+            << "\n";
     }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    chain.rebuildLedger();
+    auto t3 = std::chrono::high_resolution_clock::now();
+    std::cout << "   Reconstruction complète des soldes (" << chain.size() << " blocs) : " << ms(t2, t3) << " ms\n\n";
+    std::cout.unsetf(std::ios::fixed);
+}
 
-    void finalize() {}
+// Vérification des signatures d'un bloc : une transaction à la fois (deux
+// multiplications scalaires chacune) contre un seul lot (multi-multiplication
+// de Pippenger). Les émetteurs sont tirés parmi 1024 comptes.
+void runSignatureBenchmark(size_t maxTransactions) {
+    std::cout << "=== Benchmark : vérification des signatures Ed25519 (jusqu'à " << maxTransactions << " tx) ===\n";
+    std::vector<std::string> accounts;
+    for (int a = 0; a < 1024; ++a) accounts.push_back("Signataire_" + std::to_string(a));
+    std::mt19937_64 gen(21);
+    std::vector<Transaction> txs;
+    txs.reserve(maxTransactions);
+    for (size_t i = 0; i < maxTransactions; ++i) {
+        size_t from = gen() % accounts.size();
+        size_t to = (from + 1 + gen() % (accounts.size() - 1)) % accounts.size();
+        txs.emplace_back(accounts[from], accounts[to], 0.000001 * static_cast<double>(1 + gen() % 1000000));
+    }
+    auto t0 = std::chrono::high_resolution_clock::now();
+    signWithDemoKeys(txs);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto ms = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "   Signature : " << ms(t0, t1) * 1000.0 / static_cast<double>(maxTransactions) << " µs/tx\n";
 
-    std::string getConsensusInfo() const {
-        return "PoS (validator=" + validatorId + ")";
+    for (size_t count = 1000; count <= maxTransactions; count *= 10) {
+        std::vector<Transaction> block(txs.begin(), txs.begin() + count);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        size_t valid = 0;
+        for (const auto& tx : block) valid += tx.verifySignature() ? 1 : 0;
+        auto t3 = std::chrono::high_resolution_clock::now();
+        bool batchValid = verifySignatures(block);
+        auto t4 = std::chrono::high_resolution_clock::now();
+        double single = ms(t2, t3), batch = ms(t3, t4);
+        std::cout << "   " << std::setw(6) << count << " tx : une par une " << std::setw(9) << single << " ms ("
+            << static_cast<long long>(count / (single / 1000.0)) << " sig/s) | lot " << std::setw(8) << batch << " ms ("
+            << static_cast<long long>(count / (batch / 1000.0)) << " sig/s), x" << single / batch
+            << (valid == count && batchValid ? "" : " [SIGNATURE REFUSEE]") << "\n";
     }
-};
+    std::cout << "\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Propagation des blocs quand le réseau grandit : relais compact (en-tête et
+// identifiants courts) contre blocs complets, même topologie et mêmes
+// transactions pour les deux modes
+void runNetworkBenchmark(const std::vector<size_t>& sizes) {
+    std::cout << "=== Benchmark : réseau simulé, relais des blocs par gossip ===\n";
+    NetworkConfig config;
+    std::cout << "   " << config.transactions << " tx, " << config.blocks << " blocs toutes les "
+        << config.blockIntervalMs / 1000.0 << " s, " << config.outboundPeers << " connexions sortantes par nœud, latence "
+        << config.minLatencyMs << "-" << config.maxLatencyMs << " ms, " << config.uplinkMbps << " Mbit/s montants\n";
+    for (size_t n : sizes) runNetworkSimulation(n);
+    std::cout << "\n";
+}
+
+// Rattrapage d'une chaîne écrite sur disque (à la place d'un pair) : rejeu
+// séquentiel (acceptBlock bloc après bloc, une vérification complète chacun)
+// contre synchronisation en-têtes d'abord. Une transaction signée tous les
+// 'txEvery' blocs.
+void runSyncBenchmark(size_t blocks, size_t txEvery) {
+    std::cout << "=== Benchmark : synchronisation initiale (" << blocks << " blocs, 1 tx tous les " << txEvery
+        << ") ===\n";
+    std::string dir = (std::filesystem::temp_directory_path() / "bench_sync").string();
+    std::filesystem::remove_all(dir);
+    std::vector<std::string> accounts;
+    for (int a = 0; a < 64; ++a) accounts.push_back("Sync_" + std::to_string(a));
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    Hash256 sourceTip;
+    {
+        BlockStore store(dir);
+        std::vector<Transaction> pool;
+        for (size_t k = 0; k < blocks / txEvery; ++k) {
+            pool.emplace_back(accounts[k % 64], accounts[(k + 1) % 64], 0.000001 * static_cast<double>(1 + k), 0.0);
+        }
+        std::unordered_map<AccountId, uint64_t> nonces;
+        assignNonces(pool, nonces);
+        signWithDemoKeys(pool);
+        Block genesis(0, Hash256(), std::vector<Transaction>());
+        store.append(genesis);
+        Hash256 prev = genesis.hash;
+        size_t next = 0;
+        for (size_t h = 1; h < blocks; ++h) {
+            std::vector<Transaction> txs;
+            if (h % txEvery == 0 && next < pool.size()) txs.push_back(pool[next++]);
+            PoWBlock block(h, prev, std::move(txs), 1);
+            block.finalize();
+            store.append(block);
+            prev = block.hash;
+        }
+        sourceTip = prev;
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    BlockStore store(dir);
+    StoreBlockSource source(store);
+
+    auto ms = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "   Chaîne source écrite en " << ms(t0, t1) / 1000.0 << " s\n";
+
+    double replaySeconds = 0;
+    bool replayOk = true;
+    {
+        std::unique_ptr<Blockchain> replay;
+        {
+            QuietOutput quiet;
+            replay.reset(new Blockchain(1));
+            for (const auto& a : accounts) replay->credit(a, toAmount(1e6));
+            replay->setGenesis(*source.header(0));
+        }
+        auto r0 = std::chrono::high_resolution_clock::now();
+        for (size_t h = 1; h < blocks && replayOk; ++h) {
+            std::unique_ptr<Block> block = source.header(h);
+            block->transactions = source.body(h);
+            block->hasBody = true;
+            replayOk = replay->acceptBlock(std::move(block)) == AcceptResult::Connected;
+        }
+        replaySeconds = ms(r0, std::chrono::high_resolution_clock::now()) / 1000.0;
+        replayOk = replayOk && replay->getTip().hash == sourceTip;
+    }
+
+    SyncReport report;
+    bool syncOk;
+    {
+        std::unique_ptr<Blockchain> synced;
+        {
+            QuietOutput quiet;
+            synced.reset(new Blockchain(1));
+            for (const auto& a : accounts) synced->credit(a, toAmount(1e6));
+        }
+        report = synced->syncFrom(source);
+        syncOk = report.failure.empty() && synced->getTip().hash == sourceTip;
+    }
+    double syncSeconds = report.headerSeconds + report.bodySeconds;
+    std::cout << "   Rejeu séquentiel       : " << std::setw(7) << replaySeconds << " s ("
+        << static_cast<long long>(static_cast<double>(blocks) / replaySeconds) << " blocs/s)"
+        << (replayOk ? "" : " [ECHEC]") << "\n";
+    std::cout << "   En-têtes d'abord       : " << std::setw(7) << syncSeconds << " s ("
+        << static_cast<long long>(static_cast<double>(blocks) / syncSeconds) << " blocs/s ; en-têtes "
+        << report.headerSeconds << " s, corps " << report.bodySeconds << " s), x" << replaySeconds / syncSeconds
+        << (syncOk ? "" : " [ECHEC : " + report.failure + "]") << "\n\n";
+    std::cout.unsetf(std::ios::fixed);
+    std::filesystem::remove_all(dir);
+}
+
+// Application et annulation de blocs UTXO (500 transactions 2 entrées -> 2
+// sorties, entrées tirées au hasard dans tout l'ensemble) selon la taille de
+// l'ensemble, avec un cache borné devant le magasin disque. Signatures non
+// vérifiées : seul le coût de l'ensemble UTXO est mesuré.
+void runUtxoBenchmark(const std::vector<size_t>& sizes, size_t memoryBudget) {
+    std::cout << "=== Benchmark : ensemble UTXO (cache de " << (memoryBudget >> 20) << " Mo) ===\n";
+    std::vector<AccountId> owners;
+    for (int a = 0; a < 64; ++a) owners.push_back(AccountNames::instance().intern("Utxo_" + std::to_string(a)));
+    const size_t measured = 100, txPerBlock = 500, fillOutputs = 2000;
+    auto seconds = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double>(b - a).count();
+    };
+
+    for (size_t target : sizes) {
+        std::string dir = (std::filesystem::temp_directory_path() / "bench_utxo").string();
+        std::filesystem::remove_all(dir);
+        std::mt19937_64 gen(target);
+        std::vector<OutPoint> live;
+        live.reserve(target + measured * txPerBlock * 2);
+        std::vector<Amount> values;
+        values.reserve(live.capacity());
+        {
+            UtxoStore store(dir);
+            UtxoSet set(&store, memoryBudget);
+            UtxoUndo undo;
+            uint32_t height = 0;
+
+            // Remplissage : récompenses de 'fillOutputs' sorties
+            auto t0 = std::chrono::high_resolution_clock::now();
+            while (live.size() < target) {
+                std::vector<UtxoTransaction> txs(1);
+                txs[0].lockHeight = height;
+                for (size_t k = 0; k < fillOutputs; ++k) txs[0].outputs.push_back(TxOutput{ owners[k % owners.size()], 1000 });
+                if (set.connectBlock(txs, sha256Hash("fill" + std::to_string(height)), undo, false) != UtxoError::None) {
+                    std::cout << "   Remplissage refusé\n";
+                    return;
+                }
+                Hash256 id = txs[0].txid();
+                for (uint32_t k = 0; k < fillOutputs; ++k) {
+                    live.push_back(OutPoint(id, k));
+                    values.push_back(1000);
+                }
+                ++height;
+            }
+            set.flush();
+            auto t1 = std::chrono::high_resolution_clock::now();
 
+            // Blocs mesurés : chaque transaction dépense deux sorties d'un même propriétaire
+            std::vector<std::vector<UtxoTransaction> > blocks;
+            std::vector<UtxoUndo> undos(measured);
+            std::vector<Hash256> hashes(1, sha256Hash("fill" + std::to_string(height - 1)));
+            for (size_t b = 0; b < measured; ++b) hashes.push_back(sha256Hash("bench" + std::to_string(b)));
+            for (size_t b = 0; b < measured; ++b) {
+                std::vector<UtxoTransaction> txs(1);
+                txs[0].lockHeight = height + static_cast<uint32_t>(b);
+                txs[0].outputs.push_back(TxOutput{ owners[0], 1000 });
+                for (size_t t = 0; t < txPerBlock; ++t) {
+                    UtxoTransaction tx;
+                    size_t pick = gen() % live.size();
+                    AccountId owner = owners[(pick % fillOutputs) % owners.size()];
+                    size_t other = pick;
+                    for (int tries = 0; tries < 64 && other == pick; ++tries) {
+                        size_t c = gen() % live.size();
+                        if (owners[(c % fillOutputs) % owners.size()] == owner && c != pick) other = c;
+                    }
+                    if (other == pick) continue;
+                    tx.inputs = { live[pick], live[other] };
+                    Amount in = values[pick] + values[other];
+                    tx.outputs = { TxOutput{ owner, in / 2 }, TxOutput{ owner, in - in / 2 } };
+                    // Les sorties créées remplacent les entrées sur place : même propriétaire, même position modulo
+                    Hash256 id = tx.txid();
+                    live[pick] = OutPoint(id, 0);
+                    values[pick] = in / 2;
+                    live[other] = OutPoint(id, 1);
+                    values[other] = in - in / 2;
+                    txs.push_back(tx);
+                }
+                blocks.push_back(std::move(txs));
+            }
+            UtxoSet::Stats before = set.stats();
+            auto t2 = std::chrono::high_resolution_clock::now();
+            for (size_t b = 0; b < measured; ++b) {
+                if (set.connectBlock(blocks[b], hashes[b + 1], undos[b], false) != UtxoError::None) {
+                    std::cout << "   Bloc refusé\n";
+                    return;
+                }
+            }
+            auto t3 = std::chrono::high_resolution_clock::now();
+            UtxoSet::Stats after = set.stats();
+            for (size_t b = measured; b-- > 0;) {
+                if (!set.disconnectBlock(blocks[b], undos[b], hashes[b])) {
+                    std::cout << "   Annulation incohérente\n";
+                    return;
+                }
+            }
+            auto t4 = std::chrono::high_resolution_clock::now();
+
+            uint64_t lookups = (after.hits - before.hits) + (after.misses - before.misses);
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << "   " << std::setw(8) << set.size() << " sorties : remplissage " << seconds(t0, t1)
+                << " s, bloc appliqué " << seconds(t2, t3) * 1000.0 / measured << " ms, annulé "
+                << seconds(t3, t4) * 1000.0 / measured << " ms, succès du cache "
+                << std::setprecision(1) << 100.0 * (after.hits - before.hits) / std::max<uint64_t>(1, lookups)
+                << " %, disque " << (store.diskSize() >> 20) << " Mo\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+        std::filesystem::remove_all(dir);
+    }
+    std::cout << "\n";
+}
+
+#ifndef _WIN32
+// Serveur RPC sur la boucle locale : débit et latence de queue selon le
+// nombre de connexions et la profondeur du pipeline de requêtes
+void runRpcBenchmark(size_t blocks, size_t transactionsPerBlock) {
+    std::cout << "=== Benchmark : serveur RPC epoll (" << blocks << " blocs de " << transactionsPerBlock << " tx) ===\n";
+    std::unique_ptr<Blockchain> chain;
+    {
+        QuietOutput quiet;
+        chain.reset(new Blockchain(1));
+    }
+    buildRpcDemoChain(*chain, blocks, transactionsPerBlock);
+    RpcServer server(*chain, 0);
+    const size_t shapes[][2] = { { 1, 1 }, { 4, 1 }, { 4, 16 }, { 32, 4 } };
+    for (const auto& shape : shapes) {
+        RpcLoadConfig config;
+        config.connections = shape[0];
+        config.depth = shape[1];
+        config.requestsPerConnection = 40000 / shape[0];
+        printRpcLoadReport(config, runRpcLoad(server.port(), config));
+    }
+    std::cout << "\n";
+}
+#endif
+
+#ifdef BENCH_SUITE
 // ==================================================
-// BLOCKCHAIN
+// SUITE DE BENCHMARKS (JSON)
 // ==================================================
-class Blockchain {
-private:
-    std::vector<std::unique_ptr<Block> > chain;
-    std::vector<Validator> validators;
-    int powDifficulty;
+// Cible séparée, compilée depuis ce même fichier :
+//   g++ -std=c++17 -O2 -pthread -DBENCH_SUITE "Exercice 4.cpp" -o bench4
+// Chaque mesure enchaîne 'warmup' essais ignorés puis 'trials' essais chronométrés,
+// et rapporte médiane, p99 (rang le plus proche), minimum, moyenne et nombre
+// d'allocations par essai (médiane). Résultats en JSON sur la sortie standard
+// (ou --out), progression sur la sortie d'erreur.
+volatile uint64_t benchSink = 0; // empêche l'élimination des boucles mesurées
 
-public:
-    Blockchain(int difficulty = 2)
-        : powDifficulty(difficulty) {
+// Transactions reproductibles d'un lancement à l'autre (graine fixe) ; nonces à
+// la suite de 'nonces' s'il est fourni, sinon à partir de 0
+std::vector<Transaction> benchTransactions(size_t count, uint64_t seed = 42,
+    std::unordered_map<AccountId, uint64_t>* nonces = nullptr) {
+    static const char* users[] = { "Alice", "Bob", "Charlie", "Dave", "Eve" };
+    std::mt19937_64 gen(seed);
+    std::vector<Transaction> txs;
+    txs.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t from = gen() % 5;
+        size_t to = (from + 1 + gen() % 4) % 5;
+        txs.push_back(Transaction(AccountNames::instance().intern(users[from]), AccountNames::instance().intern(users[to]),
+            static_cast<Amount>(1 + gen() % 10000000), static_cast<Amount>(gen() % 100000)));
+    }
+    std::unordered_map<AccountId, uint64_t> fromZero;
+    assignNonces(txs, nonces ? *nonces : fromZero);
+    return txs;
+}
 
-        chain.push_back(std::unique_ptr<Block>(new Block(0, "0", std::vector<Transaction>())));
+typedef std::vector<std::pair<std::string, long long> > BenchParams;
 
-        std::cout << " Blockchain créée (bloc génèse)\n";
+struct BenchResult {
+    std::string name;
+    BenchParams params;
+    double items;            // éléments traités par essai
+    std::vector<double> ns;  // durée de chaque essai, triée
+    uint64_t allocations;    // médiane par essai
+    uint64_t allocatedBytes;
+
+    double percentile(double p) const {
+        size_t rank = static_cast<size_t>(std::ceil(p * ns.size()));
+        return ns[rank > 0 ? rank - 1 : 0];
     }
 
-    void setValidators(const std::vector<Validator>& _validators) {
-        validators = _validators;
+    double mean() const {
+        double total = 0;
+        for (double v : ns) total += v;
+        return total / ns.size();
     }
+};
 
-    void addBlockPoW(const std::vector<Transaction>& transactions) {
-        std::string lastHash = chain.back()->hash;
-        //  unique_ptr
-        std::unique_ptr<PoWBlock> block(new PoWBlock(chain.size(), lastHash, transactions, powDifficulty));
-        auto start = std::chrono::high_resolution_clock::now();
-        block->finalize();
-        auto end = std::chrono::high_resolution_clock::now();
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+class BenchSuite {
+private:
+    size_t warmup;
+    size_t trials;
+    std::string filter;
+    std::vector<BenchResult> results;
 
-        std::cout << " Bloc PoW ajouté [" << block->index << "] en " << ms << " ms\n";
-        std::cout << "   Hash : " << block->hash << "\n";
-        std::cout << "   " << block->getConsensusInfo() << "\n\n";
+    static uint64_t median(std::vector<uint64_t> values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
 
-        chain.push_back(std::move(block));
+public:
+    BenchSuite(size_t warmupRuns, size_t trialRuns, const std::string& nameFilter)
+        : warmup(warmupRuns), trials(trialRuns > 0 ? trialRuns : 1), filter(nameFilter) {}
+
+    bool selected(const std::string& name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
     }
 
-    void addBlockPoS(const std::vector<Transaction>& transactions) {
-        if (validators.empty()) {
-            std::cerr << "  Aucun validateur configuré pour PoS !\n";
-            return;
+    // body() exécute un essai complet et renvoie le nombre d'éléments traités
+    void run(const std::string& name, const BenchParams& params, const std::function<double()>& body) {
+        if (!selected(name)) return;
+        for (size_t i = 0; i < warmup; ++i) body();
+
+        BenchResult result;
+        result.name = name;
+        result.params = params;
+        result.items = 0;
+        std::vector<uint64_t> allocs, bytes;
+        for (size_t t = 0; t < trials; ++t) {
+            uint64_t allocs0 = AllocationStats::count();
+            uint64_t bytes0 = AllocationStats::bytes();
+            auto start = std::chrono::high_resolution_clock::now();
+            result.items = body();
+            auto end = std::chrono::high_resolution_clock::now();
+            allocs.push_back(AllocationStats::count() - allocs0);
+            bytes.push_back(AllocationStats::bytes() - bytes0);
+            result.ns.push_back(std::chrono::duration<double, std::nano>(end - start).count());
         }
-        std::string lastHash = chain.back()->hash;
-        std::unique_ptr<PoSBlock> block(new PoSBlock(chain.size(), lastHash, transactions));
-        block->selectValidator(validators);
-        auto start = std::chrono::high_resolution_clock::now();
-        block->finalize();
-        auto end = std::chrono::high_resolution_clock::now();
-        auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::sort(result.ns.begin(), result.ns.end());
+        result.allocations = median(allocs);
+        result.allocatedBytes = median(bytes);
 
-        std::cout << " Bloc PoS ajouté [" << block->index << "] en " << us << " µs\n";
-        std::cout << "   Hash : " << block->hash << "\n";
-        std::cout << "   " << block->getConsensusInfo() << "\n\n";
+        std::cerr << "   " << name;
+        for (const auto& p : params) std::cerr << " " << p.first << "=" << p.second;
+        std::cerr << " : médiane " << std::fixed << std::setprecision(3) << result.percentile(0.5) / 1e6
+            << " ms, p99 " << result.percentile(0.99) / 1e6 << " ms\n";
+        std::cerr.unsetf(std::ios::fixed);
+        results.push_back(std::move(result));
+    }
 
-        chain.push_back(std::move(block));
+    void writeJson(std::ostream& out) const {
+        auto now = std::time(nullptr);
+        auto tm = *std::localtime(&now);
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+
+        out << std::fixed << std::setprecision(1);
+        out << "{\n";
+        out << "  \"suite\": \"exercice4\",\n";
+        out << "  \"date\": \"" << date << "\",\n";
+        out << "  \"simd\": \"" << simdLevelName(Sha256MultiBuffer::level()) << "\",\n";
+        out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+        out << "  \"warmup\": " << warmup << ",\n";
+        out << "  \"trials\": " << trials << ",\n";
+        out << "  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            double median = r.percentile(0.5);
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", \"params\": {";
+            for (size_t p = 0; p < r.params.size(); ++p) {
+                out << (p == 0 ? "" : ", ") << "\"" << r.params[p].first << "\": " << r.params[p].second;
+            }
+            out << "}, \"items\": " << r.items
+                << ", \"median_ns\": " << median
+                << ", \"p99_ns\": " << r.percentile(0.99)
+                << ", \"min_ns\": " << r.ns.front()
+                << ", \"mean_ns\": " << r.mean()
+                << ", \"items_per_second\": " << (median > 0 ? r.items * 1e9 / median : 0.0)
+                << ", \"allocs_per_trial\": " << r.allocations
+                << ", \"bytes_per_trial\": " << r.allocatedBytes << "}";
+        }
+        out << "\n  ]\n}\n";
+        out.unsetf(std::ios::fixed);
     }
+};
 
-    bool isValid() const {
-        if (chain.empty()) return true;
-        for (size_t i = 1; i < chain.size(); ++i) {
-            const auto& current = chain[i];
-            const auto& previous = chain[i - 1];
+int runBenchmarkSuite(int argc, char* argv[]) {
+    size_t warmup = 2, trials = 15;
+    std::string filter, outPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--trials" && hasValue) trials = std::stoul(argv[++i]);
+        else if (arg == "--warmup" && hasValue) warmup = std::stoul(argv[++i]);
+        else if (arg == "--filter" && hasValue) filter = argv[++i];
+        else if (arg == "--out" && hasValue) outPath = argv[++i];
+        else {
+            std::cerr << "Usage : " << argv[0] << " [--trials N] [--warmup N] [--filter nom] [--out fichier.json]\n";
+            return 2;
+        }
+    }
+    BenchSuite suite(warmup, trials, filter);
+    std::cerr << "=== Suite de benchmarks (" << warmup << " échauffements, " << trials << " essais) ===\n";
 
-            if (current->previousHash != previous->hash) {
-                std::cerr << " Erreur : previousHash invalide au bloc " << i << "\n";
-                return false;
+    // Hachage texte hérité des exercices précédents
+    {
+        const std::string input(64, 'x');
+        const size_t hashes = 10000;
+        suite.run("sha256_sim", { { "bytes", 64 }, { "hashes", static_cast<long long>(hashes) } }, [&]() {
+            for (size_t i = 0; i < hashes; ++i) benchSink += static_cast<uint64_t>(sha256_sim(input)[0]);
+            return static_cast<double>(hashes);
+        });
+    }
+
+    // Boucle de nonce complète (mineur parallèle) : en-tête figé, donc même nonce
+    // à chaque essai ; éléments = hashes essayés
+    for (int difficulty = 1; difficulty <= 5 && suite.selected("pow_mine"); ++difficulty) {
+        PoWBlock block(1, sha256Hash("bench"), sha256Hash("merkle"), "20240101T000000.000Z", Hash256(), 0,
+            targetFromZeroDigits(difficulty));
+        ParallelMiner miner;
+        suite.run("pow_mine", { { "difficulty", difficulty }, { "threads", miner.getThreadCount() } }, [&]() {
+            MiningResult r = miner.mine(block);
+            benchSink += static_cast<uint64_t>(r.nonce);
+            return static_cast<double>(r.totalAttempts());
+        });
+    }
+
+    for (size_t leaves = 16; leaves <= 65536 && suite.selected("merkle_root"); leaves *= 16) {
+        std::vector<Transaction> txs = benchTransactions(leaves);
+        suite.run("merkle_root", { { "leaves", static_cast<long long>(leaves) } }, [&]() {
+            benchSink += computeMerkleRoot(txs).bytes[0];
+            return static_cast<double>(leaves);
+        });
+    }
+
+    for (size_t count = 4; count <= 16384 && (suite.selected("pos_build") || suite.selected("pos_select")); count *= 16) {
+        std::vector<Validator> vs;
+        std::mt19937_64 gen(42);
+        for (size_t i = 0; i < count; ++i) vs.push_back(Validator("V" + std::to_string(i), 1 + gen() % 1000000));
+        BenchParams params = { { "validators", static_cast<long long>(count) } };
+        suite.run("pos_build", params, [&]() {
+            ValidatorRegistry registry(vs);
+            benchSink += registry.size();
+            return static_cast<double>(count);
+        });
+        ValidatorRegistry registry(vs);
+        const size_t selections = 10000;
+        suite.run("pos_select", params, [&]() {
+            Hash256 seed;
+            for (size_t i = 0; i < selections; ++i) {
+                for (int b = 0; b < 8; ++b) seed.bytes[b] = uint8_t(i >> (8 * b));
+                benchSink += registry.select(seed)->stake;
+            }
+            return static_cast<double>(selections);
+        });
+    }
+
+    // Validation complète d'une chaîne PoS en mémoire ; éléments = blocs
+    if (suite.selected("chain_validate")) {
+        const size_t blocks = 250;
+        std::unique_ptr<Blockchain> chain;
+        {
+            QuietOutput quiet;
+            chain.reset(new Blockchain(1));
+            chain->setValidators({ Validator("Node_A", 40), Validator("Node_B", 30), Validator("Node_C", 20),
+                Validator("Node_D", 10) });
+            for (const char* user : { "Alice", "Bob", "Charlie", "Dave", "Eve" }) chain->credit(user, toAmount(1e9));
+            std::unordered_map<AccountId, uint64_t> nonces;
+            for (size_t b = 0; b < blocks; ++b) {
+                std::vector<Transaction> txs = benchTransactions(64, b, &nonces);
+                signWithDemoKeys(txs);
+                chain->addBlockPoS(std::move(txs));
             }
         }
-        return true;
+        suite.run("chain_validate", { { "blocks", static_cast<long long>(chain->size()) }, { "tx_per_block", 64 } }, [&]() {
+            ValidationReport report = chain->validate();
+            benchSink += report.valid ? 1 : 0;
+            return static_cast<double>(report.blocksChecked);
+        });
     }
 
-    void printChain() const {
-        std::cout << "\n=== BLOCKCHAIN ===\n";
-        for (const auto& block : chain) {
-            std::cout << "Bloc #" << block->index
-                << " | Hash: " << block->hash.substr(0, 10) << "..."
-                << " | Merkle: " << block->merkleRoot.substr(0, 10) << "..."
-                << " | " << block->getConsensusInfo() << "\n";
+    {
+        const size_t count = 10000;
+        std::vector<Transaction> txs = benchTransactions(count);
+        std::vector<uint8_t> bytes;
+        bytes.reserve(count * Transaction::MAX_ENCODED_SIZE);
+        for (const auto& tx : txs) {
+            ByteWriter w(bytes);
+            tx.encode(w);
         }
-        std::cout << "==================\n\n";
+        BenchParams params = { { "transactions", static_cast<long long>(count) } };
+        suite.run("tx_encode", params, [&]() {
+            bytes.clear();
+            ByteWriter w(bytes);
+            for (const auto& tx : txs) tx.encode(w);
+            return static_cast<double>(count);
+        });
+        suite.run("tx_decode", params, [&]() {
+            ByteReader r(bytes.data(), bytes.size());
+            for (size_t i = 0; i < count; ++i) benchSink += Transaction::decode(r).id;
+            return static_cast<double>(count);
+        });
+        suite.run("tx_hash", params, [&]() {
+            for (const auto& tx : txs) benchSink += tx.hash().bytes[0];
+            return static_cast<double>(count);
+        });
+        suite.run("header_hash", { { "headers", static_cast<long long>(count) } }, [&]() {
+            for (size_t i = 0; i < count; ++i) {
+                benchSink += BlockHeader(i, Hash256(), Hash256(), "20240101T000000.000Z", 0).hash().bytes[0];
+            }
+            return static_cast<double>(count);
+        });
     }
-};
 
-// ==================================================
-// UTILITAIRE TRANSACTIONS
-// ==================================================
-std::vector<Transaction> createSampleTransactions(int count) {
-    std::vector<Transaction> txs;
-    std::vector<std::string> users = { "Alice", "Bob", "Charlie", "Dave", "Eve" };
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> userDist(0, static_cast<int>(users.size()) - 1);
-    std::uniform_real_distribution<> amountDist(0.1, 10.0);
+    // Signatures d'un bloc de 1000 transactions (5 émetteurs) ; éléments = signatures
+    if (suite.selected("sig_verify_single") || suite.selected("sig_verify_batch")) {
+        const size_t count = 1000;
+        std::vector<Transaction> txs = benchTransactions(count);
+        signWithDemoKeys(txs);
+        BenchParams params = { { "transactions", static_cast<long long>(count) } };
+        suite.run("sig_verify_single", params, [&]() {
+            for (const auto& tx : txs) benchSink += tx.verifySignature() ? 1 : 0;
+            return static_cast<double>(count);
+        });
+        suite.run("sig_verify_batch", params, [&]() {
+            benchSink += verifySignatures(txs) ? 1 : 0;
+            return static_cast<double>(count);
+        });
+    }
 
-    for (int i = 0; i < count; ++i) {
-        std::string sender = users[userDist(gen)];
-        std::string receiver;
-        do {
-            receiver = users[userDist(gen)];
-        } while (receiver == sender);
-        double amount = amountDist(gen);
-        txs.push_back(Transaction(sender, receiver, amount));
+    if (outPath.empty()) {
+        suite.writeJson(std::cout);
+        return 0;
     }
-    return txs;
+    std::ofstream out(outPath);
+    suite.writeJson(out);
+    if (!out) {
+        std::cerr << " Erreur d'écriture : " << outPath << "\n";
+        return 1;
+    }
+    std::cerr << " Résultats écrits dans " << outPath << "\n";
+    return 0;
 }
+#endif
 
 // ==================================================
 // MAIN
 // ==================================================
-int main() {
+#ifdef BENCH_SUITE
+int main(int argc, char* argv[]) {
+    return runBenchmarkSuite(argc, argv);
+}
+#else
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runHeaderHashBenchmark(200000);
+        runMerkleBenchmark();
+        runParallelMerkleBenchmark();
+        runIncrementalMerkleBenchmark();
+        runValidatorSelectionBenchmark();
+        runTransactionMemoryBenchmark(10000);
+        runSerializationBenchmark(1000000);
+        runMempoolBenchmark(1000000);
+        runLedgerBenchmark(1000000, 100000);
+        runStorageBenchmark(1000000);
+        runValidationBenchmark(10000);
+        runRetargetBenchmark(60, 0.020);
+        runPipelineBenchmark(40, 4000, 4);
+        runMetricsBenchmark(100000000);
+        runChainIndexBenchmark(500000);
+        runReorgBenchmark(2000, 50);
+        runSignatureBenchmark(100000);
+        runNetworkBenchmark({ 10, 50, 100, 200 });
+        runSyncBenchmark(1000000, 10);
+        runUtxoBenchmark({ 100000, 1000000, 4000000 }, 32u << 20);
+#ifndef _WIN32
+        runRpcBenchmark(200, 100);
+#endif
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--selftest") {
+        bool ok = runSha256SelfTest();
+        ok = runMerkleSelfTest() && ok;
+        ok = runMerkleAccumulatorSelfTest() && ok;
+        ok = runValidatorSelfTest() && ok;
+        ok = runLedgerSelfTest() && ok;
+        ok = runSerializationSelfTest() && ok;
+        ok = runTargetSelfTest() && ok;
+        ok = runChainIndexSelfTest() && ok;
+        ok = runForkSelfTest() && ok;
+        ok = runPipelineSelfTest() && ok;
+        ok = runSignatureSelfTest() && ok;
+        ok = runNetworkSelfTest() && ok;
+        ok = runSyncSelfTest() && ok;
+        ok = runUtxoSelfTest() && ok;
+#ifndef _WIN32
+        ok = runRpcSelfTest() && ok;
+#endif
+        return ok ? 0 : 1;
+    }
+
+    // --network <N> : N nœuds simulés, blocs compacts puis complets
+    if (argc > 2 && std::string(argv[1]) == "--network") {
+        runNetworkSimulation(std::stoul(argv[2]));
+        return 0;
+    }
+
+    // --sync <N> [k] : synchronisation initiale d'une chaîne de N blocs (une transaction tous les k blocs)
+    if (argc > 2 && std::string(argv[1]) == "--sync") {
+        runSyncBenchmark(std::stoul(argv[2]), argc > 3 ? std::stoul(argv[3]) : 10);
+        return 0;
+    }
+
+    // --utxo <N> [Mo] : blocs UTXO appliqués et annulés sur un ensemble de N sorties, cache de Mo mégaoctets
+    if (argc > 2 && std::string(argv[1]) == "--utxo") {
+        runUtxoBenchmark({ std::stoul(argv[2]) }, static_cast<size_t>(argc > 3 ? std::stoul(argv[3]) : 32) << 20);
+        return 0;
+    }
+
+#ifndef _WIN32
+    // --rpc <port> [dossier] : sert la chaîne du dossier (ou une chaîne de démonstration) jusqu'à Entrée
+    if (argc > 2 && std::string(argv[1]) == "--rpc") {
+        Blockchain served(1);
+        std::unique_ptr<BlockStore> servedStore;
+        if (argc > 3) {
+            servedStore.reset(new BlockStore(argv[3]));
+            served.attachStore(*servedStore);
+        }
+        else {
+            buildRpcDemoChain(served, 200, 100);
+        }
+        RpcServer server(served, static_cast<uint16_t>(std::stoul(argv[2])));
+        std::cout << " Serveur RPC sur 127.0.0.1:" << server.port() << " (" << served.size() << " blocs), Entrée pour arrêter\n";
+        std::cin.get();
+        server.stop();
+        std::cout << " " << server.requestsServed() << " requêtes servies\n";
+        return 0;
+    }
+    // --rpc-load <port> [connexions] [en vol] : générateur de charge contre un serveur local
+    if (argc > 2 && std::string(argv[1]) == "--rpc-load") {
+        RpcLoadConfig config;
+        if (argc > 3) config.connections = std::stoul(argv[3]);
+        if (argc > 4) config.depth = std::stoul(argv[4]);
+        printRpcLoadReport(config, runRpcLoad(static_cast<uint16_t>(std::stoul(argv[2])), config));
+        return 0;
+    }
+#endif
+
     std::cout << "=== Exercice 4 : Mini-blockchain  ===\n\n";
 
+#ifndef NO_METRICS
+    // --metrics <fichier> : instantané Prometheus réécrit chaque seconde et en fin d'exécution
+    std::unique_ptr<MetricsExporter> exporter;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--metrics") exporter.reset(new MetricsExporter(argv[i + 1], std::chrono::seconds(1)));
+    }
+#endif
+
     int powDiff = 3;
     Blockchain chain(powDiff);
+    chain.setTargetBlockTime(0.05); // cible PoW réajustée vers 50 ms par bloc
+
+    // --data <dossier> : chaîne persistée sur disque et rechargée au lancement suivant
+    std::unique_ptr<BlockStore> store;
+    if (argc > 2 && std::string(argv[1]) == "--data") {
+        store.reset(new BlockStore(argv[2]));
+        chain.attachStore(*store);
+    }
 
     std::vector<Validator> validators = {
-        Validator("Node_A", 40.0),
-        Validator("Node_B", 30.0),
-        Validator("Node_C", 20.0),
-        Validator("Node_D", 10.0)
+        Validator("Node_A", 40),
+        Validator("Node_B", 30),
+        Validator("Node_C", 20),
+        Validator("Node_D", 10)
     };
     chain.setValidators(validators);
+    // Clés publiques des comptes, nécessaires pour vérifier les blocs rechargés
+    for (const char* user : { "Alice", "Bob", "Charlie", "Dave", "Eve" }) {
+        chain.credit(user, toAmount(10.0));
+        AccountKeys::instance().demoKeyPair(AccountNames::instance().intern(user));
+    }
+    if (store) chain.rebuildLedger();
+
+    // Plusieurs producteurs soumettent en parallèle, chaque bloc prend les 3
+    // transactions aux frais les plus élevés. Lots préparés à l'avance : les
+    // nonces de chaque émetteur se suivent d'un lot à l'autre.
+    std::unordered_map<AccountId, uint64_t> nonces;
+    for (const char* user : { "Alice", "Bob", "Charlie", "Dave", "Eve" }) {
+        nonces[AccountNames::instance().intern(user)] = chain.getNextNonce(user);
+    }
+    std::vector<std::vector<Transaction> > batches;
+    for (int p = 0; p < 3; ++p) {
+        batches.push_back(createSampleTransactions(6, &nonces));
+        signWithDemoKeys(batches.back());
+    }
+    std::vector<std::thread> producers;
+    for (const auto& batch : batches) {
+        producers.emplace_back([&chain, &batch]() {
+            for (const auto& tx : batch) chain.submitTransaction(tx);
+        });
+    }
+    for (auto& t : producers) t.join();
+    chain.setMaxBlockTransactions(3);
+    std::cout << " Mempool : " << chain.getMempool().size() << " transactions en attente\n\n";
 
     std::cout << " Ajout de 2 blocs avec PoW (difficulté = " << powDiff << ")\n";
-    chain.addBlockPoW(createSampleTransactions(3));
-    chain.addBlockPoW(createSampleTransactions(2));
+    chain.addBlockPoW();
+    chain.addBlockPoW();
+
+    // Assemblage du bloc suivant pendant le minage du précédent
+    std::cout << " Ajout de 2 blocs PoW en pipeline\n";
+    chain.startPipeline();
+    std::vector<std::future<BlockReceipt> > receipts;
+    receipts.push_back(chain.submitBlock());
+    receipts.push_back(chain.submitBlock());
+    for (auto& f : receipts) {
+        BlockReceipt r = f.get();
+        std::cout << " Bloc PoW ajouté [" << r.index << "] en " << static_cast<long long>(r.latencySeconds * 1000.0)
+            << " ms (assemblage " << static_cast<long long>(r.assemblySeconds * 1000000.0) << " µs, minage "
+            << static_cast<long long>(r.miningSeconds * 1000000.0) << " µs)\n";
+        std::cout << "   Hash : " << r.hash << "\n";
+    }
+    chain.stopPipeline();
+    std::cout << "\n";
 
     std::cout << " Ajout de 2 blocs avec PoS\n";
-    chain.addBlockPoS(createSampleTransactions(4));
-    chain.addBlockPoS(createSampleTransactions(3));
+    chain.addBlockPoS();
+    chain.addBlockPoS();
 
-    std::cout << " Vérification...\n";
-    if (chain.isValid()) {
-        std::cout << " Chaîne valide !\n\n";
+    std::cout << " Vérification complète...\n";
+    ValidationReport report = chain.validate();
+    if (report.valid) {
+        std::cout << " Chaîne valide ! (" << report.blocksChecked << " blocs, "
+            << static_cast<long long>(report.blocksPerSecond()) << " blocs/s)\n\n";
     }
     else {
-        std::cout << " Chaîne corrompue !\n\n";
+        std::cout << " Chaîne corrompue au bloc " << report.firstInvalid << " : "
+            << blockErrorName(report.error) << "\n\n";
     }
 
     chain.printChain();
 
+    std::cout << " Soldes :";
+    for (const char* user : { "Alice", "Bob", "Charlie", "Dave", "Eve" }) {
+        std::cout << " " << user << "=" << formatAmount(chain.getBalance(user));
+    }
+    std::cout << "\n\n";
+
+    const Block& proven = chain.getBlock(1);
+    if (!proven.transactions.empty()) {
+        size_t txIndex = std::min<size_t>(2, proven.transactions.size() - 1);
+        std::cout << " Preuve d'inclusion (bloc 1, transaction " << txIndex << ")...\n";
+        MerkleProof proof = proven.getMerkleProof(txIndex);
+        bool included = MerkleTree::verifyProof(MerkleTree::leafHash(proven.transactions[txIndex]), proof, proven.merkleRoot);
+        std::cout << "   " << proof.siblings.size() << " hashes dans la preuve -> "
+            << (included ? "transaction incluse" : "preuve invalide") << "\n\n";
+    }
+
     std::cout << " PoW = lent mais sécurisé par calcul.\n";
     std::cout << "   PoS = rapide, sécurisé par enjeu.\n";
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file